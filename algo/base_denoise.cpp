@@ -1,4 +1,7 @@
 #include "base_denoise.h"
+#include "../util/parallel.h"
+
+#include <algorithm>
 
 namespace MV
 {
@@ -32,5 +35,133 @@ namespace MV
 //    return vecFaceCentroid;
 //}
 
+
+const FaceNeighborhood& BaseDenoise::GetFaceNeighborhood(const SurfaceMesh& mesh, FaceNeighborType eType,
+                                                         unsigned int uiThreadCount)
+{
+    // topology stamps are unique across meshes, so a matching stamp means same mesh and same connectivity
+    FaceNeighborhood& neighborhood = (eType == FaceNeighborType::Vertex_Ring) ? m_VertexRing : m_EdgeRing;
+    if (neighborhood.uTopologyVersion != mesh.topology_version())
+    {
+        if (eType == FaceNeighborType::Vertex_Ring)
+        {
+            BuildVertexRing(mesh, neighborhood, uiThreadCount);
+        }
+        else
+        {
+            BuildEdgeRing(mesh, neighborhood, uiThreadCount);
+        }
+        neighborhood.uTopologyVersion = mesh.topology_version();
+    }
+    return neighborhood;
+}
+
+void BaseDenoise::ReleaseFaceNeighborhood()
+{
+    m_EdgeRing = FaceNeighborhood();
+    m_VertexRing = FaceNeighborhood();
+}
+
+void BaseDenoise::BuildEdgeRing(const SurfaceMesh& mesh, FaceNeighborhood& neighborhood, unsigned int uiThreadCount)
+{
+    const std::size_t uiFaceCount = mesh.faces_size();
+    std::vector<int>& vecOffset = neighborhood.vecOffset;
+    std::vector<int>& vecIndex = neighborhood.vecIndex;
+
+    // pass 1: count the neighbours of every face
+    vecOffset.assign(uiFaceCount + 1, 0);
+    parallel_for(0, uiFaceCount, [&](std::size_t i) {
+        SurfaceMesh::Face f(static_cast<int>(i));
+        if (mesh.is_deleted(f))
+        {
+            return;
+        }
+        int iCount = 0;
+        for (auto h : mesh.halfedges(f))
+        {
+            iCount += mesh.face(mesh.opposite(h)).is_valid();
+        }
+        vecOffset[i + 1] = iCount;
+    }, uiThreadCount);
+    for (std::size_t i = 0; i < uiFaceCount; i++)
+    {
+        vecOffset[i + 1] += vecOffset[i];
+    }
+
+    // pass 2: fill them in, in halfedge order
+    vecIndex.resize(vecOffset[uiFaceCount]);
+    vecIndex.shrink_to_fit();
+    parallel_for(0, uiFaceCount, [&](std::size_t i) {
+        SurfaceMesh::Face f(static_cast<int>(i));
+        if (mesh.is_deleted(f))
+        {
+            return;
+        }
+        int k = vecOffset[i];
+        for (auto h : mesh.halfedges(f))
+        {
+            auto ff = mesh.face(mesh.opposite(h));
+            if (ff.is_valid())
+            {
+                vecIndex[k++] = ff.idx();
+            }
+        }
+    }, uiThreadCount);
+}
+
+void BaseDenoise::BuildVertexRing(const SurfaceMesh& mesh, FaceNeighborhood& neighborhood, unsigned int uiThreadCount)
+{
+    const std::size_t uiFaceCount = mesh.faces_size();
+    std::vector<int>& vecOffset = neighborhood.vecOffset;
+    std::vector<int>& vecIndex = neighborhood.vecIndex;
+
+    // the faces around the vertices of face i, without i and without duplicates (in order of first visit)
+    auto collect = [&mesh](std::size_t i, std::vector<int>& vecRing) {
+        vecRing.clear();
+        SurfaceMesh::Face f(static_cast<int>(i));
+        if (mesh.is_deleted(f))
+        {
+            return;
+        }
+        for (auto v : mesh.vertices(f))
+        {
+            for (auto ff : mesh.faces(v))
+            {
+                if (ff != f && std::find(vecRing.begin(), vecRing.end(), ff.idx()) == vecRing.end())
+                {
+                    vecRing.push_back(ff.idx());
+                }
+            }
+        }
+    };
+
+    // pass 1: count
+    vecOffset.assign(uiFaceCount + 1, 0);
+    parallel_for_chunks(0, uiFaceCount, [&](std::size_t uiBegin, std::size_t uiEnd, unsigned int) {
+        std::vector<int> vecRing;
+        for (std::size_t i = uiBegin; i < uiEnd; i++)
+        {
+            collect(i, vecRing);
+            vecOffset[i + 1] = static_cast<int>(vecRing.size());
+        }
+    }, uiThreadCount);
+    for (std::size_t i = 0; i < uiFaceCount; i++)
+    {
+        vecOffset[i + 1] += vecOffset[i];
+    }
+
+    // pass 2: fill
+    vecIndex.resize(vecOffset[uiFaceCount]);
+    vecIndex.shrink_to_fit();
+    parallel_for_chunks(0, uiFaceCount, [&](std::size_t uiBegin, std::size_t uiEnd, unsigned int) {
+        std::vector<int> vecRing;
+        for (std::size_t i = uiBegin; i < uiEnd; i++)
+        {
+            collect(i, vecRing);
+            std::copy(vecRing.begin(), vecRing.end(), vecIndex.begin() + vecOffset[i]);
+        }
+    }, uiThreadCount);
+}
+
 }
 
@@ -13,11 +13,26 @@ enum class DenoiseType
     Unknown
 };
 
+enum class FaceNeighborType
+{
+    Edge_Ring,      // faces sharing an edge with the face
+    Vertex_Ring,    // faces sharing at least one vertex with the face
+};
+
+// Flat (CSR) face neighbourhood: the neighbours of face i are
+// vecIndex[vecOffset[i] .. vecOffset[i + 1]). Deleted faces have no neighbours.
+struct FaceNeighborhood
+{
+    std::vector<int> vecOffset;
+    std::vector<int> vecIndex;
+    std::uint64_t uTopologyVersion = 0;  // SurfaceMesh::topology_version() it was built for (0: not built)
+};
+
 class BaseDenoise
 {
 public:
     BaseDenoise(){};
-    ~BaseDenoise(){};
+    virtual ~BaseDenoise(){};
 
 public:
     virtual void Denoise(SurfaceMesh& mesh) = 0;
@@ -52,6 +67,24 @@ public:
         }
         return vecFaceCentroid;
     }
+
+protected:
+    // Returns the face neighbourhood of the mesh. It is built on first use and then reused by
+    // every later call (and every iteration of a filter) until the connectivity of the mesh changes.
+    const FaceNeighborhood& GetFaceNeighborhood(const SurfaceMesh& mesh,
+                                                FaceNeighborType eType = FaceNeighborType::Edge_Ring,
+                                                unsigned int uiThreadCount = 0);
+
+    // Frees the cached neighbourhoods.
+    void ReleaseFaceNeighborhood();
+
+private:
+    void BuildEdgeRing(const SurfaceMesh& mesh, FaceNeighborhood& neighborhood, unsigned int uiThreadCount);
+    void BuildVertexRing(const SurfaceMesh& mesh, FaceNeighborhood& neighborhood, unsigned int uiThreadCount);
+
+private:
+    FaceNeighborhood m_EdgeRing;
+    FaceNeighborhood m_VertexRing;
 };
 
 }
@@ -1,16 +1,119 @@
 #include "bilaterial_denoise.h"
 #include "../core/normals.h"
 #include "../core/surface_mesh_geometry.h"
+#include "../util/parallel.h"
+#include "../util/stop_watch.h"
 #include <vector>
+#include <algorithm>
 #include <Eigen/Sparse>
 #include <Eigen/Dense>
 
 namespace MV
 {
 
+namespace
+{
+    // faces per batch handed to the weight kernel (keeps the SoA scratch in the L1/L2 cache)
+    const int iWeightBlockSize = 256;
+
+    // SoA scratch of one thread for the weight kernel
+    struct WeightBatch
+    {
+        std::vector<float> vecDX;
+        std::vector<float> vecDY;
+        std::vector<float> vecDZ;
+        std::vector<int> vecFace;       // the neighbours walked by EvaluateRingWeights()
+        std::vector<int> vecRingEnd;    // the end of the neighbours of each face of the block in vecFace
+    };
+
+    // Gaussian weights of the adjacency entries k = (i -> j) of the faces i in [iBegin, iEnd):
+    //     pWeight[k - first] = pScale[k - first] * exp(fFactor * |vecValue[i] - vecValue[j]|^2)
+    // with first = vecNeighborOffset[iBegin]. The differences are gathered into SoA arrays so the
+    // kernel can process them in SIMD batches.
+    void EvaluateNeighborWeights(const GaussianWeightKernel& kernel, const std::vector<int>& vecNeighborOffset,
+                                 const std::vector<int>& vecNeighborFace, const std::vector<vec3>& vecValue,
+                                 int iBegin, int iEnd, const float* pScale, float fFactor,
+                                 WeightBatch& batch, float* pWeight)
+    {
+        const int iFirst = vecNeighborOffset[iBegin];
+        const std::size_t uiCount = vecNeighborOffset[iEnd] - iFirst;
+        batch.vecDX.resize(uiCount);
+        batch.vecDY.resize(uiCount);
+        batch.vecDZ.resize(uiCount);
+        for (int i = iBegin; i < iEnd; i++)
+        {
+            const vec3& ValueI = vecValue[i];
+            for (int k = vecNeighborOffset[i]; k < vecNeighborOffset[i + 1]; k++)
+            {
+                const vec3 Diff = ValueI - vecValue[vecNeighborFace[k]];
+                batch.vecDX[k - iFirst] = Diff.x;
+                batch.vecDY[k - iFirst] = Diff.y;
+                batch.vecDZ[k - iFirst] = Diff.z;
+            }
+        }
+        kernel.Evaluate(batch.vecDX.data(), batch.vecDY.data(), batch.vecDZ.data(), pScale, fFactor, uiCount, pWeight);
+    }
+
+    // Calls func(j) for each face j sharing an edge with face i, in halfedge order (the order of the edge ring
+    // built by BaseDenoise). A deleted face has no neighbours.
+    template <typename Func>
+    inline void ForEachRingNeighbor(const SurfaceMesh& mesh, int i, Func func)
+    {
+        const SurfaceMesh::Face f(i);
+        if (mesh.is_deleted(f))
+        {
+            return;
+        }
+        for (auto h : mesh.halfedges(f))
+        {
+            const SurfaceMesh::Face ff = mesh.face(mesh.opposite(h));
+            if (ff.is_valid())
+            {
+                func(ff.idx());
+            }
+        }
+    }
+
+    // The weights of EvaluateNeighborWeights() for the edge rings of the faces in [iBegin, iEnd), walked through
+    // the halfedges of the mesh. The entries are numbered in walk order, from 0 for the first neighbour of iBegin,
+    // and the neighbours walked are left in batch.vecFace (those of face i end at batch.vecRingEnd[i - iBegin]).
+    void EvaluateRingWeights(const GaussianWeightKernel& kernel, const SurfaceMesh& mesh,
+                             const std::vector<vec3>& vecValue, int iBegin, int iEnd, const float* pScale,
+                             float fFactor, WeightBatch& batch, float* pWeight)
+    {
+        batch.vecDX.clear();
+        batch.vecDY.clear();
+        batch.vecDZ.clear();
+        batch.vecFace.clear();
+        batch.vecRingEnd.clear();
+        for (int i = iBegin; i < iEnd; i++)
+        {
+            const vec3& ValueI = vecValue[i];
+            ForEachRingNeighbor(mesh, i, [&](int j) {
+                const vec3 Diff = ValueI - vecValue[j];
+                batch.vecDX.push_back(Diff.x);
+                batch.vecDY.push_back(Diff.y);
+                batch.vecDZ.push_back(Diff.z);
+                batch.vecFace.push_back(j);
+            });
+            batch.vecRingEnd.push_back(static_cast<int>(batch.vecFace.size()));
+        }
+        kernel.Evaluate(batch.vecDX.data(), batch.vecDY.data(), batch.vecDZ.data(), pScale, fFactor,
+                        batch.vecDX.size(), pWeight);
+    }
+}
+
 BilaterialDenoise::BilaterialDenoise(DenoiseType eType)
 {
+    m_pMesh = nullptr;
+    m_pProgress = nullptr;
+    m_bCanceled = false;
     m_eDenoiseType = eType;
+    m_uiThreadCount = 0;
+    m_eGlobalSolver = GlobalSolverType::Sparse_LU;
+    m_dSolverTolerance = 1e-6;
+    m_iSolverMaxIterations = 1000;
+    m_dVertexTolerance = 1e-6;
 }
 
 BilaterialDenoise::~BilaterialDenoise() 
@@ -20,16 +123,22 @@ BilaterialDenoise::~BilaterialDenoise()
 
 void BilaterialDenoise::Denoise(SurfaceMesh& mesh)
 {
-    m_Mesh = mesh;
-    m_vecFaceNormal = GetFaceNormal(mesh);
-    m_vecFaceArea = GetFaceArea(mesh);
-    m_vecFaceCentroid = GetFaceCentroid(mesh);
-
-    if (!m_Mesh.n_vertices())
+    if (!mesh.n_vertices())
     {
         return;
     }
 
+    // The filters only read the topology of the caller's mesh; the filtered positions are written
+    // back into it by UpdateVertexPosition(). No copy of the mesh is made.
+    ProgressLogger progress(100, false);
+    m_pProgress = &progress;
+    m_bCanceled = false;
+    m_pMesh = &mesh;
+    // the areas are only computed by the scheme once they are needed, see LocalScheme()
+    m_vecFaceNormal = GetFaceNormal(mesh);
+    m_vecFaceCentroid = GetFaceCentroid(mesh);
+    ReportProgress(5);
+
     std::vector<Normal> vecResult;
     std::cout << "BilaterialDenoise Denoise Begin!" << std::endl;
     if (m_eDenoiseType == DenoiseType::Bilaterial_Local)
@@ -42,95 +151,133 @@ void BilaterialDenoise::Denoise(SurfaceMesh& mesh)
     }
     std::cout << "BilaterialDenoise Denoise End!" << std::endl;
 
-    std::cout << "BilaterialDenoise UpdateVertexPosition Begin!" << std::endl;
-    UpdateVertexPosition(mesh, vecResult, 10, true);
-    std::cout << "BilaterialDenoise UpdateVertexPosition End!" << std::endl;
+    // the per-face data of the normal filtering is not needed by the vertex update
+    std::vector<Normal>().swap(m_vecFaceNormal);
+    std::vector<float>().swap(m_vecFaceArea);
+    std::vector<Point>().swap(m_vecFaceCentroid);
+
+    if (!m_bCanceled)
+    {
+        std::cout << "BilaterialDenoise UpdateVertexPosition Begin!" << std::endl;
+        UpdateVertexPosition(mesh, vecResult, 10, true);
+        std::cout << "BilaterialDenoise UpdateVertexPosition End!" << std::endl;
+    }
+    if (m_bCanceled)
+    {
+        std::cout << "BilaterialDenoise canceled!" << std::endl;
+    }
+    m_pProgress = nullptr;
+    m_pMesh = nullptr;
+}
+
+bool BilaterialDenoise::ReportProgress(std::size_t uiPercent)
+{
+    if (m_pProgress == nullptr)
+    {
+        return true;
+    }
+    m_pProgress->notify(uiPercent);
+    if (m_pProgress->is_canceled())
+    {
+        m_bCanceled = true;
+    }
+    return !m_bCanceled;
 }
 
 void BilaterialDenoise::GlobalScheme(std::vector<Normal>& vecFilteredNormal) 
 {
-    vecFilteredNormal.resize(m_Mesh.n_faces());
-    double dSmoothness = 0.01;
+    const FaceNeighborhood& Neighbor = GetFaceNeighborhood(*m_pMesh, FaceNeighborType::Edge_Ring, m_uiThreadCount);
+    const std::vector<int>& vecNeighborOffset = Neighbor.vecOffset;
+    const std::vector<int>& vecNeighborFace = Neighbor.vecIndex;
 
-    std::vector<Eigen::Triplet<double>> coeff_triple;
-    coeff_triple.clear();
-    std::vector<Eigen::Triplet<double>> weight_triple;
-    weight_triple.clear();
-    Eigen::SparseMatrix<double> weight_matrix((int)m_Mesh.n_faces(), (int)m_Mesh.n_faces());
-    Eigen::SparseMatrix<double> normalize_matrix((int)m_Mesh.n_faces(), (int)m_Mesh.n_faces());
-    Eigen::SparseMatrix<double> identity_matrix((int)m_Mesh.n_faces(), (int)m_Mesh.n_faces());
-    identity_matrix.setIdentity();
+    const int iFaceCount = static_cast<int>(m_vecFaceNormal.size());
+    vecFilteredNormal.resize(iFaceCount);
+    m_vecFaceArea = GetFaceArea(*m_pMesh);
+    double dSmoothness = 0.01;
 
-    double dSigmaC = CaculateSigmaC(m_Mesh, m_vecFaceCentroid, 1.0);
+    double dSigmaC = CaculateSigmaC(m_vecFaceCentroid, 1.0);
     double dSigmaS = 0.35;
     std::cout << "dSigmaC: " << dSigmaC << std::endl;
-    for (auto f : m_Mesh.faces())
-    {
-        int iIndexI = f.idx();
-        Normal NormalI = m_vecFaceNormal[iIndexI];
-        Point ptCentroidI = m_vecFaceCentroid[iIndexI];
-
-        // openmeshҲðǷٽжϵ
-        std::vector<SurfaceMesh::Face> vecFace;
-        auto halfedgeOfEachFace = m_Mesh.halfedges(f);
-        for (auto h : halfedgeOfEachFace)
+
+    // row-normalized bilateral weights, one per adjacency entry: M = I - D * W
+    const float fSpatialFactor = static_cast<float>(-0.5 / (dSigmaC * dSigmaC));
+    const float fRangeFactor = static_cast<float>(-0.5 / (dSigmaS * dSigmaS));
+    std::vector<double> vecWeight(vecNeighborFace.size());
+    parallel_for_chunks(0, iFaceCount, [&](std::size_t uiBegin, std::size_t uiEnd, unsigned int) {
+        WeightBatch batch;
+        std::vector<float> vecSpatial, vecBilateral;
+        for (int iBlock = (int)uiBegin; iBlock < (int)uiEnd; iBlock += iWeightBlockSize)
         {
-            auto oh = m_Mesh.opposite(h);
-            auto ff = m_Mesh.face(oh);
-            if (ff.is_valid())
+            const int iBlockEnd = std::min((int)uiEnd, iBlock + iWeightBlockSize);
+            const int iFirst = vecNeighborOffset[iBlock];
+            const std::size_t uiCount = vecNeighborOffset[iBlockEnd] - iFirst;
+            vecSpatial.resize(uiCount);
+            vecBilateral.resize(uiCount);
+
+            // spatial Gaussian first, then the range Gaussian scaled by it
+            EvaluateNeighborWeights(m_WeightKernel, vecNeighborOffset, vecNeighborFace, m_vecFaceCentroid,
+                                    iBlock, iBlockEnd, nullptr, fSpatialFactor, batch, vecSpatial.data());
+            EvaluateNeighborWeights(m_WeightKernel, vecNeighborOffset, vecNeighborFace, m_vecFaceNormal,
+                                    iBlock, iBlockEnd, vecSpatial.data(), fRangeFactor, batch, vecBilateral.data());
+
+            for (int iIndexI = iBlock; iIndexI < iBlockEnd; iIndexI++)
             {
-                vecFace.push_back(ff);
+                double dWeightSum = 0.0;
+                for (int k = vecNeighborOffset[iIndexI]; k < vecNeighborOffset[iIndexI + 1]; k++)
+                {
+                    double dWeight = m_vecFaceArea[vecNeighborFace[k]] * (double)vecBilateral[k - iFirst];
+                    vecWeight[k] = dWeight;
+                    dWeightSum += dWeight;
+                }
+                if (dWeightSum)
+                {
+                    for (int k = vecNeighborOffset[iIndexI]; k < vecNeighborOffset[iIndexI + 1]; k++)
+                    {
+                        vecWeight[k] /= dWeightSum;
+                    }
+                }
             }
         }
+    }, m_uiThreadCount);
 
-        double dWeightSum = 0.0;
-        for (int i = 0; i < (int)vecFace.size(); i++)
-        {
-            int iIndexJ = vecFace[i].idx();
-            Normal NormalJ = m_vecFaceNormal[iIndexJ];
-            Point ptCentroidJ = m_vecFaceCentroid[iIndexJ];
-            float dSpatialDistance = norm(ptCentroidI - ptCentroidJ);
-            double dSpatialWeight =
-                std::exp(-0.5 * dSpatialDistance * dSpatialDistance /
-                         (dSigmaC * dSigmaC));
-            double dRangeDistance = norm(NormalI - NormalJ);
-            double dRangeWeight = std::exp(
-                -0.5 * dRangeDistance * dRangeDistance / (dSigmaS * dSigmaS));
-            double dWeight =
-                m_vecFaceArea[iIndexJ] * dSpatialWeight * dRangeWeight;
-            coeff_triple.push_back(
-                Eigen::Triplet<double>(iIndexI, iIndexJ, dWeight));
-            dWeightSum += dWeight;
-        }
-        if (dWeightSum)
+    // the centroids and areas are folded into the weights and are not needed anymore
+    std::vector<float>().swap(m_vecFaceArea);
+    std::vector<Point>().swap(m_vecFaceCentroid);
+
+    if (!ReportProgress(15))
+    {
+        return;
+    }
+
+    // right-hand side, and the current normals as the initial guess of the iterative solvers
+    Eigen::MatrixX3d right_term(iFaceCount, 3);
+    Eigen::MatrixX3d filtered_normals_matrix(iFaceCount, 3);
+    for (int i = 0; i < iFaceCount; i++)
+    {
+        for (int j = 0; j < 3; j++)
         {
-            weight_triple.push_back(
-                Eigen::Triplet<double>(iIndexI, iIndexI, 1.0 / dWeightSum));
+            filtered_normals_matrix(i, j) = m_vecFaceNormal[i][j];
+            right_term(i, j) = dSmoothness * m_vecFaceNormal[i][j];
         }
     }
-    weight_matrix.setFromTriplets(coeff_triple.begin(), coeff_triple.end());
-    normalize_matrix.setFromTriplets(weight_triple.begin(),
-                                     weight_triple.end());
-    Eigen::SparseMatrix<double> matrix =
-        identity_matrix - normalize_matrix * weight_matrix;
-    Eigen::SparseMatrix<double> coeff_matrix =
-        (1 - dSmoothness) * matrix.transpose() * matrix +
-        dSmoothness * identity_matrix;
 
-    Eigen::MatrixXd right_term(m_Mesh.n_faces(), 3);
-    for (int i = 0; i < (int)m_vecFaceNormal.size(); i++)
+    // solve ((1 - s) * M^T * M + s * I) x = s * n
+    StopWatch watch;
+    m_SolverReport = GlobalSolverReport();
+    if (m_eGlobalSolver == GlobalSolverType::Conjugate_Gradient_Matrix_Free)
+    {
+        SolveGlobalMatrixFree(vecWeight, dSmoothness, right_term, filtered_normals_matrix);
+    }
+    else
     {
-        right_term(i, 0) = m_vecFaceNormal[i][0];
-        right_term(i, 1) = m_vecFaceNormal[i][1];
-        right_term(i, 2) = m_vecFaceNormal[i][2];
+        SolveGlobalAssembled(vecWeight, dSmoothness, right_term, filtered_normals_matrix);
     }
-    right_term = dSmoothness * right_term;
+    m_SolverReport.dSeconds = watch.elapsed_seconds(3);
+    std::cout << "GlobalScheme: solved " << iFaceCount << " faces in " << watch.time_string()
+              << " (iterations: " << m_SolverReport.iIterations
+              << ", relative residual: " << m_SolverReport.dResidual << ")" << std::endl;
+    ReportProgress(70);
 
-    // solve Ax = b
-    Eigen::SparseLU<Eigen::SparseMatrix<double>> solver;
-    solver.analyzePattern(coeff_matrix);
-    solver.factorize(coeff_matrix);
-    Eigen::MatrixX3d filtered_normals_matrix = solver.solve(right_term);
     filtered_normals_matrix.rowwise().normalize();
     for (int i = 0; i < (int)vecFilteredNormal.size(); i++)
     {
@@ -140,131 +287,474 @@ void BilaterialDenoise::GlobalScheme(std::vector<Normal>& vecFilteredNormal)
     }
 }
 
-double BilaterialDenoise::CaculateSigmaC(SurfaceMesh& mesh, std::vector<Point> vecFaceCentroid, double dValue)
+void BilaterialDenoise::SolveGlobalAssembled(const std::vector<double>& vecWeight, double dSmoothness,
+                                             const Eigen::MatrixX3d& right_term, Eigen::MatrixX3d& solution)
 {
-    double dSigmaC = 0.0;
-    double dNum = 0.0;
-    for (auto f : m_Mesh.faces())
+    const FaceNeighborhood& Neighbor = GetFaceNeighborhood(*m_pMesh, FaceNeighborType::Edge_Ring, m_uiThreadCount);
+    const std::vector<int>& vecNeighborOffset = Neighbor.vecOffset;
+    const std::vector<int>& vecNeighborFace = Neighbor.vecIndex;
+
+    const int iFaceCount = static_cast<int>(right_term.rows());
+
+    std::vector<Eigen::Triplet<double>> coeff_triple;
+    coeff_triple.reserve(iFaceCount + vecWeight.size());
+    for (int iIndexI = 0; iIndexI < iFaceCount; iIndexI++)
     {
-        Point ci = vecFaceCentroid[f.idx()];
-        auto xxx = f.idx();
-        auto halfedgeOfEachFace = m_Mesh.halfedges(f);
-        for (auto h : halfedgeOfEachFace)
+        coeff_triple.push_back(Eigen::Triplet<double>(iIndexI, iIndexI, 1.0));
+        for (int k = vecNeighborOffset[iIndexI]; k < vecNeighborOffset[iIndexI + 1]; k++)
         {
-            auto oh = m_Mesh.opposite(h);
-            auto ff = m_Mesh.face(oh);
-            if (ff.is_valid())
+            coeff_triple.push_back(Eigen::Triplet<double>(iIndexI, vecNeighborFace[k], -vecWeight[k]));
+        }
+    }
+    Eigen::SparseMatrix<double> matrix(iFaceCount, iFaceCount);
+    matrix.setFromTriplets(coeff_triple.begin(), coeff_triple.end());
+    std::vector<Eigen::Triplet<double>>().swap(coeff_triple);
+
+    Eigen::SparseMatrix<double> identity_matrix(iFaceCount, iFaceCount);
+    identity_matrix.setIdentity();
+    Eigen::SparseMatrix<double> coeff_matrix =
+        (1 - dSmoothness) * Eigen::SparseMatrix<double>(matrix.transpose() * matrix) +
+        dSmoothness * identity_matrix;
+
+    if (m_eGlobalSolver == GlobalSolverType::Sparse_LU)
+    {
+        Eigen::SparseLU<Eigen::SparseMatrix<double>> solver;
+        solver.analyzePattern(coeff_matrix);
+        solver.factorize(coeff_matrix);
+        solution = solver.solve(right_term);
+        m_SolverReport.dResidual = (coeff_matrix * solution - right_term).norm() / right_term.norm();
+        return;
+    }
+
+    // the iterative solvers work column by column, starting from the current normals
+    auto solve = [&](auto& solver) {
+        solver.setTolerance(m_dSolverTolerance);
+        solver.setMaxIterations(m_iSolverMaxIterations);
+        solver.compute(coeff_matrix);
+        for (int j = 0; j < 3; j++)
+        {
+            Eigen::VectorXd x = solver.solveWithGuess(right_term.col(j), solution.col(j));
+            solution.col(j) = x;
+            m_SolverReport.iIterations = std::max(m_SolverReport.iIterations, (int)solver.iterations());
+            m_SolverReport.dResidual = std::max(m_SolverReport.dResidual, solver.error());
+        }
+    };
+    if (m_eGlobalSolver == GlobalSolverType::Conjugate_Gradient_Incomplete_Cholesky)
+    {
+        Eigen::ConjugateGradient<Eigen::SparseMatrix<double>, Eigen::Lower | Eigen::Upper,
+                                 Eigen::IncompleteCholesky<double>> solver;
+        solve(solver);
+    }
+    else
+    {
+        Eigen::ConjugateGradient<Eigen::SparseMatrix<double>, Eigen::Lower | Eigen::Upper,
+                                 Eigen::DiagonalPreconditioner<double>> solver;
+        solve(solver);
+    }
+}
+
+void BilaterialDenoise::SolveGlobalMatrixFree(const std::vector<double>& vecWeight, double dSmoothness,
+                                              const Eigen::MatrixX3d& right_term, Eigen::MatrixX3d& solution)
+{
+    const FaceNeighborhood& Neighbor = GetFaceNeighborhood(*m_pMesh, FaceNeighborType::Edge_Ring, m_uiThreadCount);
+    const std::vector<int>& vecNeighborOffset = Neighbor.vecOffset;
+    const std::vector<int>& vecNeighborFace = Neighbor.vecIndex;
+
+    const int iFaceCount = static_cast<int>(right_term.rows());
+
+    // The face adjacency is symmetric, so M^T can be applied as a gather as well: for each entry
+    // (i -> j) find the entry (j -> i) holding the weight M(j, i). Repeated neighbours (faces sharing
+    // more than one edge) are matched in the order they appear.
+    std::vector<int> vecReverse(vecNeighborFace.size(), -1);
+    parallel_for(0, iFaceCount, [&](std::size_t i) {
+        for (int k = vecNeighborOffset[i]; k < vecNeighborOffset[i + 1]; k++)
+        {
+            int j = vecNeighborFace[k];
+            int iOccurrence = 0;
+            for (int kk = vecNeighborOffset[i]; kk < k; kk++)
+            {
+                iOccurrence += (vecNeighborFace[kk] == j);
+            }
+            for (int kk = vecNeighborOffset[j]; kk < vecNeighborOffset[j + 1]; kk++)
+            {
+                if (vecNeighborFace[kk] == (int)i && iOccurrence-- == 0)
+                {
+                    vecReverse[k] = kk;
+                    break;
+                }
+            }
+        }
+    }, m_uiThreadCount);
+
+    // y = M x, with M(i, i) = 1 and M(i, j) = -w(i -> j)
+    auto applyM = [&](const Eigen::VectorXd& x, Eigen::VectorXd& y) {
+        parallel_for(0, iFaceCount, [&](std::size_t i) {
+            double d = x[i];
+            for (int k = vecNeighborOffset[i]; k < vecNeighborOffset[i + 1]; k++)
+            {
+                d -= vecWeight[k] * x[vecNeighborFace[k]];
+            }
+            y[i] = d;
+        }, m_uiThreadCount);
+    };
+    // y = M^T x, gathering M(j, i) through the reverse entries
+    auto applyMt = [&](const Eigen::VectorXd& x, Eigen::VectorXd& y) {
+        parallel_for(0, iFaceCount, [&](std::size_t i) {
+            double d = x[i];
+            for (int k = vecNeighborOffset[i]; k < vecNeighborOffset[i + 1]; k++)
+            {
+                if (vecReverse[k] >= 0)
+                {
+                    d -= vecWeight[vecReverse[k]] * x[vecNeighborFace[k]];
+                }
+            }
+            y[i] = d;
+        }, m_uiThreadCount);
+    };
+    Eigen::VectorXd vecTemp(iFaceCount);
+    auto applyA = [&](const Eigen::VectorXd& x, Eigen::VectorXd& y) {
+        applyM(x, vecTemp);
+        applyMt(vecTemp, y);
+        parallel_for(0, iFaceCount, [&](std::size_t i) {
+            y[i] = (1 - dSmoothness) * y[i] + dSmoothness * x[i];
+        }, m_uiThreadCount);
+    };
+
+    // Jacobi preconditioner: diag(A) = (1 - s) * (1 + sum_j M(j, i)^2) + s
+    Eigen::VectorXd vecInvDiag(iFaceCount);
+    parallel_for(0, iFaceCount, [&](std::size_t i) {
+        double d = 1.0;
+        for (int k = vecNeighborOffset[i]; k < vecNeighborOffset[i + 1]; k++)
+        {
+            if (vecReverse[k] >= 0)
+            {
+                d += vecWeight[vecReverse[k]] * vecWeight[vecReverse[k]];
+            }
+        }
+        vecInvDiag[i] = 1.0 / ((1 - dSmoothness) * d + dSmoothness);
+    }, m_uiThreadCount);
+
+    // Dot products are summed over fixed-size blocks and the block sums are added up in order, so the
+    // solver takes the same path for any number of threads.
+    const std::size_t uiBlockSize = 4096;
+    const std::size_t uiBlockCount = (iFaceCount + uiBlockSize - 1) / uiBlockSize;
+    std::vector<double> vecBlockSum(uiBlockCount);
+    auto dotProduct = [&](const Eigen::VectorXd& a, const Eigen::VectorXd& b) {
+        parallel_for(0, uiBlockCount, [&](std::size_t uiBlock) {
+            std::size_t uiEnd = std::min<std::size_t>(iFaceCount, (uiBlock + 1) * uiBlockSize);
+            double d = 0.0;
+            for (std::size_t i = uiBlock * uiBlockSize; i < uiEnd; i++)
+            {
+                d += a[i] * b[i];
+            }
+            vecBlockSum[uiBlock] = d;
+        }, m_uiThreadCount, 4);
+        double dSum = 0.0;
+        for (double d : vecBlockSum)
+        {
+            dSum += d;
+        }
+        return dSum;
+    };
+
+    // preconditioned conjugate gradient, one column at a time
+    Eigen::VectorXd x(iFaceCount), r(iFaceCount), z(iFaceCount), p(iFaceCount), Ap(iFaceCount);
+    for (int j = 0; j < 3; j++)
+    {
+        Eigen::VectorXd b = right_term.col(j);
+        x = solution.col(j);
+        const double dNormB = std::sqrt(dotProduct(b, b));
+        if (dNormB == 0.0)
+        {
+            solution.col(j).setZero();
+            continue;
+        }
+
+        applyA(x, Ap);
+        r = b - Ap;
+        z = r.cwiseProduct(vecInvDiag);
+        p = z;
+        double dRz = dotProduct(r, z);
+        double dResidual = std::sqrt(dotProduct(r, r)) / dNormB;
+        int iter = 0;
+        while (iter < m_iSolverMaxIterations && dResidual > m_dSolverTolerance)
+        {
+            applyA(p, Ap);
+            const double dAlpha = dRz / dotProduct(p, Ap);
+            x += dAlpha * p;
+            r -= dAlpha * Ap;
+            ++iter;
+
+            dResidual = std::sqrt(dotProduct(r, r)) / dNormB;
+            if (dResidual <= m_dSolverTolerance)
             {
-                Point cj = vecFaceCentroid[ff.idx()];
-                dSigmaC += norm(ci - cj);
-                dNum++;
+                break;
             }
+            z = r.cwiseProduct(vecInvDiag);
+            const double dRzNew = dotProduct(r, z);
+            p = z + (dRzNew / dRz) * p;
+            dRz = dRzNew;
         }
+        solution.col(j) = x;
+        m_SolverReport.iIterations = std::max(m_SolverReport.iIterations, iter);
+        m_SolverReport.dResidual = std::max(m_SolverReport.dResidual, dResidual);
+    }
+}
+
+double BilaterialDenoise::CaculateSigmaC(const std::vector<Point>& vecFaceCentroid, double dValue)
+{
+    // the edge rings are walked rather than taken from GetFaceNeighborhood(), which the local scheme does not build
+    double dSigmaC = 0.0;
+    double dNum = 0.0;
+    for (int i = 0; i < (int)vecFaceCentroid.size(); i++)
+    {
+        const Point& ci = vecFaceCentroid[i];
+        ForEachRingNeighbor(*m_pMesh, i, [&](int j) {
+            dSigmaC += norm(ci - vecFaceCentroid[j]);
+            dNum++;
+        });
+    }
+    if (dNum > 0.0)
+    {
+        dSigmaC *= dValue / dNum;
     }
-    dSigmaC *= dValue / dNum;
     return dSigmaC;
 }
 
 void BilaterialDenoise::UpdateVertexPosition(SurfaceMesh& mesh, std::vector<Normal>& vecFilteredNormal, int iIterationNumber, bool bFixedBoundary)
 {
-    auto vpoint = mesh.get_vertex_property<vec3>("v:point");
-    std::vector<vec3> vecNewVertex(mesh.vertices_size());
-    std::vector<vec3> vecCentroid(mesh.faces_size(), vec3(0.0, 0.0, 0.0));
+    const int iVertexCount = static_cast<int>(mesh.vertices_size());
+    const int iFaceCount = static_cast<int>(mesh.faces_size());
+    std::vector<vec3>& vecPoint = mesh.points();
 
-    for (int i = 0; i < iIterationNumber; i++)
+    // Flat vertex -> face incidence, built once so that the iterations do not go through the
+    // circulators. The incident faces of a vertex are stored in circulator order.
+    std::vector<int> vecVertexFaceOffset(iVertexCount + 1, 0);
+    std::vector<int> vecVertexFace;
+    vecVertexFace.reserve(3 * mesh.n_faces());
+    std::vector<char> vecMovable(iVertexCount, 0);
+    for (int i = 0; i < iVertexCount; i++)
     {
-        for (auto f : m_Mesh.faces())
+        SurfaceMesh::Vertex v(i);
+        if (!mesh.is_deleted(v))
         {
-            vecCentroid[f.idx()] = geom::centroid(&m_Mesh, f);
+            for (auto f : mesh.faces(v))
+            {
+                vecVertexFace.push_back(f.idx());
+            }
+            vecMovable[i] = !(bFixedBoundary && mesh.is_border(v));
         }
+        vecVertexFaceOffset[i + 1] = static_cast<int>(vecVertexFace.size());
+    }
 
-        for (auto v : m_Mesh.vertices())
-        {
-            auto p = vpoint[v];
-            if (bFixedBoundary && mesh.is_border(v))
+    // A vertex moves towards the planes through the face centroids along the filtered normals:
+    //     p += mean over its faces f of n_f * (dot(n_f, c_f) - dot(n_f, p))
+    // so each iteration only keeps the offset dot(n_f, c_f) of every face rather than its centroid.
+    const double dTolerance = m_dVertexTolerance * mesh.bounding_box(true).diagonal_length();
+    std::vector<vec3> vecNewVertex(iVertexCount);
+    std::vector<float> vecPlaneOffset(iFaceCount, 0.0f);
+    std::vector<float> vecChunkDisplacement(std::max(1u, m_uiThreadCount ? m_uiThreadCount : default_thread_count()));
+
+    int iter = 0;
+    double dMaxDisplacement = 0.0;
+    for (; iter < iIterationNumber; iter++)
+    {
+        parallel_for_chunks(0, iFaceCount, [&](std::size_t uiBegin, std::size_t uiEnd, unsigned int) {
+            for (int i = (int)uiBegin; i < (int)uiEnd; i++)
             {
-                vecNewVertex[v.idx()] = p;
+                SurfaceMesh::Face f(i);
+                if (mesh.is_deleted(f))
+                {
+                    continue;
+                }
+                const Normal& n = vecFilteredNormal[i];
+                double dOffset = 0.0;
+                int iValence = 0;
+                for (auto v : mesh.vertices(f))
+                {
+                    const vec3& p = vecPoint[v.idx()];
+                    dOffset += (double)n.x * p.x + (double)n.y * p.y + (double)n.z * p.z;
+                    iValence++;
+                }
+                vecPlaneOffset[i] = static_cast<float>(dOffset / iValence);
             }
-            else
+        }, m_uiThreadCount);
+
+        std::fill(vecChunkDisplacement.begin(), vecChunkDisplacement.end(), 0.0f);
+        parallel_for_chunks(0, iVertexCount, [&](std::size_t uiBegin, std::size_t uiEnd, unsigned int uiChunk) {
+            float fMaxDisplacement2 = 0.0f;
+            for (int i = (int)uiBegin; i < (int)uiEnd; i++)
             {
-                double dFaceNum = 0.0;
+                const int iBegin = vecVertexFaceOffset[i], iEnd = vecVertexFaceOffset[i + 1];
+                const vec3& p = vecPoint[i];
+                if (!vecMovable[i] || iBegin == iEnd)
+                {
+                    vecNewVertex[i] = p;
+                    continue;
+                }
                 Point temp(0.0, 0.0, 0.0);
-                for (auto f : mesh.faces(v))
+                for (int k = iBegin; k < iEnd; k++)
                 {
-                    auto tempNormal = vecFilteredNormal[f.idx()];
-                    auto tempCentroid = vecCentroid[f.idx()];
-                    temp += tempNormal * dot(tempNormal, tempCentroid - p);
-                    dFaceNum++;
+                    const Normal& tempNormal = vecFilteredNormal[vecVertexFace[k]];
+                    temp += tempNormal * (vecPlaneOffset[vecVertexFace[k]] - dot(tempNormal, p));
                 }
-                p += temp / dFaceNum;
-                vecNewVertex[v.idx()] = p;
+                temp /= float(iEnd - iBegin);
+                vecNewVertex[i] = p + temp;
+                fMaxDisplacement2 = std::max(fMaxDisplacement2, length2(temp));
             }
-        }
-        for (auto v : m_Mesh.vertices())
+            vecChunkDisplacement[uiChunk] = fMaxDisplacement2;
+        }, m_uiThreadCount);
+        vecPoint.swap(vecNewVertex);
+
+        dMaxDisplacement = std::sqrt(*std::max_element(vecChunkDisplacement.begin(), vecChunkDisplacement.end()));
+        if (dMaxDisplacement < dTolerance || !ReportProgress(70 + 30 * (iter + 1) / iIterationNumber))
         {
-            vpoint[v] = vecNewVertex[v.idx()];
+            iter++;
+            break;
         }
     }
-    mesh.collect_garbage();
+    std::cout << "UpdateVertexPosition: " << iter << " iteration(s), last max displacement: " << dMaxDisplacement << std::endl;
+
+    mesh.mark_positions_changed();
+    mesh.invalidate_bounding_box();
+    if (mesh.has_garbage())
+    {
+        mesh.collect_garbage();
+    }
 }
 
 void BilaterialDenoise::LocalScheme(std::vector<Normal>& vecFilteredNormal)
 {
-    vecFilteredNormal.resize(m_Mesh.n_faces());
+    // The edge rings are walked through the halfedges of the mesh rather than copied into a FaceNeighborhood,
+    // which would take 16 more bytes per triangle and stay cached after Denoise() (a global scheme run before
+    // may have left one).
+    ReleaseFaceNeighborhood();
+    const SurfaceMesh& mesh = *m_pMesh;
+
+    const int iFaceCount = static_cast<int>(m_vecFaceNormal.size());
+    const int iBlockCount = (iFaceCount + iWeightBlockSize - 1) / iWeightBlockSize;
 
     int iNormalIterationNumber = 20;
-    double dSigmaC = CaculateSigmaC(m_Mesh, m_vecFaceCentroid, 1.0);
+    double dSigmaC = CaculateSigmaC(m_vecFaceCentroid, 1.0);
     double dSigmaS = 0.35;
     std::cout << "dSigmaC: " << dSigmaC << std::endl;
 
-    for (int i = 0; i < iNormalIterationNumber; i++)
+    // The neighbours of the faces of block b (faces [b * iWeightBlockSize, (b + 1) * iWeightBlockSize)) are the
+    // entries [vecBlockOffset[b], vecBlockOffset[b + 1]) of the weight arrays, in walk order.
+    std::vector<int> vecBlockOffset(iBlockCount + 1, 0);
+    parallel_for(0, iBlockCount, [&](std::size_t b) {
+        const int iBlockEnd = std::min(iFaceCount, static_cast<int>(b + 1) * iWeightBlockSize);
+        int iCount = 0;
+        for (int i = static_cast<int>(b) * iWeightBlockSize; i < iBlockEnd; i++)
+        {
+            ForEachRingNeighbor(mesh, i, [&iCount](int) { iCount++; });
+        }
+        vecBlockOffset[b + 1] = iCount;
+    }, m_uiThreadCount, 4);
+    for (int b = 0; b < iBlockCount; b++)
     {
-        for (auto f : m_Mesh.faces())
+        vecBlockOffset[b + 1] += vecBlockOffset[b];
+    }
+
+    // The centroids and areas do not change while the normals are filtered, so the spatial part of
+    // the weight (area * spatial Gaussian) is evaluated once per neighbour and each sweep only
+    // evaluates the range Gaussian. The centroids, the areas and the second normal buffer are never
+    // allocated at the same time, which keeps the peak at two normals and the spatial weights
+    // (about 36 bytes per triangle).
+    const float fSpatialFactor = static_cast<float>(-0.5 / (dSigmaC * dSigmaC));
+    const float fRangeFactor = static_cast<float>(-0.5 / (dSigmaS * dSigmaS));
+    std::vector<float> vecSpatialWeight(vecBlockOffset[iBlockCount]);
+    parallel_for_chunks(0, iBlockCount, [&](std::size_t uiBegin, std::size_t uiEnd, unsigned int) {
+        WeightBatch batch;
+        for (std::size_t b = uiBegin; b < uiEnd; b++)
         {
-            int iIndexI = f.idx();
-            Normal NormalI = m_vecFaceNormal[iIndexI];
-            Point ptCentroidI = m_vecFaceCentroid[iIndexI];
+            const int iBlock = static_cast<int>(b) * iWeightBlockSize;
+            const int iBlockEnd = std::min(iFaceCount, iBlock + iWeightBlockSize);
+            EvaluateRingWeights(m_WeightKernel, mesh, m_vecFaceCentroid, iBlock, iBlockEnd, nullptr,
+                                fSpatialFactor, batch, vecSpatialWeight.data() + vecBlockOffset[b]);
+        }
+    }, m_uiThreadCount, 4);
+    std::vector<Point>().swap(m_vecFaceCentroid);
 
-            std::vector<SurfaceMesh::Face> vecFace;
-            auto halfedgeOfEachFace = m_Mesh.halfedges(f);
-            for (auto h : halfedgeOfEachFace)
+    m_vecFaceArea = GetFaceArea(*m_pMesh);
+    parallel_for(0, iBlockCount, [&](std::size_t b) {
+        const int iBlockEnd = std::min(iFaceCount, static_cast<int>(b + 1) * iWeightBlockSize);
+        float* pSpatial = vecSpatialWeight.data() + vecBlockOffset[b];
+        for (int i = static_cast<int>(b) * iWeightBlockSize; i < iBlockEnd; i++)
+        {
+            ForEachRingNeighbor(mesh, i, [&](int j) { *pSpatial++ *= m_vecFaceArea[j]; });
+        }
+    }, m_uiThreadCount, 4);
+    std::vector<float>().swap(m_vecFaceArea);
+    vecFilteredNormal.resize(iFaceCount);
+
+    // Jacobi-style sweeps over two buffers: a face only reads the normals of the previous sweep and
+    // always visits its neighbours in the same order, so the result does not depend on how the faces
+    // are distributed over the threads.
+    std::vector<Normal>& vecCurrent = m_vecFaceNormal;
+    std::vector<Normal>& vecNext = vecFilteredNormal;
+
+    StopWatch watch;
+    unsigned int uiThreadsUsed = 1;
+    int iSweeps = 0;
+    for (int iter = 0; iter < iNormalIterationNumber; iter++)
+    {
+        uiThreadsUsed = parallel_for_chunks(0, iBlockCount, [&](std::size_t uiBegin, std::size_t uiEnd, unsigned int) {
+            WeightBatch batch;
+            std::vector<float> vecWeight;
+            for (std::size_t b = uiBegin; b < uiEnd; b++)
             {
-                auto oh = m_Mesh.opposite(h);
-                auto ff = m_Mesh.face(oh);
-                if (ff.is_valid())
+                const int iBlock = static_cast<int>(b) * iWeightBlockSize;
+                const int iBlockEnd = std::min(iFaceCount, iBlock + iWeightBlockSize);
+                vecWeight.resize(vecBlockOffset[b + 1] - vecBlockOffset[b]);
+                EvaluateRingWeights(m_WeightKernel, mesh, vecCurrent, iBlock, iBlockEnd,
+                                    vecSpatialWeight.data() + vecBlockOffset[b], fRangeFactor, batch, vecWeight.data());
+
+                int k = 0;
+                for (int i = iBlock; i < iBlockEnd; i++)
                 {
-                    vecFace.push_back(ff);
-                }
-            }
+                    double dSumX = 0.0, dSumY = 0.0, dSumZ = 0.0;
+                    double dWeightSum = 0.0;
+                    for (; k < batch.vecRingEnd[i - iBlock]; k++)
+                    {
+                        const Normal& NormalJ = vecCurrent[batch.vecFace[k]];
+                        double dWeight = vecWeight[k];
+                        dWeightSum += dWeight;
+                        dSumX += dWeight * NormalJ.x;
+                        dSumY += dWeight * NormalJ.y;
+                        dSumZ += dWeight * NormalJ.z;
+                    }
 
-            Normal tempNormal(0.0, 0.0, 0.0);
-            double dWeightSum = 0.0;
-            for (int i = 0; i < vecFace.size(); i++)
-            {
-                int iIndexJ = vecFace[i].idx();
-                Normal NormalJ = m_vecFaceNormal[iIndexJ];
-                Point ptCentroidJ = m_vecFaceCentroid[iIndexJ];
-
-                double dSpatialDistance = norm(ptCentroidI - ptCentroidJ);
-                double dSpatialWeight =
-                    std::exp(-0.5 * dSpatialDistance * dSpatialDistance /
-                             (dSigmaC * dSigmaC));
-                double dRangeDistance = norm(NormalI - NormalJ);
-                double dRangeWeight =
-                    std::exp(-0.5 * dRangeDistance * dRangeDistance /
-                             (dSigmaS * dSigmaS));
-
-                double dWeight =
-                    m_vecFaceArea[iIndexJ] * dSpatialWeight * dRangeWeight;
-                dWeightSum += dWeight;
-                tempNormal += NormalJ * dWeight;
+                    if (dWeightSum > 0.0)
+                    {
+                        Normal tempNormal(static_cast<float>(dSumX / dWeightSum),
+                                          static_cast<float>(dSumY / dWeightSum),
+                                          static_cast<float>(dSumZ / dWeightSum));
+                        vecNext[i] = tempNormal.normalize();
+                    }
+                    else
+                    {
+                        // isolated (or deleted) face: there is nothing to average with
+                        vecNext[i] = vecCurrent[i];
+                    }
+                }
             }
-            tempNormal /= dWeightSum;
-            tempNormal.normalize();
-            vecFilteredNormal[iIndexI] = tempNormal;
+        }, m_uiThreadCount, 4);
+        vecCurrent.swap(vecNext);
+        iSweeps++;
+        if (!ReportProgress(10 + 60 * (iter + 1) / iNormalIterationNumber))
+        {
+            break;
         }
-        m_vecFaceNormal = vecFilteredNormal;
     }
+    // the input normals have been consumed by the sweeps, so the buffer is handed over instead of copied
+    vecFilteredNormal.swap(vecCurrent);
+    std::vector<Normal>().swap(m_vecFaceNormal);
+
+    // run with SetThreadCount(1) to get the serial reference timing
+    std::cout << "LocalScheme: " << iSweeps << " sweeps over " << iFaceCount << " faces with "
+              << uiThreadsUsed << " thread(s) and the " << GaussianWeightKernel::GetTypeName(m_WeightKernel.GetType())
+              << " weight kernel took " << watch.time_string() << std::endl;
 }
 
 void BilaterialDenoiseExecute(SurfaceMesh& mesh)
@@ -1,11 +1,31 @@
 #pragma once
 
 #include "base_denoise.h"
+#include "gaussian_weight.h"
+#include "../util/progress.h"
+#include <Eigen/Dense>
 
 namespace MV
 {
 void BilaterialDenoiseExecute(SurfaceMesh& mesh);
 
+// linear solver used by the global scheme for ((1 - s) * M^T * M + s * I) x = s * n
+enum class GlobalSolverType
+{
+    Sparse_LU,                                  // direct factorization of the assembled matrix
+    Conjugate_Gradient_Jacobi,                  // CG on the assembled matrix, diagonal preconditioner
+    Conjugate_Gradient_Incomplete_Cholesky,     // CG on the assembled matrix, incomplete Cholesky preconditioner
+    Conjugate_Gradient_Matrix_Free              // Jacobi-preconditioned CG applying the operator from the face adjacency
+};
+
+// statistics of the last global solve (the iterative solvers report their worst column)
+struct GlobalSolverReport
+{
+    int iIterations = 0;
+    double dResidual = 0.0;     // relative residual |Ax - b| / |b|
+    double dSeconds = 0.0;
+};
+
 class BilaterialDenoise : public BaseDenoise
 {
 public:
@@ -18,17 +38,51 @@ public:
     void LocalScheme(std::vector<Normal>& vecFilteredNormal);
     void GlobalScheme(std::vector<Normal>& vecFilteredNormal);
 
+    // number of worker threads used by the filters (0: all hardware threads, 1: serial)
+    void SetThreadCount(unsigned int uiThreadCount) { m_uiThreadCount = uiThreadCount; }
+    unsigned int GetThreadCount() const { return m_uiThreadCount; }
+
+    void SetGlobalSolver(GlobalSolverType eType) { m_eGlobalSolver = eType; }
+    void SetSolverTolerance(double dTolerance) { m_dSolverTolerance = dTolerance; }
+    void SetSolverMaxIterations(int iMaxIterations) { m_iSolverMaxIterations = iMaxIterations; }
+    const GlobalSolverReport& GetSolverReport() const { return m_SolverReport; }
+
+    // evaluation of the spatial and range Gaussians (Auto: the fastest SIMD path of the CPU)
+    void SetWeightKernel(WeightKernelType eType) { m_WeightKernel.SetType(eType); }
+    WeightKernelType GetWeightKernel() const { return m_WeightKernel.GetType(); }
+
+    // the vertex update stops once no vertex moves more than this fraction of the bounding box diagonal
+    void SetVertexTolerance(double dTolerance) { m_dVertexTolerance = dTolerance; }
+
+    // true if the last Denoise() was canceled through its ProgressLogger (the mesh is then unchanged,
+    // or only partially updated if the cancellation came during the vertex update)
+    bool IsCanceled() const { return m_bCanceled; }
+
 private:
-    SurfaceMesh m_Mesh;
+    const SurfaceMesh* m_pMesh;  // the mesh being denoised (only valid during Denoise())
     std::vector<Normal> m_vecFaceNormal;
     std::vector<float> m_vecFaceArea;
     std::vector<Point> m_vecFaceCentroid;
     DenoiseType m_eDenoiseType;
+    unsigned int m_uiThreadCount;
+
+    GlobalSolverType m_eGlobalSolver;
+    double m_dSolverTolerance;
+    int m_iSolverMaxIterations;
+    GlobalSolverReport m_SolverReport;
+    double m_dVertexTolerance;
+    GaussianWeightKernel m_WeightKernel;
+    ProgressLogger* m_pProgress;  // progress of Denoise() (only valid during Denoise())
+    bool m_bCanceled;
 
 private:
-    double CaculateSigmaC(SurfaceMesh& mesh, std::vector<Point> vecFaceCentroid, double dValue);
+    bool ReportProgress(std::size_t uiPercent);
+    double CaculateSigmaC(const std::vector<Point>& vecFaceCentroid, double dValue);
+    void SolveGlobalAssembled(const std::vector<double>& vecWeight, double dSmoothness,
+                              const Eigen::MatrixX3d& right_term, Eigen::MatrixX3d& solution);
+    void SolveGlobalMatrixFree(const std::vector<double>& vecWeight, double dSmoothness,
+                               const Eigen::MatrixX3d& right_term, Eigen::MatrixX3d& solution);
     
 };
 
 }
-
@@ -0,0 +1,300 @@
+#include "gaussian_weight.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MV_GAUSSIAN_WEIGHT_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC accepts AVX2 intrinsics in any function; gcc/clang need the target enabled per function,
+// so the rest of the file does not require -mavx2.
+#if defined(MV_GAUSSIAN_WEIGHT_X86) && (defined(__GNUC__) || defined(__clang__))
+#define MV_TARGET_AVX2 __attribute__((target("avx2")))
+#define MV_TARGET_SSE2 __attribute__((target("sse2")))
+#else
+#define MV_TARGET_AVX2
+#define MV_TARGET_SSE2
+#endif
+
+namespace MV
+{
+
+namespace
+{
+    // exp(x) = 2^n * exp(r) with n = round(x / ln2) and |r| <= ln2 / 2 (Cody-Waite reduction),
+    // exp(r) from the degree 6 polynomial of Cephes' expf.
+    const float fExpLow = -86.0f;   // keeps the biased exponent of the result >= 1 (no denormals)
+    const float fExpHigh = 88.0f;
+    const float fLog2E = 1.44269504088896341f;
+    const float fLn2Hi = 0.693359375f;
+    const float fLn2Lo = -2.12194440e-4f;
+    const float fP0 = 1.9875691500e-4f;
+    const float fP1 = 1.3981999507e-3f;
+    const float fP2 = 8.3334519073e-3f;
+    const float fP3 = 4.1665795894e-2f;
+    const float fP4 = 1.6666665459e-1f;
+    const float fP5 = 5.0000001201e-1f;
+
+#ifdef MV_GAUSSIAN_WEIGHT_X86
+    bool CpuHasSSE2()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        return (info[3] & (1 << 26)) != 0;
+#else
+        return __builtin_cpu_supports("sse2");
+#endif
+    }
+
+    bool CpuHasAVX2()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+        __cpuid(info, 1);
+        const bool bOSXSave = (info[2] & (1 << 27)) != 0;
+        const bool bAVX = (info[2] & (1 << 28)) != 0;
+        // the OS must save the YMM registers on context switches
+        if (!bOSXSave || !bAVX || (_xgetbv(0) & 0x6) != 0x6)
+        {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    MV_TARGET_SSE2 __m128 FastExpSSE(__m128 x)
+    {
+        const __m128 mUnderflow = _mm_cmplt_ps(x, _mm_set1_ps(fExpLow));
+        x = _mm_min_ps(x, _mm_set1_ps(fExpHigh));
+        x = _mm_max_ps(x, _mm_set1_ps(fExpLow));
+
+        const __m128i n = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(fLog2E)));
+        const __m128 fn = _mm_cvtepi32_ps(n);
+        __m128 r = _mm_sub_ps(x, _mm_mul_ps(fn, _mm_set1_ps(fLn2Hi)));
+        r = _mm_sub_ps(r, _mm_mul_ps(fn, _mm_set1_ps(fLn2Lo)));
+
+        __m128 p = _mm_set1_ps(fP0);
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(fP1));
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(fP2));
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(fP3));
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(fP4));
+        p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(fP5));
+        p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, r), r), r), _mm_set1_ps(1.0f));
+
+        // multiply by 2^n by adding n to the exponent bits
+        const __m128i e = _mm_add_epi32(_mm_castps_si128(p), _mm_slli_epi32(n, 23));
+        return _mm_andnot_ps(mUnderflow, _mm_castsi128_ps(e));
+    }
+
+    MV_TARGET_SSE2 void EvaluateSSE(const float* pDX, const float* pDY, const float* pDZ, const float* pScale,
+                                    float fFactor, std::size_t uiCount, float* pWeight)
+    {
+        const __m128 mFactor = _mm_set1_ps(fFactor);
+        std::size_t k = 0;
+        for (; k + 4 <= uiCount; k += 4)
+        {
+            const __m128 dx = _mm_loadu_ps(pDX + k);
+            const __m128 dy = _mm_loadu_ps(pDY + k);
+            const __m128 dz = _mm_loadu_ps(pDZ + k);
+            const __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            __m128 w = FastExpSSE(_mm_mul_ps(mFactor, d2));
+            if (pScale)
+            {
+                w = _mm_mul_ps(w, _mm_loadu_ps(pScale + k));
+            }
+            _mm_storeu_ps(pWeight + k, w);
+        }
+        for (; k < uiCount; k++)
+        {
+            const float d2 = pDX[k] * pDX[k] + pDY[k] * pDY[k] + pDZ[k] * pDZ[k];
+            pWeight[k] = (pScale ? pScale[k] : 1.0f) * FastExp(fFactor * d2);
+        }
+    }
+
+    MV_TARGET_AVX2 __m256 FastExpAVX2(__m256 x)
+    {
+        const __m256 mUnderflow = _mm256_cmp_ps(x, _mm256_set1_ps(fExpLow), _CMP_LT_OQ);
+        x = _mm256_min_ps(x, _mm256_set1_ps(fExpHigh));
+        x = _mm256_max_ps(x, _mm256_set1_ps(fExpLow));
+
+        const __m256i n = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(fLog2E)));
+        const __m256 fn = _mm256_cvtepi32_ps(n);
+        __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(fn, _mm256_set1_ps(fLn2Hi)));
+        r = _mm256_sub_ps(r, _mm256_mul_ps(fn, _mm256_set1_ps(fLn2Lo)));
+
+        __m256 p = _mm256_set1_ps(fP0);
+        p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(fP1));
+        p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(fP2));
+        p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(fP3));
+        p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(fP4));
+        p = _mm256_add_ps(_mm256_mul_ps(p, r), _mm256_set1_ps(fP5));
+        p = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(p, r), r), r), _mm256_set1_ps(1.0f));
+
+        const __m256i e = _mm256_add_epi32(_mm256_castps_si256(p), _mm256_slli_epi32(n, 23));
+        return _mm256_andnot_ps(mUnderflow, _mm256_castsi256_ps(e));
+    }
+
+    MV_TARGET_AVX2 void EvaluateAVX2(const float* pDX, const float* pDY, const float* pDZ, const float* pScale,
+                                     float fFactor, std::size_t uiCount, float* pWeight)
+    {
+        const __m256 mFactor = _mm256_set1_ps(fFactor);
+        std::size_t k = 0;
+        for (; k + 8 <= uiCount; k += 8)
+        {
+            const __m256 dx = _mm256_loadu_ps(pDX + k);
+            const __m256 dy = _mm256_loadu_ps(pDY + k);
+            const __m256 dz = _mm256_loadu_ps(pDZ + k);
+            const __m256 d2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+                                            _mm256_mul_ps(dz, dz));
+            __m256 w = FastExpAVX2(_mm256_mul_ps(mFactor, d2));
+            if (pScale)
+            {
+                w = _mm256_mul_ps(w, _mm256_loadu_ps(pScale + k));
+            }
+            _mm256_storeu_ps(pWeight + k, w);
+        }
+        // the tail goes through the 4-wide path (and its scalar tail)
+        EvaluateSSE(pDX + k, pDY + k, pDZ + k, pScale ? pScale + k : nullptr, fFactor, uiCount - k, pWeight + k);
+    }
+#endif // MV_GAUSSIAN_WEIGHT_X86
+
+    void EvaluateScalar(const float* pDX, const float* pDY, const float* pDZ, const float* pScale,
+                        float fFactor, std::size_t uiCount, float* pWeight)
+    {
+        for (std::size_t k = 0; k < uiCount; k++)
+        {
+            const float d2 = pDX[k] * pDX[k] + pDY[k] * pDY[k] + pDZ[k] * pDZ[k];
+            pWeight[k] = (pScale ? pScale[k] : 1.0f) * std::exp(fFactor * d2);
+        }
+    }
+}
+
+float FastExp(float x)
+{
+    if (x < fExpLow)
+    {
+        return 0.0f;
+    }
+    if (x > fExpHigh)
+    {
+        x = fExpHigh;
+    }
+
+    const float fn = std::nearbyint(x * fLog2E);
+    const std::int32_t n = static_cast<std::int32_t>(fn);
+    float r = x - fn * fLn2Hi;
+    r = r - fn * fLn2Lo;
+
+    float p = fP0;
+    p = p * r + fP1;
+    p = p * r + fP2;
+    p = p * r + fP3;
+    p = p * r + fP4;
+    p = p * r + fP5;
+    p = p * r * r + r + 1.0f;
+
+    std::int32_t iBits;
+    std::memcpy(&iBits, &p, sizeof(float));
+    iBits += n * (1 << 23);
+    std::memcpy(&p, &iBits, sizeof(float));
+    return p;
+}
+
+GaussianWeightKernel::GaussianWeightKernel(WeightKernelType eType)
+{
+    SetType(eType);
+}
+
+void GaussianWeightKernel::SetType(WeightKernelType eType)
+{
+    if (eType == WeightKernelType::Auto || !IsSupported(eType))
+    {
+        if (IsSupported(WeightKernelType::AVX2) && eType != WeightKernelType::SSE)
+        {
+            eType = WeightKernelType::AVX2;
+        }
+        else if (IsSupported(WeightKernelType::SSE))
+        {
+            eType = WeightKernelType::SSE;
+        }
+        else
+        {
+            eType = WeightKernelType::Scalar;
+        }
+    }
+    m_eType = eType;
+}
+
+void GaussianWeightKernel::Evaluate(const float* pDX, const float* pDY, const float* pDZ, const float* pScale,
+                                    float fFactor, std::size_t uiCount, float* pWeight) const
+{
+    switch (m_eType)
+    {
+#ifdef MV_GAUSSIAN_WEIGHT_X86
+    case WeightKernelType::AVX2:
+        EvaluateAVX2(pDX, pDY, pDZ, pScale, fFactor, uiCount, pWeight);
+        break;
+    case WeightKernelType::SSE:
+        EvaluateSSE(pDX, pDY, pDZ, pScale, fFactor, uiCount, pWeight);
+        break;
+#endif
+    default:
+        EvaluateScalar(pDX, pDY, pDZ, pScale, fFactor, uiCount, pWeight);
+        break;
+    }
+}
+
+bool GaussianWeightKernel::IsSupported(WeightKernelType eType)
+{
+#ifdef MV_GAUSSIAN_WEIGHT_X86
+    static const bool bSSE = CpuHasSSE2();
+    static const bool bAVX2 = bSSE && CpuHasAVX2();
+#else
+    static const bool bSSE = false;
+    static const bool bAVX2 = false;
+#endif
+    switch (eType)
+    {
+    case WeightKernelType::Scalar:
+    case WeightKernelType::Auto:
+        return true;
+    case WeightKernelType::SSE:
+        return bSSE;
+    case WeightKernelType::AVX2:
+        return bAVX2;
+    }
+    return false;
+}
+
+const char* GaussianWeightKernel::GetTypeName(WeightKernelType eType)
+{
+    switch (eType)
+    {
+    case WeightKernelType::Scalar:
+        return "Scalar";
+    case WeightKernelType::SSE:
+        return "SSE";
+    case WeightKernelType::AVX2:
+        return "AVX2";
+    case WeightKernelType::Auto:
+        return "Auto";
+    }
+    return "Unknown";
+}
+
+}
@@ -0,0 +1,535 @@
+#include "mesh_decimation.h"
+#include "../core/heap.h"
+#include "../util/parallel.h"
+#include "../util/progress.h"
+#include "../util/stop_watch.h"
+#include <iostream>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace MV
+{
+	// orders the vertices of the queue by the error of their best collapse
+	class MeshDecimation::HeapInterface
+	{
+	public:
+		HeapInterface(std::vector<float>* pPriority, std::vector<int>* pPosition)
+			: m_pPriority(pPriority), m_pPosition(pPosition)
+		{
+		}
+
+		bool less(SurfaceMesh::Vertex v0, SurfaceMesh::Vertex v1) { return (*m_pPriority)[v0.idx()] < (*m_pPriority)[v1.idx()]; }
+		bool greater(SurfaceMesh::Vertex v0, SurfaceMesh::Vertex v1) { return (*m_pPriority)[v0.idx()] > (*m_pPriority)[v1.idx()]; }
+		int get_heap_position(SurfaceMesh::Vertex v) { return (*m_pPosition)[v.idx()]; }
+		void set_heap_position(SurfaceMesh::Vertex v, int iPosition) { (*m_pPosition)[v.idx()] = iPosition; }
+
+	private:
+		std::vector<float>* m_pPriority;
+		std::vector<int>* m_pPosition;
+	};
+
+	namespace
+	{
+		// the squared distance of p to the planes of quadric q
+		inline double EvaluateQuadric(const double* q, const vec3& p)
+		{
+			const double x = p.x, y = p.y, z = p.z;
+			return q[0] * x * x + 2.0 * q[1] * x * y + 2.0 * q[2] * x * z + 2.0 * q[3] * x
+				 + q[4] * y * y + 2.0 * q[5] * y * z + 2.0 * q[6] * y
+				 + q[7] * z * z + 2.0 * q[8] * z
+				 + q[9];
+		}
+
+		// the boundary planes weigh more than the planes of the faces
+		const double dBoundaryWeight = 10.0;
+
+		// The point of the smallest error of quadric q is only used if the determinant of its 3x3 part is at least
+		// this times the cube of its trace (the planes are then far from all sharing a direction, as on a flat or
+		// cylindrical patch), and if it is within dMaxPlacementDistance edge lengths of the midpoint.
+		const double dMinPlacementDeterminant = 1e-12;
+		const double dMaxPlacementDistance = 1.0;
+
+		// the point of the smallest error of quadric q; false if it is not well defined
+		inline bool MinimizeQuadric(const double* q, dvec3& p)
+		{
+			// the 3x3 part is [q0 q1 q2; q1 q4 q5; q2 q5 q7], the gradient vanishes at its solution for -(q3, q6, q8)
+			const double c0 = q[4] * q[7] - q[5] * q[5];
+			const double c1 = q[2] * q[5] - q[1] * q[7];
+			const double c2 = q[1] * q[5] - q[2] * q[4];
+			const double dDeterminant = q[0] * c0 + q[1] * c1 + q[2] * c2;
+			const double dTrace = q[0] + q[4] + q[7];
+			if (!(dDeterminant > dMinPlacementDeterminant * dTrace * dTrace * dTrace))
+			{
+				return false;
+			}
+			const double c4 = q[0] * q[7] - q[2] * q[2];
+			const double c5 = q[1] * q[2] - q[0] * q[5];
+			const double c8 = q[0] * q[4] - q[1] * q[1];
+			const double b0 = -q[3], b1 = -q[6], b2 = -q[8];
+			p = dvec3(c0 * b0 + c1 * b1 + c2 * b2, c1 * b0 + c4 * b1 + c5 * b2, c2 * b0 + c5 * b1 + c8 * b2) / dDeterminant;
+			return true;
+		}
+
+		// adds the squared distance to the plane through p with unit normal n, times dWeight, to quadric q
+		inline void AddPlane(double* q, const dvec3& n, const dvec3& p, double dWeight)
+		{
+			const double d = -dot(n, p);
+			q[0] += dWeight * n.x * n.x;
+			q[1] += dWeight * n.x * n.y;
+			q[2] += dWeight * n.x * n.z;
+			q[3] += dWeight * n.x * d;
+			q[4] += dWeight * n.y * n.y;
+			q[5] += dWeight * n.y * n.z;
+			q[6] += dWeight * n.y * d;
+			q[7] += dWeight * n.z * n.z;
+			q[8] += dWeight * n.z * d;
+			q[9] += dWeight * d * d;
+		}
+
+		// the normal of the triangle (p0, p1, p2) scaled by twice its area, and its squared longest edge
+		inline void TriangleShape(const vec3& p0, const vec3& p1, const vec3& p2, vec3& normal, double& dLongest2)
+		{
+			normal = cross(p1 - p0, p2 - p0);
+			dLongest2 = std::max(std::max(length2(p1 - p0), length2(p2 - p1)), length2(p0 - p2));
+		}
+	}
+
+	MeshDecimation::MeshDecimation(SurfaceMesh* mesh)
+	{
+		m_pMesh = mesh;
+		m_fMaxError = 0.0f;
+		m_fMaxNormalDeviation = 60.0f;
+		m_fMaxAspectRatio = 10.0f;
+		m_bOptimalPlacement = true;
+		m_bLockBoundary = true;
+		m_bCanceled = false;
+		m_uiThreadCount = 0;
+		m_pPoints = nullptr;
+		m_dMinCosNormal = -1.0;
+	}
+
+	MeshDecimation::~MeshDecimation()
+	{
+
+	}
+
+	unsigned int MeshDecimation::Decimate(unsigned int uiTargetFaces)
+	{
+		m_bCanceled = false;
+		m_Timings = DecimationTimings();
+		if (m_pMesh->n_faces() <= uiTargetFaces)
+		{
+			return 0;
+		}
+		if (!m_pMesh->is_triangle_mesh())
+		{
+			std::cout << "MeshDecimation: the mesh is not a triangle mesh" << std::endl;
+			return 0;
+		}
+		StopWatch watch;
+
+		const SurfaceMesh* pMesh = m_pMesh;
+		const unsigned int uiVertexCount = pMesh->vertices_size();
+		m_pPoints = &m_pMesh->points();
+		m_dMinCosNormal = m_fMaxNormalDeviation < 180.0f ? std::cos(m_fMaxNormalDeviation * M_PI / 180.0) : -2.0;
+		ComputeQuadrics();
+
+		m_vecPriority.assign(uiVertexCount, 0.0f);
+		m_vecTarget.assign(uiVertexCount, -1);
+		m_vecHeapPosition.assign(uiVertexCount, -1);
+		Heap<SurfaceMesh::Vertex, HeapInterface> heap(HeapInterface(&m_vecPriority, &m_vecHeapPosition));
+		heap.reserve(uiVertexCount);
+		auto enqueue = [&](SurfaceMesh::Vertex v, bool bCheckLegality) {
+			if (FindBestCollapse(v, bCheckLegality))
+			{
+				if (heap.is_stored(v))
+				{
+					heap.update(v);
+				}
+				else
+				{
+					heap.insert(v);
+				}
+			}
+			else if (heap.is_stored(v))
+			{
+				heap.remove(v);
+			}
+		};
+		m_vecCollapseError.resize(pMesh->halfedges_size());
+		m_vecCollapsePosition.resize(pMesh->halfedges_size());
+		{
+			// the collapses and the best one of each vertex are found in parallel, only the insertions into the
+			// queue are sequential
+			const SurfaceMesh::ReadScope scope(*pMesh);
+			parallel_for(0, pMesh->halfedges_size(), [&](std::size_t i) {
+				const SurfaceMesh::Halfedge h(static_cast<int>(i));
+				if (!pMesh->is_deleted(pMesh->edge(h)))
+				{
+					UpdateCollapse(h);
+				}
+			}, m_uiThreadCount, 1024);
+			parallel_for(0, uiVertexCount, [&](std::size_t i) {
+				const SurfaceMesh::Vertex v(static_cast<int>(i));
+				if (!pMesh->is_deleted(v))
+				{
+					FindBestCollapse(v, false);
+				}
+			}, m_uiThreadCount, 1024);
+		}
+		for (auto v : pMesh->vertices())
+		{
+			if (m_vecTarget[v.idx()] >= 0)
+			{
+				heap.insert(v);
+			}
+		}
+		m_Timings.dInitialize = watch.elapsed_seconds(4);
+
+		watch.restart();
+		const unsigned int uiInitialFaces = pMesh->n_faces();
+		ProgressLogger progress(uiInitialFaces - uiTargetFaces, false);
+		unsigned int uiCollapses = 0;
+		while (pMesh->n_faces() > uiTargetFaces && !heap.empty())
+		{
+			if (progress.is_canceled())
+			{
+				m_bCanceled = true;
+				break;
+			}
+
+			const SurfaceMesh::Vertex v0 = heap.front();
+			const SurfaceMesh::Halfedge h(m_vecTarget[v0.idx()]);
+			heap.pop_front();
+
+			// the queue only knows the cheapest collapse of each vertex, legal or not: most of them are, and
+			// testing them all on each update would cost several times more than the collapses. If this one is
+			// not, the vertex comes back with its cheapest legal collapse, which costs at least as much.
+			const vec3 position = m_vecCollapsePosition[h.idx()];
+			if (!IsCollapseLegal(h, position))
+			{
+				enqueue(v0, true);
+				continue;
+			}
+
+			const SurfaceMesh::Vertex v1 = pMesh->target(h);
+			m_pMesh->collapse(h);
+			(*m_pPoints)[v1.idx()] = position;
+			Quadric& q1 = m_vecQuadric[v1.idx()];
+			const Quadric& q0 = m_vecQuadric[v0.idx()];
+			for (int k = 0; k < 10; k++)
+			{
+				q1.a[k] += q0.a[k];
+			}
+			uiCollapses++;
+
+			// Only the collapses from or onto v1 have changed, so only the neighbours whose best collapse is gone
+			// or was onto v1 look for a new one. The others keep theirs: the quadric of v1 only grew, so a collapse
+			// onto v1 that was not their cheapest before rarely is now.
+			for (auto hv : pMesh->halfedges(v1))
+			{
+				UpdateCollapse(hv);
+				UpdateCollapse(pMesh->opposite(hv));
+			}
+			enqueue(v1, false);
+			for (auto hv : pMesh->halfedges(v1))
+			{
+				const SurfaceMesh::Vertex v = pMesh->target(hv);
+				const SurfaceMesh::Halfedge hTarget(m_vecTarget[v.idx()]);
+				if (!hTarget.is_valid() || pMesh->is_deleted(hTarget) || pMesh->target(hTarget) == v1)
+				{
+					enqueue(v, false);
+				}
+			}
+			progress.notify(uiInitialFaces - pMesh->n_faces());
+		}
+		m_Timings.dCollapse = watch.elapsed_seconds(4);
+
+		watch.restart();
+		m_pMesh->mark_positions_changed();
+		m_pMesh->collect_garbage();
+		m_Timings.dGarbage = watch.elapsed_seconds(4);
+
+		std::vector<Quadric>().swap(m_vecQuadric);
+		std::vector<float>().swap(m_vecPriority);
+		std::vector<int>().swap(m_vecTarget);
+		std::vector<float>().swap(m_vecCollapseError);
+		std::vector<vec3>().swap(m_vecCollapsePosition);
+		std::vector<int>().swap(m_vecHeapPosition);
+		m_pPoints = nullptr;
+
+		std::cout << "MeshDecimation: " << uiCollapses << " collapse(s), " << uiInitialFaces << " -> "
+				  << m_pMesh->n_faces() << " faces (initialize " << m_Timings.dInitialize << "s, collapses "
+				  << m_Timings.dCollapse << "s, garbage " << m_Timings.dGarbage << "s)"
+				  << (m_bCanceled ? ", canceled" : "") << std::endl;
+		return uiCollapses;
+	}
+
+	void MeshDecimation::ComputeQuadrics()
+	{
+		const SurfaceMesh* pMesh = m_pMesh;
+		const std::vector<vec3>& vecPoints = *m_pPoints;
+		const SurfaceMesh::ReadScope scope(*pMesh);
+
+		// the unit normal of each face and a point on it (a zero normal for a degenerate face)
+		const unsigned int uiFaceCount = pMesh->faces_size();
+		std::vector<std::pair<dvec3, dvec3>> vecPlane(uiFaceCount);
+		parallel_for(0, uiFaceCount, [&](std::size_t i) {
+			const SurfaceMesh::Face f(static_cast<int>(i));
+			std::pair<dvec3, dvec3>& plane = vecPlane[i];
+			plane.first = dvec3(0.0, 0.0, 0.0);
+			if (pMesh->is_deleted(f))
+			{
+				return;
+			}
+			SurfaceMesh::Halfedge h = pMesh->halfedge(f);
+			const dvec3 p0(vecPoints[pMesh->target(h).idx()]);
+			h = pMesh->next(h);
+			const dvec3 p1(vecPoints[pMesh->target(h).idx()]);
+			h = pMesh->next(h);
+			const dvec3 p2(vecPoints[pMesh->target(h).idx()]);
+			const dvec3 n = cross(p1 - p0, p2 - p0);
+			const double dLength = norm(n);
+			if (dLength > 0.0)
+			{
+				plane.first = n / dLength;
+				plane.second = p0;
+			}
+		}, m_uiThreadCount, 1024);
+
+		// Each vertex gets the planes of its incident faces. A boundary vertex that may move along the boundary
+		// also gets the plane through each of its boundary edges that is perpendicular to the face of the edge, so
+		// the boundary keeps its shape (the planes of the faces alone do not see a flat mesh shrink).
+		m_vecQuadric.resize(pMesh->vertices_size());
+		parallel_for(0, pMesh->vertices_size(), [&](std::size_t i) {
+			const SurfaceMesh::Vertex v(static_cast<int>(i));
+			double* q = m_vecQuadric[i].a;
+			std::fill(q, q + 10, 0.0);
+			if (pMesh->is_deleted(v) || pMesh->is_isolated(v))
+			{
+				return;
+			}
+			for (auto h : pMesh->halfedges(v))
+			{
+				const SurfaceMesh::Face f = pMesh->face(h);
+				if (f.is_valid())
+				{
+					AddPlane(q, vecPlane[f.idx()].first, vecPlane[f.idx()].second, 1.0);
+				}
+			}
+			if (m_bLockBoundary || !pMesh->is_border(v))
+			{
+				return;
+			}
+			for (auto h : pMesh->halfedges(v))
+			{
+				// the boundary edge is given by its border halfedge hb, whichever vertex it is seen from
+				const SurfaceMesh::Halfedge o = pMesh->opposite(h);
+				const SurfaceMesh::Halfedge hb = pMesh->is_border(h) ? h : (pMesh->is_border(o) ? o : SurfaceMesh::Halfedge());
+				if (!hb.is_valid())
+				{
+					continue;
+				}
+				const SurfaceMesh::Halfedge hf = pMesh->opposite(hb);
+				const dvec3 p0(vecPoints[pMesh->target(hb).idx()]), p1(vecPoints[pMesh->target(hf).idx()]);
+				const dvec3 p2(vecPoints[pMesh->target(pMesh->next(hf)).idx()]);
+				const dvec3 e = p1 - p0;
+				dvec3 n = cross(e, cross(e, p2 - p0));
+				const double dLength = norm(n);
+				if (dLength > 0.0)
+				{
+					AddPlane(q, n / dLength, p0, dBoundaryWeight);
+				}
+			}
+		}, m_uiThreadCount, 1024);
+	}
+
+	double MeshDecimation::CollapseError(SurfaceMesh::Halfedge h, vec3& position) const
+	{
+		// v0 is removed, v1 is moved to position
+		const SurfaceMesh::Vertex v0 = m_pMesh->source(h);
+		const SurfaceMesh::Vertex v1 = m_pMesh->target(h);
+		const double* q0 = m_vecQuadric[v0.idx()].a;
+		const double* q1 = m_vecQuadric[v1.idx()].a;
+		double q[10];
+		for (int k = 0; k < 10; k++)
+		{
+			q[k] = q0[k] + q1[k];
+		}
+
+		const vec3& p0 = (*m_pPoints)[v0.idx()];
+		const vec3& p1 = (*m_pPoints)[v1.idx()];
+		position = p1;
+		if (!m_bOptimalPlacement || (m_pMesh->is_border(v1) && (m_bLockBoundary || !m_pMesh->is_border(v0))))
+		{
+			return std::max(0.0, EvaluateQuadric(q, p1));
+		}
+
+		const dvec3 midpoint = 0.5 * (dvec3(p0) + dvec3(p1));
+		dvec3 optimum;
+		if (MinimizeQuadric(q, optimum) &&
+			length2(optimum - midpoint) <= dMaxPlacementDistance * dMaxPlacementDistance * length2(p1 - p0))
+		{
+			position = vec3(optimum);
+			return std::max(0.0, EvaluateQuadric(q, position));
+		}
+
+		// the best of the two ends and the midpoint
+		double dBest = EvaluateQuadric(q, p1);
+		for (const vec3& p : { p0, vec3(midpoint) })
+		{
+			const double dError = EvaluateQuadric(q, p);
+			if (dError < dBest)
+			{
+				dBest = dError;
+				position = p;
+			}
+		}
+		return std::max(0.0, dBest);
+	}
+
+	void MeshDecimation::UpdateCollapse(SurfaceMesh::Halfedge h)
+	{
+		m_vecCollapseError[h.idx()] = static_cast<float>(CollapseError(h, m_vecCollapsePosition[h.idx()]));
+	}
+
+	bool MeshDecimation::FindBestCollapse(SurfaceMesh::Vertex v, bool bCheckLegality)
+	{
+		const SurfaceMesh* pMesh = m_pMesh;
+		if (pMesh->is_isolated(v) || (m_bLockBoundary && pMesh->is_border(v)))
+		{
+			return false;
+		}
+
+		const double dMaxError2 = static_cast<double>(m_fMaxError) * m_fMaxError;
+		if (!bCheckLegality)
+		{
+			// only the boundary rule, which costs nothing
+			const bool bBorder = pMesh->is_border(v);
+			double dBest = std::numeric_limits<double>::max();
+			int iBest = -1;
+			for (auto h : pMesh->halfedges(v))
+			{
+				if (bBorder && !(pMesh->is_border(h) || pMesh->is_border(pMesh->opposite(h))))
+				{
+					continue;
+				}
+				const double dError = m_vecCollapseError[h.idx()];
+				if (dError < dBest && (m_fMaxError <= 0.0f || dError <= dMaxError2))
+				{
+					dBest = dError;
+					iBest = h.idx();
+				}
+			}
+			m_vecTarget[v.idx()] = iBest;
+			m_vecPriority[v.idx()] = static_cast<float>(dBest);
+			return iBest >= 0;
+		}
+
+		// the legality tests cost more than the errors, so they are only done in the order of the errors
+		// until one collapse passes
+		m_vecCandidate.clear();
+		for (auto h : pMesh->halfedges(v))
+		{
+			const float fError = m_vecCollapseError[h.idx()];
+			if (m_fMaxError <= 0.0f || fError <= dMaxError2)
+			{
+				m_vecCandidate.emplace_back(fError, h.idx());
+			}
+		}
+		std::sort(m_vecCandidate.begin(), m_vecCandidate.end());
+		for (const auto& candidate : m_vecCandidate)
+		{
+			const SurfaceMesh::Halfedge h(candidate.second);
+			if (IsCollapseLegal(h, m_vecCollapsePosition[h.idx()]))
+			{
+				m_vecPriority[v.idx()] = candidate.first;
+				m_vecTarget[v.idx()] = h.idx();
+				return true;
+			}
+		}
+		m_vecTarget[v.idx()] = -1;
+		return false;
+	}
+
+	bool MeshDecimation::IsCollapseLegal(SurfaceMesh::Halfedge h, const vec3& position) const
+	{
+		const SurfaceMesh* pMesh = m_pMesh;
+		const SurfaceMesh::Halfedge o = pMesh->opposite(h);
+		const SurfaceMesh::Vertex v0 = pMesh->target(o);
+		const SurfaceMesh::Vertex v1 = pMesh->target(h);
+		if (pMesh->is_deleted(h) || pMesh->is_deleted(v0) || pMesh->is_deleted(v1))
+		{
+			return false;
+		}
+
+		// a boundary vertex may only slide along the boundary
+		if (pMesh->is_border(v0))
+		{
+			if (m_bLockBoundary || !(pMesh->is_border(h) || pMesh->is_border(o)))
+			{
+				return false;
+			}
+		}
+
+		// the faces that remain around v0 and v1 (both moved to position) must not turn too much or get too thin
+		const SurfaceMesh::Face fl = pMesh->face(h);
+		const SurfaceMesh::Face fr = pMesh->face(o);
+		if (!IsMoveLegal(v0, position, fl, fr))
+		{
+			return false;
+		}
+		if (position != (*m_pPoints)[v1.idx()] && !IsMoveLegal(v1, position, fl, fr))
+		{
+			return false;
+		}
+
+		return pMesh->is_collapse_ok(h);
+	}
+
+	bool MeshDecimation::IsMoveLegal(SurfaceMesh::Vertex v, const vec3& position, SurfaceMesh::Face fl,
+									 SurfaceMesh::Face fr) const
+	{
+		const SurfaceMesh* pMesh = m_pMesh;
+		const std::vector<vec3>& vecPoints = *m_pPoints;
+		const vec3& p = vecPoints[v.idx()];
+		for (auto hv : pMesh->halfedges(v))
+		{
+			const SurfaceMesh::Face f = pMesh->face(hv);
+			if (!f.is_valid() || f == fl || f == fr)
+			{
+				continue;
+			}
+			const vec3& pa = vecPoints[pMesh->target(hv).idx()];
+			const vec3& pb = vecPoints[pMesh->target(pMesh->next(hv)).idx()];
+
+			vec3 nBefore, nAfter;
+			double dLongestBefore2, dLongestAfter2;
+			TriangleShape(p, pa, pb, nBefore, dLongestBefore2);
+			TriangleShape(position, pa, pb, nAfter, dLongestAfter2);
+			const double dAreaAfter = norm(nAfter);
+			if (dAreaAfter <= 0.0)
+			{
+				return false;
+			}
+			const double dAreaBefore = norm(nBefore);
+			if (dot(nBefore, nAfter) < m_dMinCosNormal * dAreaBefore * dAreaAfter)
+			{
+				return false;
+			}
+			if (m_fMaxAspectRatio > 0.0f)
+			{
+				// longest edge / shortest height = longest edge^2 / (2 * area)
+				const double dRatioAfter = dLongestAfter2 / dAreaAfter;
+				if (dRatioAfter > m_fMaxAspectRatio &&
+					(dAreaBefore <= 0.0 || dRatioAfter > dLongestBefore2 / dAreaBefore))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+}
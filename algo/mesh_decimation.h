@@ -0,0 +1,113 @@
+#pragma once
+
+#include "../core/surface_mesh.h"
+#include <vector>
+
+namespace MV
+{
+	// wall-clock time of the phases of the last decimation, in seconds
+	struct DecimationTimings
+	{
+		double dInitialize = 0.0;   // quadrics and the initial queue
+		double dCollapse = 0.0;
+		double dGarbage = 0.0;      // removal of the collapsed elements
+	};
+
+	// Quadric error metric simplification of triangle meshes (Garland and Heckbert 1997). The cheapest halfedge
+	// collapse is done first. The error of a vertex is the sum of the squared distances to the planes of the
+	// original faces merged into it; a collapse places the remaining vertex where this sum is the smallest (see
+	// SetOptimalPlacement()). The quadrics and the initial queue are computed in parallel; the collapses are
+	// sequential.
+	class MeshDecimation
+	{
+	public:
+		explicit MeshDecimation(SurfaceMesh* mesh);
+		~MeshDecimation();
+
+		// Collapses edges until the mesh has at most uiTargetFaces faces, or no collapse respects the limits
+		// below. Returns the number of collapses. The collapsed elements are removed (collect_garbage()).
+		unsigned int Decimate(unsigned int uiTargetFaces);
+
+		// Largest error of a collapse, as the root of the quadric error: the root of the sum of the squared
+		// distances of the new vertex to the planes of all the original faces merged into it (each face counts
+		// once for each of its vertices, and the plane of a boundary edge 10 times if the boundary is not locked).
+		// It is not a distance to the input: it grows with the number of merged planes, about as d * sqrt(k) for
+		// k planes at distance d. 0: no limit (default)
+		void SetMaxError(float fMaxError) { m_fMaxError = fMaxError; }
+		float GetMaxError() const { return m_fMaxError; }
+
+		// largest rotation of the normal of a face by a collapse, in degrees (default: 60); this also rejects
+		// the collapses that flip faces. 180: no limit
+		void SetMaxNormalDeviation(float fDegrees) { m_fMaxNormalDeviation = fDegrees; }
+		float GetMaxNormalDeviation() const { return m_fMaxNormalDeviation; }
+
+		// a collapse may not create a triangle whose aspect ratio (longest edge / shortest height) exceeds this,
+		// unless it was worse before (default: 10); 0: no limit
+		void SetMaxAspectRatio(float fMaxAspectRatio) { m_fMaxAspectRatio = fMaxAspectRatio; }
+		float GetMaxAspectRatio() const { return m_fMaxAspectRatio; }
+
+		// The vertex of a collapse is placed at the point of the smallest error if it is well defined, and
+		// otherwise at the best of the two ends and the midpoint of the edge (default: true). false: the removed
+		// vertex moves onto its neighbour. A vertex collapsed onto the boundary stays where it is.
+		void SetOptimalPlacement(bool bOptimalPlacement) { m_bOptimalPlacement = bOptimalPlacement; }
+		bool GetOptimalPlacement() const { return m_bOptimalPlacement; }
+
+		// boundary vertices are kept (default: true). Otherwise they may only collapse along the boundary.
+		void SetLockBoundary(bool bLockBoundary) { m_bLockBoundary = bLockBoundary; }
+		bool GetLockBoundary() const { return m_bLockBoundary; }
+
+		// 0: one thread per core
+		void SetThreadCount(unsigned int uiThreadCount) { m_uiThreadCount = uiThreadCount; }
+		unsigned int GetThreadCount() const { return m_uiThreadCount; }
+
+		// true if the last Decimate() was canceled through its ProgressLogger (the mesh is then partially
+		// decimated, but valid)
+		bool IsCanceled() const { return m_bCanceled; }
+
+		const DecimationTimings& GetTimings() const { return m_Timings; }
+
+	private:
+		// the symmetric 4x4 matrix of a quadric, upper triangle row by row
+		struct Quadric
+		{
+			double a[10];
+		};
+
+		class HeapInterface;
+
+		void ComputeQuadrics();
+		// finds the cheapest collapse of the halfedges leaving v; false if there is none. Without
+		// bCheckLegality, only the boundary rule of IsCollapseLegal() is applied.
+		bool FindBestCollapse(SurfaceMesh::Vertex v, bool bCheckLegality);
+		// the collapse of h with its vertex at position
+		bool IsCollapseLegal(SurfaceMesh::Halfedge h, const vec3& position) const;
+		// the faces around v, except fl and fr, with v moved to position
+		bool IsMoveLegal(SurfaceMesh::Vertex v, const vec3& position, SurfaceMesh::Face fl, SurfaceMesh::Face fr) const;
+		// the error of the collapse of h, and the position of its vertex
+		double CollapseError(SurfaceMesh::Halfedge h, vec3& position) const;
+		// stores the error and the position of the collapse of h
+		void UpdateCollapse(SurfaceMesh::Halfedge h);
+
+	private:
+		SurfaceMesh* m_pMesh;
+		float m_fMaxError;
+		float m_fMaxNormalDeviation;
+		float m_fMaxAspectRatio;
+		bool m_bOptimalPlacement;
+		bool m_bLockBoundary;
+		bool m_bCanceled;
+		unsigned int m_uiThreadCount;
+		DecimationTimings m_Timings;
+
+		// only valid during Decimate()
+		std::vector<vec3>* m_pPoints;
+		double m_dMinCosNormal;
+		std::vector<Quadric> m_vecQuadric;
+		std::vector<float> m_vecPriority;        // the error of the best collapse of each vertex
+		std::vector<int> m_vecTarget;            // the halfedge of this collapse (-1: none)
+		std::vector<int> m_vecHeapPosition;
+		std::vector<float> m_vecCollapseError;   // the error of the collapse of each halfedge
+		std::vector<vec3> m_vecCollapsePosition; // the position of its vertex
+		std::vector<std::pair<float, int>> m_vecCandidate;
+	};
+}
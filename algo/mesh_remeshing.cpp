@@ -0,0 +1,482 @@
+#include "mesh_remeshing.h"
+#include "../core/surface_mesh_curvature.h"
+#include "../core/property_keys.h"
+#include "../util/parallel.h"
+#include "../util/progress.h"
+#include "../util/stop_watch.h"
+#include <iostream>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+namespace MV
+{
+	namespace
+	{
+		// the bounds of the edge lengths, relative to their target length
+		const float kLongRatio = 4.0f / 3.0f;
+		const float kShortRatio = 4.0f / 5.0f;
+
+		// a boundary vertex is only removed if the boundary turns by less than 10 degrees there
+		const float kBoundaryCos = 0.985f;
+
+		inline int TargetValence(const SurfaceMesh* pMesh, SurfaceMesh::Vertex v)
+		{
+			return pMesh->is_border(v) ? 4 : 6;
+		}
+	}
+
+	MeshRemeshing::MeshRemeshing(SurfaceMesh* mesh)
+	{
+		m_pMesh = mesh;
+		m_uiThreadCount = 0;
+	}
+
+	MeshRemeshing::~MeshRemeshing()
+	{
+
+	}
+
+	void MeshRemeshing::UniformRemeshing(float fEdgeLength, unsigned int uiIterations)
+	{
+		if (fEdgeLength <= 0.0f)
+		{
+			std::cout << "MeshRemeshing: the edge length must be positive" << std::endl;
+			return;
+		}
+		m_Timings = RemeshingTimings();
+		StopWatch watch;
+		m_vecReferenceSizing.assign(m_pMesh->vertices_size(), fEdgeLength);
+		if (!Setup())
+		{
+			return;
+		}
+		m_Timings.dSetup = watch.elapsed_seconds(4);
+		Remesh(uiIterations);
+	}
+
+	void MeshRemeshing::AdaptiveRemeshing(float fMinEdgeLength, float fMaxEdgeLength, float fApproxError,
+										  unsigned int uiIterations)
+	{
+		if (fMinEdgeLength <= 0.0f || fMaxEdgeLength < fMinEdgeLength || fApproxError <= 0.0f)
+		{
+			std::cout << "MeshRemeshing: invalid edge lengths or error" << std::endl;
+			return;
+		}
+		if (!m_pMesh->is_triangle_mesh())
+		{
+			std::cout << "MeshRemeshing: the mesh is not a triangle mesh" << std::endl;
+			return;
+		}
+		m_Timings = RemeshingTimings();
+		StopWatch watch;
+
+		// The curvatures are smoothed and clamped, so that noise does not refine the whole mesh. They are stored
+		// in the properties of keys::v_curv_*, so those the mesh already has are set aside meanwhile.
+		const std::string strCurvatures[4] = { keys::v_curv_min.name(), keys::v_curv_max.name(),
+											   keys::v_curv_mean.name(), keys::v_curv_gauss.name() };
+		bool bSetAside[4];
+		for (int k = 0; k < 4; k++)
+		{
+			bSetAside[k] = m_pMesh->rename_vertex_property(strCurvatures[k], strCurvatures[k] + ":remesh-aside");
+		}
+		geom::vertex_curvatures(m_pMesh, 2, 0.05f, m_uiThreadCount);
+		auto kmin = m_pMesh->get_vertex_property<float>(strCurvatures[0]);
+		auto kmax = m_pMesh->get_vertex_property<float>(strCurvatures[1]);
+
+		// An equilateral triangle with edges of length h, whose corners are on a sphere of radius r, is at most
+		// r - sqrt(r^2 - h^2 / 3) away from it; solving for the error e gives h = sqrt(6 e r - 3 e^2).
+		const double e = fApproxError;
+		m_vecReferenceSizing.assign(m_pMesh->vertices_size(), fMaxEdgeLength);
+		for (auto v : m_pMesh->vertices())
+		{
+			const double c = std::max(std::abs(kmin[v]), std::abs(kmax[v]));
+			double h = fMaxEdgeLength;
+			if (c > 1e-10)
+			{
+				const double d = 6.0 * e / c - 3.0 * e * e;
+				h = d > 0.0 ? std::sqrt(d) : fMinEdgeLength;
+			}
+			m_vecReferenceSizing[v.idx()] = static_cast<float>(std::min<double>(std::max<double>(h, fMinEdgeLength),
+																				 fMaxEdgeLength));
+		}
+
+		for (int k = 0; k < 4; k++)
+		{
+			m_pMesh->remove_vertex_property(strCurvatures[k]);
+			if (bSetAside[k])
+			{
+				m_pMesh->rename_vertex_property(strCurvatures[k] + ":remesh-aside", strCurvatures[k]);
+			}
+		}
+
+		if (!Setup())
+		{
+			return;
+		}
+		m_Timings.dSetup = watch.elapsed_seconds(4);
+		Remesh(uiIterations);
+	}
+
+	bool MeshRemeshing::Setup()
+	{
+		if (!m_pMesh->is_triangle_mesh())
+		{
+			std::cout << "MeshRemeshing: the mesh is not a triangle mesh" << std::endl;
+			return false;
+		}
+
+		// the input is the reference surface, onto which the vertices are projected
+		const SurfaceMesh* pMesh = m_pMesh;
+		m_vecReferenceTriangle.clear();
+		m_vecReferenceTriangle.reserve(3 * pMesh->n_faces());
+		for (auto f : pMesh->faces())
+		{
+			for (auto v : pMesh->vertices(f))
+			{
+				m_vecReferenceTriangle.push_back(v.idx());
+			}
+		}
+		m_ReferenceTree.Build(pMesh->points(), m_vecReferenceTriangle);
+
+		m_Sizing = m_pMesh->add_vertex_property<float>("v:remesh-sizing");
+		if (!m_Sizing)
+		{
+			m_Sizing = m_pMesh->get_vertex_property<float>("v:remesh-sizing");
+		}
+		std::copy(m_vecReferenceSizing.begin(), m_vecReferenceSizing.end(), m_Sizing.vector().begin());
+		return true;
+	}
+
+	void MeshRemeshing::Remesh(unsigned int uiIterations)
+	{
+		const unsigned int uiInitialFaces = m_pMesh->n_faces();
+		ProgressLogger progress(uiIterations + 1, false);
+		for (unsigned int i = 0; i < uiIterations && !progress.is_canceled(); i++)
+		{
+			StopWatch watch;
+			SplitLongEdges();
+			m_Timings.dSplit += watch.elapsed_seconds(4);
+
+			watch.restart();
+			CollapseShortEdges();
+			m_Timings.dCollapse += watch.elapsed_seconds(4);
+
+			watch.restart();
+			EqualizeValences();
+			m_Timings.dFlip += watch.elapsed_seconds(4);
+
+			watch.restart();
+			TangentialRelaxation();
+			m_Timings.dRelax += watch.elapsed_seconds(4);
+			progress.next();
+		}
+
+		Finish();
+		progress.next();
+
+		std::cout << "MeshRemeshing: " << uiInitialFaces << " -> " << m_pMesh->n_faces() << " faces, edge lengths "
+				  << m_Statistics.fMinRatio << " to " << m_Statistics.fMaxRatio << " times their target ("
+				  << m_Statistics.uiShortEdges << " shorter than " << kShortRatio << "); setup " << m_Timings.dSetup
+				  << "s, split " << m_Timings.dSplit << "s, collapse " << m_Timings.dCollapse << "s, flip "
+				  << m_Timings.dFlip << "s, relax " << m_Timings.dRelax << "s" << std::endl;
+	}
+
+	void MeshRemeshing::Finish()
+	{
+		// without relaxation afterwards, the bound of the long edges holds for the result
+		StopWatch watch;
+		SplitLongEdges();
+		m_Timings.dSplit += watch.elapsed_seconds(4);
+		watch.restart();
+		CollapseShortEdges();
+		m_Timings.dCollapse += watch.elapsed_seconds(4);
+
+		ComputeStatistics();
+		m_pMesh->remove_vertex_property(m_Sizing);
+		m_ReferenceTree = TriangleTree();
+		std::vector<int>().swap(m_vecReferenceTriangle);
+		std::vector<float>().swap(m_vecReferenceSizing);
+	}
+
+	float MeshRemeshing::TargetLength(SurfaceMesh::Vertex v0, SurfaceMesh::Vertex v1) const
+	{
+		return 0.5f * (m_Sizing[v0] + m_Sizing[v1]);
+	}
+
+	void MeshRemeshing::SplitLongEdges()
+	{
+		// the edges created by a pass can still be too long, so the passes are repeated; each pass halves the
+		// lengths, which ends since no target length is below the smallest sizing
+		std::vector<char> vecLong;
+		std::vector<SurfaceMesh::Edge> vecEdge;
+		std::vector<vec3> vecPoint;
+		std::vector<float> vecSizing;
+		while (true)
+		{
+			const SurfaceMesh* pMesh = m_pMesh;
+			const std::size_t uiEdgeCount = pMesh->edges_size();
+			vecLong.assign(uiEdgeCount, 0);
+			{
+				const SurfaceMesh::ReadScope scope(*pMesh);
+				const std::vector<vec3>& vecPoints = pMesh->points();
+				parallel_for(0, uiEdgeCount, [&](std::size_t i) {
+					const SurfaceMesh::Edge e(static_cast<int>(i));
+					if (pMesh->is_deleted(e))
+					{
+						return;
+					}
+					const SurfaceMesh::Vertex v0 = pMesh->vertex(e, 0), v1 = pMesh->vertex(e, 1);
+					const float fLong = kLongRatio * TargetLength(v0, v1);
+					vecLong[i] = length2(vecPoints[v0.idx()] - vecPoints[v1.idx()]) > fLong * fLong;
+				}, m_uiThreadCount, 1024);
+			}
+
+			vecEdge.clear();
+			for (std::size_t i = 0; i < uiEdgeCount; i++)
+			{
+				if (vecLong[i])
+				{
+					vecEdge.push_back(SurfaceMesh::Edge(static_cast<int>(i)));
+				}
+			}
+			if (vecEdge.empty())
+			{
+				break;
+			}
+
+			// a split does not change the other edges, so those found are still too long
+			const std::vector<vec3>& vecPoints = pMesh->points();
+			vecPoint.resize(vecEdge.size());
+			vecSizing.resize(vecEdge.size());
+			for (std::size_t i = 0; i < vecEdge.size(); i++)
+			{
+				const SurfaceMesh::Vertex v0 = pMesh->vertex(vecEdge[i], 0), v1 = pMesh->vertex(vecEdge[i], 1);
+				vecPoint[i] = 0.5f * (vecPoints[v0.idx()] + vecPoints[v1.idx()]);
+				vecSizing[i] = TargetLength(v0, v1);
+			}
+			const std::vector<SurfaceMesh::Vertex> vecVertex = m_pMesh->split_edges(vecEdge, vecPoint, m_uiThreadCount);
+			for (std::size_t i = 0; i < vecVertex.size(); i++)
+			{
+				m_Sizing[vecVertex[i]] = vecSizing[i];
+			}
+		}
+	}
+
+	void MeshRemeshing::CollapseShortEdges()
+	{
+		SurfaceMesh* pMesh = m_pMesh;
+
+		// v0 may move onto v1 if the edges it gets are not too long and its faces do not fold over. A boundary
+		// vertex may only move along the boundary, where it is (nearly) straight.
+		auto collapse_ok = [&](SurfaceMesh::Halfedge h01) {
+			const SurfaceMesh::Vertex v0 = pMesh->source(h01), v1 = pMesh->target(h01);
+			if (pMesh->is_border(v0))
+			{
+				const SurfaceMesh::Halfedge hNext = pMesh->out_halfedge(v0);
+				const SurfaceMesh::Halfedge hPrev = pMesh->prev(hNext);
+				const SurfaceMesh::Edge e = pMesh->edge(h01);
+				if (e != pMesh->edge(hNext) && e != pMesh->edge(hPrev))
+				{
+					return false;
+				}
+				const vec3 d0 = pMesh->position(v0) - pMesh->position(pMesh->source(hPrev));
+				const vec3 d1 = pMesh->position(pMesh->target(hNext)) - pMesh->position(v0);
+				if (dot(d0, d1) < kBoundaryCos * norm(d0) * norm(d1))
+				{
+					return false;
+				}
+			}
+			if (!pMesh->is_collapse_ok(h01))
+			{
+				return false;
+			}
+			const vec3& p0 = pMesh->position(v0);
+			const vec3& p1 = pMesh->position(v1);
+			const SurfaceMesh::Face fl = pMesh->face(h01);
+			const SurfaceMesh::Face fr = pMesh->face(pMesh->opposite(h01));
+			for (auto h : pMesh->halfedges(v0))
+			{
+				const SurfaceMesh::Vertex w = pMesh->target(h);
+				const float fLong = kLongRatio * TargetLength(v1, w);
+				if (length2(p1 - pMesh->position(w)) > fLong * fLong)
+				{
+					return false;
+				}
+				const SurfaceMesh::Face f = pMesh->face(h);
+				if (!f.is_valid() || f == fl || f == fr)
+				{
+					continue;
+				}
+				const vec3& pa = pMesh->position(w);
+				const vec3& pb = pMesh->position(pMesh->target(pMesh->next(h)));
+				if (dot(cross(pa - p0, pb - p0), cross(pa - p1, pb - p1)) <= 0.0f)
+				{
+					return false;
+				}
+			}
+			return true;
+		};
+
+		const std::size_t uiEdgeCount = pMesh->edges_size();
+		for (std::size_t i = 0; i < uiEdgeCount; i++)
+		{
+			const SurfaceMesh::Edge e(static_cast<int>(i));
+			if (pMesh->is_deleted(e))
+			{
+				continue;
+			}
+			const SurfaceMesh::Halfedge h01 = pMesh->halfedge(e, 0);
+			const SurfaceMesh::Halfedge h10 = pMesh->halfedge(e, 1);
+			const SurfaceMesh::Vertex v0 = pMesh->source(h01), v1 = pMesh->target(h01);
+			const float fShort = kShortRatio * TargetLength(v0, v1);
+			if (length2(pMesh->position(v0) - pMesh->position(v1)) >= fShort * fShort)
+			{
+				continue;
+			}
+
+			// the vertex of lower valence goes
+			const bool bRemove0 = collapse_ok(h01);
+			const bool bRemove1 = collapse_ok(h10);
+			if (bRemove0 && bRemove1)
+			{
+				pMesh->collapse(pMesh->valence(v0) < pMesh->valence(v1) ? h01 : h10);
+			}
+			else if (bRemove0)
+			{
+				pMesh->collapse(h01);
+			}
+			else if (bRemove1)
+			{
+				pMesh->collapse(h10);
+			}
+		}
+		pMesh->collect_garbage();
+	}
+
+	void MeshRemeshing::EqualizeValences()
+	{
+		SurfaceMesh* pMesh = m_pMesh;
+		const std::size_t uiEdgeCount = pMesh->edges_size();
+		for (std::size_t i = 0; i < uiEdgeCount; i++)
+		{
+			const SurfaceMesh::Edge e(static_cast<int>(i));
+			if (pMesh->is_deleted(e) || pMesh->is_border(e))
+			{
+				continue;
+			}
+
+			// the faces (b, a, c) and (a, b, d) become (a, c, d) and (c, b, d)
+			const SurfaceMesh::Halfedge h0 = pMesh->halfedge(e, 0);
+			const SurfaceMesh::Halfedge h1 = pMesh->halfedge(e, 1);
+			const SurfaceMesh::Vertex a = pMesh->target(h0);
+			const SurfaceMesh::Vertex b = pMesh->target(h1);
+			const SurfaceMesh::Vertex c = pMesh->target(pMesh->next(h0));
+			const SurfaceMesh::Vertex d = pMesh->target(pMesh->next(h1));
+
+			const int da = static_cast<int>(pMesh->valence(a)) - TargetValence(pMesh, a);
+			const int db = static_cast<int>(pMesh->valence(b)) - TargetValence(pMesh, b);
+			const int dc = static_cast<int>(pMesh->valence(c)) - TargetValence(pMesh, c);
+			const int dd = static_cast<int>(pMesh->valence(d)) - TargetValence(pMesh, d);
+			const int iBefore = std::abs(da) + std::abs(db) + std::abs(dc) + std::abs(dd);
+			const int iAfter = std::abs(da - 1) + std::abs(db - 1) + std::abs(dc + 1) + std::abs(dd + 1);
+			if (iAfter >= iBefore || !pMesh->is_flip_ok(e))
+			{
+				continue;
+			}
+
+			// the new faces must face the same side as the old ones
+			const vec3& pa = pMesh->position(a);
+			const vec3& pb = pMesh->position(b);
+			const vec3& pc = pMesh->position(c);
+			const vec3& pd = pMesh->position(d);
+			const vec3 n = cross(pa - pb, pc - pb) + cross(pb - pa, pd - pa);
+			if (dot(cross(pc - pa, pd - pa), n) <= 0.0f || dot(cross(pb - pc, pd - pc), n) <= 0.0f)
+			{
+				continue;
+			}
+			pMesh->flip(e);
+		}
+	}
+
+	void MeshRemeshing::TangentialRelaxation()
+	{
+		const SurfaceMesh* pMesh = m_pMesh;
+		const std::size_t uiVertexCount = pMesh->vertices_size();
+		std::vector<vec3>& vecPoints = m_pMesh->points();
+		std::vector<float>& vecSizing = m_Sizing.vector();
+		std::vector<vec3> vecMoved(vecPoints);
+		const SurfaceMesh::ReadScope scope(*pMesh);
+
+		// each vertex moves towards the centroid of its neighbours, in its tangent plane (a Jacobi step)
+		parallel_for(0, uiVertexCount, [&](std::size_t i) {
+			const SurfaceMesh::Vertex v(static_cast<int>(i));
+			if (pMesh->is_deleted(v) || pMesh->is_isolated(v) || pMesh->is_border(v))
+			{
+				return;
+			}
+			const vec3& p = vecPoints[i];
+			vec3 centroid(0.0f, 0.0f, 0.0f), normal(0.0f, 0.0f, 0.0f);
+			int iCount = 0;
+			for (auto h : pMesh->halfedges(v))
+			{
+				const vec3& q = vecPoints[pMesh->target(h).idx()];
+				const vec3& r = vecPoints[pMesh->target(pMesh->next(h)).idx()];
+				centroid += q;
+				normal += cross(q - p, r - p);
+				iCount++;
+			}
+			const float fLength = norm(normal);
+			if (fLength <= 0.0f)
+			{
+				return;
+			}
+			normal /= fLength;
+			vec3 u = centroid / static_cast<float>(iCount) - p;
+			u -= normal * dot(normal, u);
+			vecMoved[i] = p + u;
+		}, m_uiThreadCount, 1024);
+
+		// back onto the input surface, where the sizing is interpolated
+		parallel_for(0, uiVertexCount, [&](std::size_t i) {
+			const SurfaceMesh::Vertex v(static_cast<int>(i));
+			if (pMesh->is_deleted(v) || pMesh->is_isolated(v) || pMesh->is_border(v))
+			{
+				return;
+			}
+			vec3 closest, barycentric;
+			const int t = m_ReferenceTree.ClosestPoint(vecMoved[i], closest, barycentric);
+			if (t < 0)
+			{
+				return;
+			}
+			vecPoints[i] = closest;
+			vecSizing[i] = barycentric.x * m_vecReferenceSizing[m_vecReferenceTriangle[3 * t]] +
+						   barycentric.y * m_vecReferenceSizing[m_vecReferenceTriangle[3 * t + 1]] +
+						   barycentric.z * m_vecReferenceSizing[m_vecReferenceTriangle[3 * t + 2]];
+		}, m_uiThreadCount, 256);
+		m_pMesh->mark_positions_changed();
+	}
+
+	void MeshRemeshing::ComputeStatistics()
+	{
+		m_Statistics = RemeshingStatistics();
+		float fMin = std::numeric_limits<float>::max(), fMax = 0.0f;
+		for (auto e : m_pMesh->edges())
+		{
+			const SurfaceMesh::Vertex v0 = m_pMesh->vertex(e, 0), v1 = m_pMesh->vertex(e, 1);
+			const float fRatio = norm(m_pMesh->position(v0) - m_pMesh->position(v1)) / TargetLength(v0, v1);
+			fMin = std::min(fMin, fRatio);
+			fMax = std::max(fMax, fRatio);
+			if (fRatio < kShortRatio)
+			{
+				m_Statistics.uiShortEdges++;
+			}
+		}
+		if (m_pMesh->n_edges() > 0)
+		{
+			m_Statistics.fMinRatio = fMin;
+			m_Statistics.fMaxRatio = fMax;
+		}
+	}
+}
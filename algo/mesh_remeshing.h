@@ -0,0 +1,91 @@
+#pragma once
+
+#include "../core/surface_mesh.h"
+#include "triangle_tree.h"
+#include <vector>
+
+namespace MV
+{
+	// wall-clock time of the phases of the last remeshing, summed over the iterations, in seconds
+	struct RemeshingTimings
+	{
+		double dSetup = 0.0;        // the reference surface, its tree, and the sizing field
+		double dSplit = 0.0;
+		double dCollapse = 0.0;
+		double dFlip = 0.0;
+		double dRelax = 0.0;        // tangential relaxation and projection onto the reference surface
+	};
+
+	// the edge lengths after the last remeshing, relative to the target length of each edge
+	struct RemeshingStatistics
+	{
+		float fMinRatio = 0.0f;
+		float fMaxRatio = 0.0f;         // at most 4/3, see MeshRemeshing
+		unsigned int uiShortEdges = 0;  // edges shorter than 4/5 of their target length
+	};
+
+	// Isotropic remeshing of triangle meshes (Botsch and Kobbelt 2004). Each iteration splits the edges longer than
+	// 4/3 of their target length, collapses those shorter than 4/5 of it (unless this creates an edge longer than
+	// 4/3), flips edges to bring the valences closer to 6 (4 on the boundary), and moves the vertices towards the
+	// centroid of their neighbours in their tangent plane, after which they are projected back onto the input
+	// surface. The closest points are found with a TriangleTree of the input, built once.
+	//
+	// After the iterations, a last pass of splits and collapses is run without moving the vertices. Since the splits
+	// are repeated until no edge is too long, and a collapse never creates a too long edge, no edge of the result is
+	// longer than 4/3 of its target length. The lower bound of 4/5 is only approached: a collapse can be illegal, and
+	// the boundary vertices are only removed where the boundary is straight (they are not moved otherwise);
+	// GetStatistics() reports the actual range.
+	//
+	// The search for long edges, the splits (see SurfaceMesh::split_edges()), the relaxation, and the projection run
+	// in parallel; the collapses and the flips are sequential.
+	class MeshRemeshing
+	{
+	public:
+		explicit MeshRemeshing(SurfaceMesh* mesh);
+		~MeshRemeshing();
+
+		// all target lengths are fEdgeLength
+		void UniformRemeshing(float fEdgeLength, unsigned int uiIterations = 10);
+
+		// The target length at a vertex is the edge length of the equilateral triangles that stay within
+		// fApproxError of a sphere with the largest absolute principal curvature of the input there (see
+		// geom::vertex_curvatures()), clamped to [fMinEdgeLength, fMaxEdgeLength]. The target length of an edge is
+		// the mean of those of its vertices.
+		void AdaptiveRemeshing(float fMinEdgeLength, float fMaxEdgeLength, float fApproxError,
+							   unsigned int uiIterations = 10);
+
+		// 0: one thread per core
+		void SetThreadCount(unsigned int uiThreadCount) { m_uiThreadCount = uiThreadCount; }
+		unsigned int GetThreadCount() const { return m_uiThreadCount; }
+
+		const RemeshingTimings& GetTimings() const { return m_Timings; }
+		const RemeshingStatistics& GetStatistics() const { return m_Statistics; }
+
+	private:
+		// builds the reference surface; m_vecReferenceSizing must be set before
+		bool Setup();
+		void Remesh(unsigned int uiIterations);
+		void Finish();
+
+		void SplitLongEdges();
+		void CollapseShortEdges();
+		void EqualizeValences();
+		void TangentialRelaxation();
+		void ComputeStatistics();
+
+		// the target length of the edge between v0 and v1
+		float TargetLength(SurfaceMesh::Vertex v0, SurfaceMesh::Vertex v1) const;
+
+	private:
+		SurfaceMesh* m_pMesh;
+		unsigned int m_uiThreadCount;
+		RemeshingTimings m_Timings;
+		RemeshingStatistics m_Statistics;
+
+		// only valid during the remeshing
+		TriangleTree m_ReferenceTree;
+		std::vector<int> m_vecReferenceTriangle;
+		std::vector<float> m_vecReferenceSizing;    // the target length at each vertex of the input
+		SurfaceMesh::VertexProperty<float> m_Sizing;
+	};
+}
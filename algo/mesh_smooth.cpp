@@ -1,5 +1,7 @@
 #include "mesh_smooth.h"
 #include "../core/surface_mesh_geometry.h"
+#include "../util/parallel.h"
+#include "../util/stop_watch.h"
 #include <iostream>
 #include <math.h>
 
@@ -9,6 +11,10 @@ namespace MV
 	{
 		m_pMesh = mesh;
 		m_uiMeshEdgeWeightsCount = 0;
+		m_bLockBoundary = true;
+		m_uiThreadCount = 0;
+		m_uLaplaceTopology = 0;
+		m_iFreeCount = 0;
 	}
 
 	MeshSmooth::~MeshSmooth()
@@ -22,49 +28,286 @@ namespace MV
 		ComputeVertexWeights(bLaplace);
 	}
 
-	void MeshSmooth::ExplicitSmooth(int iIters, bool bLaplace)
+	void MeshSmooth::ExplicitSmooth(int iIters, bool bLaplace, bool bRescale)
 	{
 		if (!m_pMesh->n_vertices())
 		{
 			return;
 		}
+		m_Timings = SmoothTimings();
+		StopWatch watch;
 
-		auto eweight = m_pMesh->get_edge_property<float>("e:cotan");
-		if (!eweight || m_uiMeshEdgeWeightsCount != m_pMesh->n_edges())
+		// the edge weights depend on the positions, so they are only refreshed when the geometry, the
+		// connectivity or the weighting scheme changed since they were computed (by either smoothing)
+		const std::uint64_t uTopology = m_pMesh->topology_version();
+		const std::uint64_t uGeometry =
+			static_cast<const SurfaceMesh*>(m_pMesh)->get_vertex_property<vec3>("v:point").version();
+		const bool bSameWeights = m_Cache.bEdgeWeights && m_Cache.uWeightTopology == uTopology &&
+								  m_Cache.uGeometry == uGeometry && m_Cache.bLaplace == bLaplace;
+		if (!bSameWeights)
 		{
+			// this overwrites the weights the implicit system was built from
+			m_Cache.bVertexWeights = false;
+			m_Cache.bFactorized = false;
 			ComputeEdgeWeights(bLaplace);
 		}
-		eweight = m_pMesh->get_edge_property<float>("e:cotan");
-		auto points = m_pMesh->get_vertex_property<vec3>("v:point");
-		auto laplace = m_pMesh->get_vertex_property<vec3>("v:laplace");
+		m_Timings.dWeights = watch.elapsed_seconds(4);
 
-		// ˲
-		SurfaceMesh::Vertex vv;
-		SurfaceMesh::Edge e;
-		for (int i = 0; i < iIters; i++)
+		watch.restart();
+		if (!bSameWeights)
 		{
-			// step1 ÿһlaplaceȨ
-			for (auto item : m_pMesh->vertices())
+			BuildLaplacian();
+			m_Cache.uWeightTopology = uTopology;
+			m_Cache.uGeometry = uGeometry;
+			m_Cache.bLaplace = bLaplace;
+			m_Cache.bEdgeWeights = true;
+		}
+		ComputeFixedVertices();
+		m_Timings.dLaplacian = watch.elapsed_seconds(4);
+
+		const float fAreaBefore = bRescale ? geom::surface_area(m_pMesh) : 0.0f;
+		const vec3 centerBefore = bRescale ? geom::centroid(m_pMesh) : vec3(0, 0, 0);
+
+		// Jacobi-style iterations over two buffers: p' = p + 0.5 * (sum_j w_ij p_j / sum_j w_ij - p)
+		watch.restart();
+		std::vector<vec3>& vecPoints = m_pMesh->points();
+		std::vector<vec3> vecCurrent(vecPoints);
+		std::vector<vec3> vecNext(vecPoints.size());
+		for (int iter = 0; iter < iIters; iter++)
+		{
+			parallel_for(0, vecCurrent.size(), [&](std::size_t i) {
+				const vec3& p = vecCurrent[i];
+				double dSumX = 0.0, dSumY = 0.0, dSumZ = 0.0;
+				double dWeightSum = 0.0;
+				if (!m_vecFixed[i])
+				{
+					for (int k = m_vecLaplaceOffset[i]; k < m_vecLaplaceOffset[i + 1]; k++)
+					{
+						const vec3& q = vecCurrent[m_vecLaplaceIndex[k]];
+						const double dWeight = m_vecLaplaceWeight[k];
+						dSumX += dWeight * q.x;
+						dSumY += dWeight * q.y;
+						dSumZ += dWeight * q.z;
+						dWeightSum += dWeight;
+					}
+				}
+				if (dWeightSum > 0.0)
+				{
+					vecNext[i] = vec3(static_cast<float>(0.5 * (p.x + dSumX / dWeightSum)),
+									  static_cast<float>(0.5 * (p.y + dSumY / dWeightSum)),
+									  static_cast<float>(0.5 * (p.z + dSumZ / dWeightSum)));
+				}
+				else
+				{
+					vecNext[i] = p;
+				}
+			}, m_uiThreadCount);
+			vecCurrent.swap(vecNext);
+		}
+		vecPoints.swap(vecCurrent);
+		m_Timings.dSolve = watch.elapsed_seconds(4);
+
+		if (bRescale)
+		{
+			watch.restart();
+			Rescale(fAreaBefore, centerBefore);
+			m_Timings.dRescale = watch.elapsed_seconds(4);
+		}
+		m_pMesh->mark_positions_changed();
+		m_pMesh->invalidate_bounding_box();
+
+		std::cout << "ExplicitSmooth: " << iIters << " iteration(s) over " << m_pMesh->n_vertices() << " vertices"
+				  << " (weights " << m_Timings.dWeights << "s, laplacian " << m_Timings.dLaplacian << "s, iterations "
+				  << m_Timings.dSolve << "s, rescale " << m_Timings.dRescale << "s)" << std::endl;
+	}
+
+	void MeshSmooth::ImplicitSmooth(float fTimeStep, bool bLaplace, bool bRescale)
+	{
+		if (!m_pMesh->n_vertices())
+		{
+			return;
+		}
+		m_Timings = SmoothTimings();
+		StopWatch watch;
+
+		// how much of the cached system can be reused
+		const std::uint64_t uTopology = m_pMesh->topology_version();
+		const std::uint64_t uGeometry =
+			static_cast<const SurfaceMesh*>(m_pMesh)->get_vertex_property<vec3>("v:point").version();
+		const bool bSamePattern = m_Cache.bAnalyzed && m_Cache.uTopology == uTopology &&
+								  m_Cache.bLockBoundary == m_bLockBoundary;
+		const bool bSameWeights = bSamePattern && m_Cache.bEdgeWeights && m_Cache.bVertexWeights &&
+								  m_Cache.uWeightTopology == uTopology && m_Cache.uGeometry == uGeometry &&
+								  m_Cache.bLaplace == bLaplace;
+		const bool bSameFactor = bSameWeights && m_Cache.bFactorized && m_Cache.fTimeStep == fTimeStep;
+
+		if (!bSameWeights)
+		{
+			ComputeEdgeWeights(bLaplace);
+			ComputeVertexWeights(bLaplace);
+		}
+		m_Timings.dWeights = watch.elapsed_seconds(4);
+
+		watch.restart();
+		const int iVertexCount = static_cast<int>(m_pMesh->vertices_size());
+		if (!bSameWeights)
+		{
+			BuildLaplacian();
+			auto vweight = m_pMesh->get_vertex_property<float>("v:area");
+			m_vecInvArea.resize(iVertexCount);
+			parallel_for(0, iVertexCount, [&](std::size_t i) {
+				m_vecInvArea[i] = 1.0 / vweight[SurfaceMesh::Vertex(static_cast<int>(i))];
+			}, m_uiThreadCount);
+		}
+		if (!bSamePattern)
+		{
+			// number the free vertices, the fixed ones move to the right-hand side
+			ComputeFixedVertices();
+			m_vecFreeIndex.assign(iVertexCount, -1);
+			m_iFreeCount = 0;
+			for (int i = 0; i < iVertexCount; i++)
+			{
+				if (!m_vecFixed[i])
+				{
+					m_vecFreeIndex[i] = m_iFreeCount++;
+				}
+			}
+		}
+		m_Timings.dLaplacian = watch.elapsed_seconds(4);
+		if (m_iFreeCount == 0)
+		{
+			return;
+		}
+
+		const float fAreaBefore = bRescale ? geom::surface_area(m_pMesh) : 0.0f;
+		const vec3 centerBefore = bRescale ? geom::centroid(m_pMesh) : vec3(0, 0, 0);
+
+		if (!bSameFactor)
+		{
+			// (M^-1 - dt * L) p' = M^-1 p, with M^-1 = 1 / v:area and L the weighted Laplacian
+			watch.restart();
+			const std::vector<int>& vecFreeIndex = m_vecFreeIndex;
+			const std::vector<vec3>& vecPoints = static_cast<const SurfaceMesh*>(m_pMesh)->points();
+			std::vector<int> vecTripletOffset(iVertexCount + 1, 0);
+			for (int i = 0; i < iVertexCount; i++)
 			{
-				vec3 temp(0, 0, 0);
-				if (!m_pMesh->is_border(item))
+				int iCount = 0;
+				if (vecFreeIndex[i] >= 0)
+				{
+					iCount = 1;
+					for (int k = m_vecLaplaceOffset[i]; k < m_vecLaplaceOffset[i + 1]; k++)
+					{
+						iCount += (vecFreeIndex[m_vecLaplaceIndex[k]] >= 0);
+					}
+				}
+				vecTripletOffset[i + 1] = vecTripletOffset[i] + iCount;
+			}
+			std::vector<Eigen::Triplet<double>> vecTriplet(vecTripletOffset[iVertexCount]);
+			m_Rhs.resize(m_iFreeCount, 3);
+			parallel_for(0, iVertexCount, [&](std::size_t i) {
+				const int iRow = vecFreeIndex[i];
+				if (iRow < 0)
+				{
+					return;
+				}
+				const double dInvArea = m_vecInvArea[i];
+				double dDiagonal = dInvArea;
+				Eigen::RowVector3d b(vecPoints[i].x, vecPoints[i].y, vecPoints[i].z);
+				b *= dInvArea;
+				int t = vecTripletOffset[i];
+				for (int k = m_vecLaplaceOffset[i]; k < m_vecLaplaceOffset[i + 1]; k++)
 				{
-					float w(0.0);
-					for (auto h : m_pMesh->halfedges(item))
+					const int j = m_vecLaplaceIndex[k];
+					const double dWeight = fTimeStep * m_vecLaplaceWeight[k];
+					dDiagonal += dWeight;
+					if (vecFreeIndex[j] >= 0)
+					{
+						vecTriplet[t++] = Eigen::Triplet<double>(iRow, vecFreeIndex[j], -dWeight);
+					}
+					else
 					{
-						
+						b += dWeight * Eigen::RowVector3d(vecPoints[j].x, vecPoints[j].y, vecPoints[j].z);
 					}
 				}
+				vecTriplet[t] = Eigen::Triplet<double>(iRow, iRow, dDiagonal);
+				m_Rhs.row(iRow) = b;
+			}, m_uiThreadCount);
+			Eigen::SparseMatrix<double> A(m_iFreeCount, m_iFreeCount);
+			A.setFromTriplets(vecTriplet.begin(), vecTriplet.end());
+			std::vector<Eigen::Triplet<double>>().swap(vecTriplet);
+			m_Timings.dAssemble = watch.elapsed_seconds(4);
+
+			// the sparsity pattern only changes with the connectivity or the set of fixed vertices
+			watch.restart();
+			if (!bSamePattern || !m_pSolver)
+			{
+				m_pSolver.reset(new Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>>);
+				m_pSolver->analyzePattern(A);
+				m_Timings.dAnalyze = watch.elapsed_seconds(4);
+			}
+			watch.restart();
+			m_pSolver->factorize(A);
+			m_Timings.dFactorize = watch.elapsed_seconds(4);
+			if (m_pSolver->info() != Eigen::Success)
+			{
+				ClearCache();
+				std::cerr << "ImplicitSmooth: the Cholesky factorization failed" << std::endl;
+				return;
 			}
+
+			m_Cache.uTopology = uTopology;
+			m_Cache.bLockBoundary = m_bLockBoundary;
+			m_Cache.bAnalyzed = true;
+			m_Cache.uWeightTopology = uTopology;
+			m_Cache.uGeometry = uGeometry;
+			m_Cache.bLaplace = bLaplace;
+			m_Cache.bEdgeWeights = true;
+			m_Cache.bVertexWeights = true;
+			m_Cache.fTimeStep = fTimeStep;
+			m_Cache.bFactorized = true;
 		}
 
+		watch.restart();
+		Eigen::MatrixX3d X = m_pSolver->solve(m_Rhs);
+		if (m_pSolver->info() != Eigen::Success)
+		{
+			std::cerr << "ImplicitSmooth: solving the linear system failed" << std::endl;
+			return;
+		}
+		std::vector<vec3>& vecNewPoints = m_pMesh->points();
+		parallel_for(0, iVertexCount, [&](std::size_t i) {
+			const int iRow = m_vecFreeIndex[i];
+			if (iRow >= 0)
+			{
+				vecNewPoints[i] = vec3(static_cast<float>(X(iRow, 0)), static_cast<float>(X(iRow, 1)),
+									   static_cast<float>(X(iRow, 2)));
+			}
+		}, m_uiThreadCount);
+		m_Timings.dSolve = watch.elapsed_seconds(4);
 
+		if (bRescale)
+		{
+			watch.restart();
+			Rescale(fAreaBefore, centerBefore);
+			m_Timings.dRescale = watch.elapsed_seconds(4);
+		}
+		m_pMesh->mark_positions_changed();
+		m_pMesh->invalidate_bounding_box();
 
+		std::cout << "ImplicitSmooth: " << m_iFreeCount << " free vertices" << (bSameFactor ? ", cached factorization" : "")
+				  << " (weights " << m_Timings.dWeights << "s, laplacian " << m_Timings.dLaplacian << "s, assemble "
+				  << m_Timings.dAssemble << "s, analyze " << m_Timings.dAnalyze << "s, factorize " << m_Timings.dFactorize
+				  << "s, solve " << m_Timings.dSolve << "s, rescale " << m_Timings.dRescale << "s)" << std::endl;
 	}
 
-	void MeshSmooth::ImplicitSmooth(float fTimeStep, bool bLaplace, bool bRescale)
+	void MeshSmooth::ClearCache()
 	{
-
+		m_Cache = ImplicitCache();
+		m_pSolver.reset();
+		m_Rhs.resize(0, 3);
+		std::vector<int>().swap(m_vecFreeIndex);
+		std::vector<double>().swap(m_vecInvArea);
+		m_iFreeCount = 0;
 	}
 
 	void MeshSmooth::ComputeEdgeWeights(bool bLaplace)
@@ -79,10 +322,15 @@ namespace MV
 		}
 		else
 		{
-			for (auto item : m_pMesh->edges())
-			{
-				eweight[item] = static_cast<float>(std::max(0.0, geom::cotan_weight(m_pMesh, item)));
-			}
+			// each edge only reads the geometry and writes its own weight
+			const SurfaceMesh* pMesh = m_pMesh;
+			parallel_for(0, pMesh->edges_size(), [&](std::size_t i) {
+				SurfaceMesh::Edge item(static_cast<int>(i));
+				if (!pMesh->is_deleted(item))
+				{
+					eweight[item] = static_cast<float>(std::max(0.0, geom::cotan_weight(pMesh, item)));
+				}
+			}, m_uiThreadCount);
 		}
 		m_uiMeshEdgeWeightsCount = m_pMesh->n_edges();
 	}
@@ -99,12 +347,93 @@ namespace MV
 		}
 		else
 		{
-			for (auto item : m_pMesh->vertices())
+			const SurfaceMesh* pMesh = m_pMesh;
+			parallel_for(0, pMesh->vertices_size(), [&](std::size_t i) {
+				SurfaceMesh::Vertex item(static_cast<int>(i));
+				if (!pMesh->is_deleted(item))
+				{
+					// degenerate neighbourhoods fall back to the uniform weight
+					const double dArea = geom::voronoi_area(pMesh, item);
+					vweight[item] = static_cast<float>(dArea > 0.0 ? 0.5 / dArea : 1.0 / std::max(1u, pMesh->valence(item)));
+				}
+			}, m_uiThreadCount);
+		}
+
+	}
+
+	void MeshSmooth::BuildLaplacian()
+	{
+		const std::size_t uiVertexCount = m_pMesh->vertices_size();
+		if (m_uLaplaceTopology != m_pMesh->topology_version())
+		{
+			const SurfaceMesh* pMesh = m_pMesh;
+			m_vecLaplaceOffset.assign(uiVertexCount + 1, 0);
+			parallel_for(0, uiVertexCount, [&](std::size_t i) {
+				SurfaceMesh::Vertex v(static_cast<int>(i));
+				if (!pMesh->is_deleted(v))
+				{
+					m_vecLaplaceOffset[i + 1] = static_cast<int>(pMesh->valence(v));
+				}
+			}, m_uiThreadCount);
+			for (std::size_t i = 0; i < uiVertexCount; i++)
 			{
-				//vweight[item] = static_cast<float>(0.5 / m_pMesh->valence(item));
+				m_vecLaplaceOffset[i + 1] += m_vecLaplaceOffset[i];
 			}
+
+			m_vecLaplaceIndex.resize(m_vecLaplaceOffset[uiVertexCount]);
+			m_vecLaplaceEdge.resize(m_vecLaplaceOffset[uiVertexCount]);
+			parallel_for(0, uiVertexCount, [&](std::size_t i) {
+				SurfaceMesh::Vertex v(static_cast<int>(i));
+				if (pMesh->is_deleted(v))
+				{
+					return;
+				}
+				int k = m_vecLaplaceOffset[i];
+				for (auto h : pMesh->halfedges(v))
+				{
+					m_vecLaplaceIndex[k] = pMesh->target(h).idx();
+					m_vecLaplaceEdge[k] = pMesh->edge(h).idx();
+					k++;
+				}
+			}, m_uiThreadCount);
+			m_uLaplaceTopology = m_pMesh->topology_version();
 		}
 
+		auto eweight = m_pMesh->get_edge_property<float>("e:cotan");
+		m_vecLaplaceWeight.resize(m_vecLaplaceEdge.size());
+		parallel_for(0, m_vecLaplaceEdge.size(), [&](std::size_t k) {
+			m_vecLaplaceWeight[k] = eweight[SurfaceMesh::Edge(m_vecLaplaceEdge[k])];
+		}, m_uiThreadCount);
 	}
-}
 
+	void MeshSmooth::ComputeFixedVertices()
+	{
+		const SurfaceMesh* pMesh = m_pMesh;
+		m_vecFixed.assign(pMesh->vertices_size(), 0);
+		parallel_for(0, pMesh->vertices_size(), [&](std::size_t i) {
+			SurfaceMesh::Vertex v(static_cast<int>(i));
+			m_vecFixed[i] = pMesh->is_deleted(v) || pMesh->is_isolated(v) || (m_bLockBoundary && pMesh->is_border(v));
+		}, m_uiThreadCount);
+	}
+
+	void MeshSmooth::Rescale(float fAreaBefore, const vec3& centerBefore)
+	{
+		// restore the surface area, then the (area weighted) center
+		const float fAreaAfter = geom::surface_area(m_pMesh);
+		if (fAreaAfter <= 0.0f)
+		{
+			return;
+		}
+		const float fScale = std::sqrt(fAreaBefore / fAreaAfter);
+		std::vector<vec3>& vecPoints = m_pMesh->points();
+		for (auto& p : vecPoints)
+		{
+			p *= fScale;
+		}
+		const vec3 trans = centerBefore - geom::centroid(m_pMesh);
+		for (auto& p : vecPoints)
+		{
+			p += trans;
+		}
+	}
+}
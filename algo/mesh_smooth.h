@@ -1,8 +1,25 @@
 #pragma once
 
 #include "../core/surface_mesh.h"
+#include <vector>
+#include <cstdint>
+#include <memory>
+#include <Eigen/Sparse>
+
 namespace MV
 {
+	// wall-clock time of the phases of the last smoothing call, in seconds
+	struct SmoothTimings
+	{
+		double dWeights = 0.0;      // e:cotan (and v:area) weights
+		double dLaplacian = 0.0;    // CSR Laplacian
+		double dAssemble = 0.0;     // implicit only: system matrix and right-hand side
+		double dAnalyze = 0.0;      // implicit only: symbolic factorization (0 if reused)
+		double dFactorize = 0.0;    // implicit only: numeric factorization (0 if reused)
+		double dSolve = 0.0;        // explicit iterations or implicit back-substitution
+		double dRescale = 0.0;
+	};
+
 	class MeshSmooth
 	{
 	public:
@@ -10,18 +27,73 @@ namespace MV
 		~MeshSmooth();
 
 		void Initialize(bool bLaplace = false);
-		void ExplicitSmooth(int iIters = 10, bool bLaplace = false);
+		void ExplicitSmooth(int iIters = 10, bool bLaplace = false, bool bRescale = false);
 		void ImplicitSmooth(float fTimeStep = 0.001, bool bLaplace = false, bool bRescale = true);
 
+		// boundary vertices keep their positions (default: true)
+		void SetLockBoundary(bool bLockBoundary) { m_bLockBoundary = bLockBoundary; }
+		bool GetLockBoundary() const { return m_bLockBoundary; }
+
+		// 0: one thread per core
+		void SetThreadCount(unsigned int uiThreadCount) { m_uiThreadCount = uiThreadCount; }
+		unsigned int GetThreadCount() const { return m_uiThreadCount; }
+
+		const SmoothTimings& GetTimings() const { return m_Timings; }
+
+		// Frees the cached Laplacian and factorization of the implicit smoothing.
+		void ClearCache();
+
 	private:
 		void ComputeEdgeWeights(bool bLaplace);
 		void ComputeVertexWeights(bool bLaplace);
+		void BuildLaplacian();
+		void ComputeFixedVertices();
+		void Rescale(float fAreaBefore, const vec3& centerBefore);
 
 
 	private:
 		SurfaceMesh* m_pMesh;
 		unsigned int m_uiMeshEdgeWeightsCount;
-	};
-}
+		bool m_bLockBoundary;
+		unsigned int m_uiThreadCount;
+		SmoothTimings m_Timings;
 
+		// Laplacian in CSR form: the neighbours of vertex i are m_vecLaplaceIndex[m_vecLaplaceOffset[i] ..
+		// m_vecLaplaceOffset[i + 1]), with the e:cotan weights of the connecting edges in m_vecLaplaceWeight.
+		// The structure is rebuilt only when the connectivity changes, the weights on every call.
+		std::vector<int> m_vecLaplaceOffset;
+		std::vector<int> m_vecLaplaceIndex;
+		std::vector<int> m_vecLaplaceEdge;
+		std::vector<float> m_vecLaplaceWeight;
+		std::uint64_t m_uLaplaceTopology;
 
+		// vertices kept in place (deleted, isolated, or locked boundary)
+		std::vector<char> m_vecFixed;
+
+		// What the cached weights and implicit system were built for. Each level of the implicit system is only
+		// valid if the ones above hold:
+		//  - connectivity and boundary locking: free vertex numbering and symbolic analysis,
+		//  - positions and weighting scheme: edge weights (and the Laplacian weights), and vertex weights,
+		//  - time step: numeric factorization and right-hand side.
+		// The explicit smoothing reuses the edge weights alone, whichever smoothing computed them.
+		struct ImplicitCache
+		{
+			std::uint64_t uTopology = 0;
+			bool bLockBoundary = true;
+			bool bAnalyzed = false;
+			std::uint64_t uWeightTopology = 0;
+			std::uint64_t uGeometry = 0;
+			bool bLaplace = false;
+			bool bEdgeWeights = false;
+			bool bVertexWeights = false;
+			float fTimeStep = 0.0f;
+			bool bFactorized = false;
+		};
+		ImplicitCache m_Cache;
+		std::vector<int> m_vecFreeIndex;
+		int m_iFreeCount;
+		std::vector<double> m_vecInvArea;
+		Eigen::MatrixX3d m_Rhs;
+		std::unique_ptr<Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>>> m_pSolver;
+	};
+}
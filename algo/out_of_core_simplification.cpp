@@ -0,0 +1,551 @@
+#include "out_of_core_simplification.h"
+#include "../core/surface_mesh_builder.h"
+#include "../fileio/mesh_stream_reader.h"
+#include "../fileio/ply_reader_writer.h"
+#include "../util/file_system.h"
+#include "../util/progress.h"
+#include "../util/stop_watch.h"
+#include <Eigen/Dense>
+#include <unordered_map>
+#include <unordered_set>
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstdio>
+
+namespace MV
+{
+	namespace
+	{
+		// what the faces need to know about a vertex of the file
+		struct VertexRecord
+		{
+			float p[3];             // relative to the corner of the bounding box
+			std::uint32_t uiCell;
+		};
+	}
+
+	// The records of the input vertices, in the order of the file. While they fit in the memory budget they are a
+	// plain vector; beyond, they are written to a temporary file page by page, and the pages the faces need are read
+	// back into a direct-mapped cache of the size of the budget. The faces of scans mostly refer to vertices read
+	// shortly before them, so few pages are read more than once.
+	class OutOfCoreSimplification::VertexStore
+	{
+	public:
+		explicit VertexStore(std::size_t uiBudget)
+			: m_uiBudget(std::max<std::size_t>(uiBudget, 2 * kPageBytes)), m_pFile(nullptr), m_uiFlushed(0), m_uiSize(0)
+		{
+		}
+
+		~VertexStore()
+		{
+			if (m_pFile)
+			{
+				std::fclose(m_pFile);   // a tmpfile() is removed when it is closed
+			}
+		}
+
+		bool IsOnDisk() const { return m_pFile != nullptr; }
+		std::size_t GetSize() const { return m_uiSize; }
+
+		bool Push(const VertexRecord& record)
+		{
+			m_uiSize++;
+			if (!m_pFile)
+			{
+				if ((m_vecRecord.size() + 1) * sizeof(VertexRecord) <= m_uiBudget)
+				{
+					m_vecRecord.push_back(record);
+					return true;
+				}
+				if (!MoveToDisk())
+				{
+					return false;
+				}
+			}
+			m_vecRecord.push_back(record);  // the page being written
+			if (m_vecRecord.size() == kPageSize)
+			{
+				if (std::fwrite(m_vecRecord.data(), sizeof(VertexRecord), kPageSize, m_pFile) != kPageSize)
+				{
+					return false;
+				}
+				m_uiFlushed += kPageSize;
+				m_vecRecord.clear();
+			}
+			return true;
+		}
+
+		// false if the page of the vertex could not be read back
+		bool Get(std::size_t uiVertex, VertexRecord& record)
+		{
+			if (uiVertex >= m_uiFlushed)
+			{
+				record = m_vecRecord[uiVertex - m_uiFlushed];
+				return true;
+			}
+			const std::size_t uiPage = uiVertex / kPageSize;
+			Slot& slot = m_vecSlot[uiPage % m_vecSlot.size()];
+			if (slot.uiPage != uiPage && !ReadPage(uiPage, slot))
+			{
+				return false;
+			}
+			record = slot.vecRecord[uiVertex % kPageSize];
+			return true;
+		}
+
+	private:
+		static const std::size_t kPageSize = 1 << 14;
+		static const std::size_t kPageBytes = kPageSize * sizeof(VertexRecord);
+
+		struct Slot
+		{
+			std::size_t uiPage = std::numeric_limits<std::size_t>::max();
+			std::vector<VertexRecord> vecRecord;
+		};
+
+		bool MoveToDisk()
+		{
+			m_pFile = std::tmpfile();
+			if (!m_pFile)
+			{
+				std::cout << "OutOfCoreSimplification: could not create a temporary file" << std::endl;
+				return false;
+			}
+			// whole pages go to the file, the rest stays as the page being written
+			const std::size_t uiWhole = m_vecRecord.size() / kPageSize * kPageSize;
+			if (std::fwrite(m_vecRecord.data(), sizeof(VertexRecord), uiWhole, m_pFile) != uiWhole)
+			{
+				return false;
+			}
+			m_uiFlushed = uiWhole;
+			std::vector<VertexRecord> vecTail(m_vecRecord.begin() + uiWhole, m_vecRecord.end());
+			vecTail.reserve(kPageSize);
+			m_vecRecord.swap(vecTail);
+			// the slots get their memory when they are first used
+			m_vecSlot.resize(std::max<std::size_t>(1, m_uiBudget / kPageBytes - 1));
+			return true;
+		}
+
+		bool ReadPage(std::size_t uiPage, Slot& slot)
+		{
+			slot.vecRecord.resize(kPageSize);
+			slot.uiPage = std::numeric_limits<std::size_t>::max();
+			const long long llOffset = static_cast<long long>(uiPage) * kPageBytes;
+#ifdef _WIN32
+			const bool bSeek = _fseeki64(m_pFile, llOffset, SEEK_SET) == 0;
+#else
+			const bool bSeek = fseeko(m_pFile, static_cast<off_t>(llOffset), SEEK_SET) == 0;
+#endif
+			// only whole pages are written, so a page is always read completely
+			const bool bRead = bSeek && std::fread(slot.vecRecord.data(), sizeof(VertexRecord), kPageSize, m_pFile) == kPageSize;
+			// the next page is written after the last one
+			if (!bRead || std::fseek(m_pFile, 0, SEEK_END) != 0)
+			{
+				std::cout << "OutOfCoreSimplification: could not read page " << uiPage << " of the temporary file" << std::endl;
+				return false;
+			}
+			slot.uiPage = uiPage;
+			return true;
+		}
+
+	private:
+		std::size_t m_uiBudget;
+		std::FILE* m_pFile;
+		std::vector<VertexRecord> m_vecRecord;
+		std::size_t m_uiFlushed;                // the vertices whose records are in the file
+		std::size_t m_uiSize;
+		std::vector<Slot> m_vecSlot;
+	};
+
+	namespace
+	{
+		// the quadric of the planes of the faces touching a cell, and the vertices in it
+		struct Cell
+		{
+			double q[10];       // symmetric 4x4 matrix, upper triangle row by row
+			dvec3 sum;
+			unsigned int uiCount;
+		};
+
+		// an output triangle as its cells, starting at the smallest (the orientation counts)
+		struct CellTriangle
+		{
+			std::uint32_t c[3];
+
+			bool operator==(const CellTriangle& other) const
+			{
+				return c[0] == other.c[0] && c[1] == other.c[1] && c[2] == other.c[2];
+			}
+		};
+
+		struct CellTriangleHash
+		{
+			std::size_t operator()(const CellTriangle& t) const
+			{
+				std::uint64_t h = t.c[0];
+				h = h * 0x9E3779B97F4A7C15ull ^ t.c[1];
+				h = h * 0x9E3779B97F4A7C15ull ^ t.c[2];
+				return static_cast<std::size_t>(h ^ (h >> 29));
+			}
+		};
+
+		// The point of a cell where its quadric is the smallest. It is found from the mean of the vertices in the
+		// cell, ignoring the directions in which the quadric is (nearly) flat (Lindstrom 2000), and stays in the cell.
+		dvec3 CellPosition(const Cell& cell, const dvec3& cellMin, double dCellSize)
+		{
+			const dvec3 mean = cell.sum / static_cast<double>(cell.uiCount);
+			Eigen::Matrix3d A;
+			A << cell.q[0], cell.q[1], cell.q[2],
+				 cell.q[1], cell.q[4], cell.q[5],
+				 cell.q[2], cell.q[5], cell.q[7];
+			const Eigen::Vector3d b(cell.q[3], cell.q[6], cell.q[8]);
+			const Eigen::Vector3d m(mean.x, mean.y, mean.z);
+
+			const Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver(A);
+			const Eigen::Vector3d lambda = solver.eigenvalues();
+			const double dThreshold = 1e-3 * lambda.cwiseAbs().maxCoeff();
+			const Eigen::Vector3d r = -(A * m + b);
+			Eigen::Vector3d x = m;
+			for (int k = 0; k < 3; k++)
+			{
+				if (std::abs(lambda[k]) > dThreshold)
+				{
+					const Eigen::Vector3d u = solver.eigenvectors().col(k);
+					x += u * (u.dot(r) / lambda[k]);
+				}
+			}
+
+			dvec3 p;
+			for (int k = 0; k < 3; k++)
+			{
+				p[k] = std::min(std::max(x[k], cellMin[k]), cellMin[k] + dCellSize);
+			}
+			return p;
+		}
+	}
+
+	OutOfCoreSimplification::OutOfCoreSimplification()
+	{
+		m_uiResolution = 256;
+		m_uiMemoryBudget = std::size_t(256) << 20;
+		m_bCanceled = false;
+	}
+
+	OutOfCoreSimplification::~OutOfCoreSimplification()
+	{
+
+	}
+
+	bool OutOfCoreSimplification::Simplify(const std::string& strInput, SurfaceMesh* pMesh)
+	{
+		if (!Cluster(strInput))
+		{
+			return false;
+		}
+
+		StopWatch watch;
+		pMesh->clear();
+		SurfaceMeshBuilder builder(pMesh);
+		builder.begin_surface();
+		for (const auto& p : m_vecPoint)
+		{
+			builder.add_vertex(p);
+		}
+		for (std::size_t i = 0; i < m_vecTriangle.size(); i += 3)
+		{
+			builder.add_triangle(SurfaceMesh::Vertex(m_vecTriangle[i]), SurfaceMesh::Vertex(m_vecTriangle[i + 1]),
+								 SurfaceMesh::Vertex(m_vecTriangle[i + 2]));
+		}
+		builder.end_surface();
+		m_Timings.dOutput += watch.elapsed_seconds(4);
+
+		std::vector<vec3>().swap(m_vecPoint);
+		std::vector<int>().swap(m_vecTriangle);
+		return pMesh->n_faces() > 0;
+	}
+
+	bool OutOfCoreSimplification::Simplify(const std::string& strInput, const std::string& strOutput)
+	{
+		if (!Cluster(strInput))
+		{
+			return false;
+		}
+
+		StopWatch watch;
+		const std::string strExtension = file_system::extension(strOutput, true);
+		bool bSuccess = false;
+		if (strExtension == "ply")
+		{
+			bSuccess = WritePly(strOutput);
+		}
+		else if (strExtension == "obj")
+		{
+			bSuccess = WriteObj(strOutput);
+		}
+		else
+		{
+			std::cout << "OutOfCoreSimplification: can only write ply and obj files" << std::endl;
+		}
+		m_Timings.dOutput += watch.elapsed_seconds(4);
+
+		std::vector<vec3>().swap(m_vecPoint);
+		std::vector<int>().swap(m_vecTriangle);
+		return bSuccess;
+	}
+
+	bool OutOfCoreSimplification::Cluster(const std::string& strInput)
+	{
+		m_Timings = OutOfCoreTimings();
+		m_bCanceled = false;
+		m_vecPoint.clear();
+		m_vecTriangle.clear();
+		StopWatch watch;
+
+		// first pass: the bounding box
+		dvec3 boxMin(std::numeric_limits<double>::max());
+		dvec3 boxMax(-std::numeric_limits<double>::max());
+		std::size_t uiVertexCount = 0;
+		const bool bRead = io::MeshStreamReader::read(strInput, [&](const dvec3& p) {
+			for (int k = 0; k < 3; k++)
+			{
+				boxMin[k] = std::min(boxMin[k], p[k]);
+				boxMax[k] = std::max(boxMax[k], p[k]);
+			}
+			uiVertexCount++;
+			return true;
+		}, io::MeshStreamReader::FaceCallback());
+		if (!bRead || uiVertexCount == 0)
+		{
+			std::cout << "OutOfCoreSimplification: no vertices in " << strInput << std::endl;
+			return false;
+		}
+		m_Timings.dBoundingBox = watch.elapsed_seconds(4);
+
+		// the grid of cubic cells; the coordinates are relative to the corner of the box from now on
+		watch.restart();
+		const dvec3 origin = boxMin;
+		const dvec3 extent = boxMax - boxMin;
+		const unsigned int uiResolution = std::max(1u, std::min(m_uiResolution, 1u << 20));
+		double dCellSize = std::max(std::max(extent.x, extent.y), extent.z) / uiResolution;
+		if (dCellSize <= 0.0)
+		{
+			dCellSize = 1.0;
+		}
+		std::uint64_t uiCells[3];
+		for (int k = 0; k < 3; k++)
+		{
+			uiCells[k] = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::ceil(extent[k] / dCellSize)));
+		}
+
+		// second pass: the cell of each vertex, the quadrics of the cells, and the triangles between cells
+		std::unordered_map<std::uint64_t, std::uint32_t> mapCell;     // grid index -> cell
+		std::vector<std::uint64_t> vecGridIndex;                      // cell -> grid index
+		std::vector<Cell> vecCell;
+		VertexStore store(m_uiMemoryBudget);
+		std::unordered_set<CellTriangle, CellTriangleHash> setTriangle;
+		std::vector<std::uint32_t> vecTriangle;
+		std::size_t uiDeclaredVertices = 0, uiDeclaredFaces = 0, uiFaceCount = 0, uiSkippedFaces = 0;
+		io::MeshStreamReader::num_elements(strInput, uiDeclaredVertices, uiDeclaredFaces);
+		ProgressLogger progress(uiVertexCount + uiDeclaredFaces, false);
+		bool bFailed = false;
+
+		auto on_vertex = [&](const dvec3& p) -> bool {
+			const dvec3 q = p - origin;
+			std::uint64_t uiIndex = 0;
+			for (int k = 2; k >= 0; k--)
+			{
+				const std::uint64_t i = static_cast<std::uint64_t>(std::max(0.0, q[k] / dCellSize));
+				uiIndex = (uiIndex << 21) | std::min(i, uiCells[k] - 1);
+			}
+			const auto result = mapCell.emplace(uiIndex, static_cast<std::uint32_t>(vecCell.size()));
+			if (result.second)
+			{
+				Cell cell;
+				std::fill(cell.q, cell.q + 10, 0.0);
+				cell.sum = dvec3(0.0, 0.0, 0.0);
+				cell.uiCount = 0;
+				vecCell.push_back(cell);
+				vecGridIndex.push_back(uiIndex);
+			}
+			Cell& cell = vecCell[result.first->second];
+			cell.sum += q;
+			cell.uiCount++;
+
+			VertexRecord record;
+			for (int k = 0; k < 3; k++)
+			{
+				record.p[k] = static_cast<float>(q[k]);
+			}
+			record.uiCell = result.first->second;
+			if (!store.Push(record))
+			{
+				bFailed = true;
+				return false;
+			}
+			progress.next();
+			return true;
+		};
+
+		auto on_face = [&](const int* pIndices, std::size_t uiSize) -> bool {
+			if ((++uiFaceCount & 0xFFFF) == 0 && progress.is_canceled())
+			{
+				m_bCanceled = true;
+				return false;
+			}
+			progress.next();
+			for (std::size_t i = 0; i < uiSize; i++)
+			{
+				if (pIndices[i] < 0 || static_cast<std::size_t>(pIndices[i]) >= store.GetSize())
+				{
+					uiSkippedFaces++;
+					return true;
+				}
+			}
+
+			// a polygon is split into a fan of triangles
+			VertexRecord r0, r1, r2;
+			if (!store.Get(pIndices[0], r0))
+			{
+				bFailed = true;
+				return false;
+			}
+			const dvec3 p0(r0.p[0], r0.p[1], r0.p[2]);
+			for (std::size_t i = 1; i + 1 < uiSize; i++)
+			{
+				if (!store.Get(pIndices[i], r1) || !store.Get(pIndices[i + 1], r2))
+				{
+					bFailed = true;
+					return false;
+				}
+				const std::uint32_t c0 = r0.uiCell, c1 = r1.uiCell, c2 = r2.uiCell;
+
+				// the plane of the triangle, weighted by its area, goes to the cells of its corners
+				const dvec3 p1(r1.p[0], r1.p[1], r1.p[2]), p2(r2.p[0], r2.p[1], r2.p[2]);
+				const dvec3 n = cross(p1 - p0, p2 - p0);
+				const double dLength = norm(n);
+				if (dLength > 0.0)
+				{
+					const dvec3 u = n / dLength;
+					const double d = -dot(u, p0);
+					const double w = 0.5 * dLength;
+					const double plane[10] = {
+						w * u.x * u.x, w * u.x * u.y, w * u.x * u.z, w * u.x * d,
+						w * u.y * u.y, w * u.y * u.z, w * u.y * d,
+						w * u.z * u.z, w * u.z * d,
+						w * d * d
+					};
+					for (std::uint32_t c : { c0, c1, c2 })
+					{
+						for (int k = 0; k < 10; k++)
+						{
+							vecCell[c].q[k] += plane[k];
+						}
+					}
+				}
+
+				if (c0 == c1 || c1 == c2 || c2 == c0)
+				{
+					continue;
+				}
+				// the same triangle comes from many faces; it is kept once, starting at its smallest cell
+				CellTriangle t;
+				if (c0 < c1 && c0 < c2)
+				{
+					t = { { c0, c1, c2 } };
+				}
+				else if (c1 < c2)
+				{
+					t = { { c1, c2, c0 } };
+				}
+				else
+				{
+					t = { { c2, c0, c1 } };
+				}
+				if (setTriangle.insert(t).second)
+				{
+					vecTriangle.insert(vecTriangle.end(), { t.c[0], t.c[1], t.c[2] });
+				}
+			}
+			return true;
+		};
+
+		const bool bClustered = io::MeshStreamReader::read(strInput, on_vertex, on_face);
+		const bool bOnDisk = store.IsOnDisk();
+		m_Timings.dClustering = watch.elapsed_seconds(4);
+		if (!bClustered || bFailed || m_bCanceled)
+		{
+			std::cout << "OutOfCoreSimplification: "
+					  << (m_bCanceled ? "canceled" : (bFailed ? "failed to page the vertices" : "failed to read the faces"))
+					  << std::endl;
+			return false;
+		}
+		std::unordered_set<CellTriangle, CellTriangleHash>().swap(setTriangle);
+		std::unordered_map<std::uint64_t, std::uint32_t>().swap(mapCell);
+
+		// one vertex per cell used by a triangle, in the order of their first use
+		watch.restart();
+		std::vector<int> vecOutputIndex(vecCell.size(), -1);
+		m_vecTriangle.reserve(vecTriangle.size());
+		for (std::uint32_t c : vecTriangle)
+		{
+			if (vecOutputIndex[c] < 0)
+			{
+				vecOutputIndex[c] = static_cast<int>(m_vecPoint.size());
+				const std::uint64_t uiIndex = vecGridIndex[c];
+				const dvec3 cellMin(static_cast<double>(uiIndex & 0x1FFFFF) * dCellSize,
+									static_cast<double>((uiIndex >> 21) & 0x1FFFFF) * dCellSize,
+									static_cast<double>(uiIndex >> 42) * dCellSize);
+				m_vecPoint.push_back(vec3(origin + CellPosition(vecCell[c], cellMin, dCellSize)));
+			}
+			m_vecTriangle.push_back(vecOutputIndex[c]);
+		}
+		m_Timings.dOutput = watch.elapsed_seconds(4);
+
+		std::cout << "OutOfCoreSimplification: " << uiVertexCount << " vertices and " << uiFaceCount << " faces -> "
+				  << m_vecPoint.size() << " vertices and " << m_vecTriangle.size() / 3 << " triangles ("
+				  << vecCell.size() << " occupied cells"
+				  << (uiSkippedFaces > 0 ? ", " + std::to_string(uiSkippedFaces) + " faces with undefined vertices skipped" : "") << (bOnDisk ? ", vertices paged to disk" : "")
+				  << "; bounding box " << m_Timings.dBoundingBox << "s, clustering " << m_Timings.dClustering
+				  << "s)" << std::endl;
+		return !m_vecTriangle.empty();
+	}
+
+	bool OutOfCoreSimplification::WritePly(const std::string& strOutput) const
+	{
+		io::Element vertices("vertex", m_vecPoint.size());
+		vertices.vec3_properties.emplace_back("point", m_vecPoint);
+
+		io::Element faces("face", m_vecTriangle.size() / 3);
+		io::IntListProperty indices("vertex_indices");
+		indices.reserve(m_vecTriangle.size() / 3);
+		for (std::size_t i = 0; i < m_vecTriangle.size(); i += 3)
+		{
+			indices.push_back({ m_vecTriangle[i], m_vecTriangle[i + 1], m_vecTriangle[i + 2] });
+		}
+		faces.int_list_properties.emplace_back(indices);
+
+		return io::PlyWriter::write(strOutput, { vertices, faces }, "", true);
+	}
+
+	bool OutOfCoreSimplification::WriteObj(const std::string& strOutput) const
+	{
+		std::ofstream output(strOutput.c_str());
+		if (output.fail())
+		{
+			std::cout << "OutOfCoreSimplification: could not open " << strOutput << std::endl;
+			return false;
+		}
+		for (const auto& p : m_vecPoint)
+		{
+			output << "v " << p << "\n";
+		}
+		for (std::size_t i = 0; i < m_vecTriangle.size(); i += 3)
+		{
+			output << "f " << m_vecTriangle[i] + 1 << " " << m_vecTriangle[i + 1] + 1 << " " << m_vecTriangle[i + 2] + 1 << "\n";
+		}
+		return !output.fail();
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "../core/surface_mesh.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace MV
+{
+	// wall-clock time of the phases of the last simplification, in seconds
+	struct OutOfCoreTimings
+	{
+		double dBoundingBox = 0.0;  // first pass over the vertices
+		double dClustering = 0.0;   // second pass over the vertices and the faces
+		double dOutput = 0.0;       // the positions of the clusters and the output mesh or file
+	};
+
+	// Vertex clustering simplification of meshes that do not fit in memory (Lindstrom 2000, "Out-of-core
+	// simplification of large polygonal models"). The file is read twice through io::MeshStreamReader, and is never
+	// loaded: the first pass finds its bounding box, which is divided into a grid of cells. In the second pass, each
+	// face adds the quadric of its plane to the cells of its vertices, and the faces whose vertices fall into three
+	// different cells become the triangles of the output. Each cell becomes one vertex, placed where its quadric is
+	// the smallest. The output may be non-manifold where thin parts collapse.
+	//
+	// Only the quadrics of the occupied cells and the output triangles are kept, plus the position (in single
+	// precision, relative to the corner of the box) and the cell of each vertex of the file, which its faces need.
+	// These 16 bytes per vertex are kept in memory while they fit in the memory budget, and move to a temporary file
+	// otherwise, of which only a budget-sized set of pages is cached. The peak memory is thus the budget plus what
+	// the output needs.
+	class OutOfCoreSimplification
+	{
+	public:
+		OutOfCoreSimplification();
+		~OutOfCoreSimplification();
+
+		// the number of cells along the longest side of the bounding box (default: 256)
+		void SetGridResolution(unsigned int uiResolution) { m_uiResolution = uiResolution; }
+		unsigned int GetGridResolution() const { return m_uiResolution; }
+
+		// the memory in bytes for the positions and the cells of the input vertices (default: 256 MB)
+		void SetMemoryBudget(std::size_t uiBytes) { m_uiMemoryBudget = uiBytes; }
+		std::size_t GetMemoryBudget() const { return m_uiMemoryBudget; }
+
+		// Simplifies the mesh stored in the PLY or OBJ file strInput into pMesh. Returns false on errors, or if the
+		// file has no faces.
+		bool Simplify(const std::string& strInput, SurfaceMesh* pMesh);
+
+		// Simplifies the mesh stored in strInput and writes the result to strOutput (binary PLY or OBJ) without
+		// building a SurfaceMesh, so the non-manifold parts are written as they are.
+		bool Simplify(const std::string& strInput, const std::string& strOutput);
+
+		// true if the last Simplify() was canceled through its ProgressLogger (nothing is output then)
+		bool IsCanceled() const { return m_bCanceled; }
+
+		const OutOfCoreTimings& GetTimings() const { return m_Timings; }
+
+	private:
+		class VertexStore;
+
+		// both passes over the file; fills m_vecPoint and m_vecTriangle
+		bool Cluster(const std::string& strInput);
+		bool WritePly(const std::string& strOutput) const;
+		bool WriteObj(const std::string& strOutput) const;
+
+	private:
+		unsigned int m_uiResolution;
+		std::size_t m_uiMemoryBudget;
+		bool m_bCanceled;
+		OutOfCoreTimings m_Timings;
+
+		// the result of Cluster(): one point per used cell, and the triangles between them
+		std::vector<vec3> m_vecPoint;
+		std::vector<int> m_vecTriangle;
+	};
+}
@@ -0,0 +1,219 @@
+#include "triangle_tree.h"
+#include <algorithm>
+#include <limits>
+
+namespace MV
+{
+	namespace
+	{
+		// the leaves hold at most this many triangles
+		const int kLeafSize = 4;
+
+		// The point of triangle (a, b, c) closest to p, as barycentric coordinates (Ericson, "Real-Time Collision
+		// Detection", 5.1.5): the regions of the corners and of the edges are tested before the interior.
+		dvec3 ClosestOnTriangle(const dvec3& p, const dvec3& a, const dvec3& b, const dvec3& c)
+		{
+			const dvec3 ab = b - a, ac = c - a, ap = p - a;
+			const double d1 = dot(ab, ap), d2 = dot(ac, ap);
+			if (d1 <= 0.0 && d2 <= 0.0)
+			{
+				return dvec3(1.0, 0.0, 0.0);
+			}
+
+			const dvec3 bp = p - b;
+			const double d3 = dot(ab, bp), d4 = dot(ac, bp);
+			if (d3 >= 0.0 && d4 <= d3)
+			{
+				return dvec3(0.0, 1.0, 0.0);
+			}
+
+			const double vc = d1 * d4 - d3 * d2;
+			if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+			{
+				const double v = d1 / (d1 - d3);
+				return dvec3(1.0 - v, v, 0.0);
+			}
+
+			const dvec3 cp = p - c;
+			const double d5 = dot(ab, cp), d6 = dot(ac, cp);
+			if (d6 >= 0.0 && d5 <= d6)
+			{
+				return dvec3(0.0, 0.0, 1.0);
+			}
+
+			const double vb = d5 * d2 - d1 * d6;
+			if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+			{
+				const double w = d2 / (d2 - d6);
+				return dvec3(1.0 - w, 0.0, w);
+			}
+
+			const double va = d3 * d6 - d5 * d4;
+			if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+			{
+				const double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+				return dvec3(0.0, 1.0 - w, w);
+			}
+
+			const double dDenom = va + vb + vc;
+			if (dDenom <= 0.0)   // degenerate triangle: its first corner
+			{
+				return dvec3(1.0, 0.0, 0.0);
+			}
+			const double v = vb / dDenom, w = vc / dDenom;
+			return dvec3(1.0 - v - w, v, w);
+		}
+
+		// the squared distance of p to the box [lo, hi]
+		inline double BoxDistance2(const vec3& p, const vec3& lo, const vec3& hi)
+		{
+			double d2 = 0.0;
+			for (int k = 0; k < 3; k++)
+			{
+				const double d = std::max(std::max(static_cast<double>(lo[k]) - p[k], 0.0),
+										  static_cast<double>(p[k]) - hi[k]);
+				d2 += d * d;
+			}
+			return d2;
+		}
+	}
+
+	TriangleTree::TriangleTree()
+	{
+
+	}
+
+	TriangleTree::~TriangleTree()
+	{
+
+	}
+
+	void TriangleTree::Build(const std::vector<vec3>& vecPoints, const std::vector<int>& vecTriangles)
+	{
+		m_vecPoint = vecPoints;
+		m_vecTriangle = vecTriangles;
+		m_vecNode.clear();
+		const int iTriangleCount = static_cast<int>(m_vecTriangle.size() / 3);
+		m_vecOrder.resize(iTriangleCount);
+		if (iTriangleCount == 0)
+		{
+			return;
+		}
+
+		std::vector<vec3> vecCentroid(iTriangleCount);
+		for (int t = 0; t < iTriangleCount; t++)
+		{
+			m_vecOrder[t] = t;
+			vecCentroid[t] = (m_vecPoint[m_vecTriangle[3 * t]] + m_vecPoint[m_vecTriangle[3 * t + 1]] +
+							  m_vecPoint[m_vecTriangle[3 * t + 2]]) / 3.0f;
+		}
+		m_vecNode.reserve(2 * (iTriangleCount / kLeafSize + 1));
+		m_vecNode.push_back(Node());
+		BuildNode(0, 0, iTriangleCount, vecCentroid);
+	}
+
+	void TriangleTree::BuildNode(int iNode, int iFirst, int iCount, const std::vector<vec3>& vecCentroid)
+	{
+		vec3 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+		vec3 centroidLo = lo, centroidHi = hi;
+		for (int i = iFirst; i < iFirst + iCount; i++)
+		{
+			const int t = m_vecOrder[i];
+			for (int k = 0; k < 3; k++)
+			{
+				const vec3& p = m_vecPoint[m_vecTriangle[3 * t + k]];
+				lo = comp_min(lo, p);
+				hi = comp_max(hi, p);
+			}
+			centroidLo = comp_min(centroidLo, vecCentroid[t]);
+			centroidHi = comp_max(centroidHi, vecCentroid[t]);
+		}
+		Node& node = m_vecNode[iNode];
+		node.lo = lo;
+		node.hi = hi;
+		node.iFirst = iFirst;
+		node.iCount = iCount;
+		node.iLeft = -1;
+		if (iCount <= kLeafSize)
+		{
+			return;
+		}
+
+		// the triangles are split at the median of their centroids along the longest side
+		const vec3 extent = centroidHi - centroidLo;
+		const int iAxis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+		const int iHalf = iCount / 2;
+		std::nth_element(m_vecOrder.begin() + iFirst, m_vecOrder.begin() + iFirst + iHalf,
+						 m_vecOrder.begin() + iFirst + iCount, [&](int a, int b) {
+							 return vecCentroid[a][iAxis] < vecCentroid[b][iAxis];
+						 });
+
+		// the children are stored next to each other (node is invalidated by the push_back)
+		const int iLeft = static_cast<int>(m_vecNode.size());
+		m_vecNode[iNode].iLeft = iLeft;
+		m_vecNode.push_back(Node());
+		m_vecNode.push_back(Node());
+		BuildNode(iLeft, iFirst, iHalf, vecCentroid);
+		BuildNode(iLeft + 1, iFirst + iHalf, iCount - iHalf, vecCentroid);
+	}
+
+	int TriangleTree::ClosestPoint(const vec3& p, vec3& closest, vec3& barycentric) const
+	{
+		if (m_vecNode.empty())
+		{
+			return -1;
+		}
+
+		const dvec3 q(p);
+		double dBest2 = std::numeric_limits<double>::max();
+		int iBest = -1;
+		int stack[64];
+		int iTop = 0;
+		stack[iTop++] = 0;
+		while (iTop > 0)
+		{
+			const Node& node = m_vecNode[stack[--iTop]];
+			if (BoxDistance2(p, node.lo, node.hi) >= dBest2)
+			{
+				continue;
+			}
+			if (node.iLeft < 0)
+			{
+				for (int i = node.iFirst; i < node.iFirst + node.iCount; i++)
+				{
+					const int t = m_vecOrder[i];
+					const dvec3 a(m_vecPoint[m_vecTriangle[3 * t]]);
+					const dvec3 b(m_vecPoint[m_vecTriangle[3 * t + 1]]);
+					const dvec3 c(m_vecPoint[m_vecTriangle[3 * t + 2]]);
+					const dvec3 bary = ClosestOnTriangle(q, a, b, c);
+					const dvec3 x = bary.x * a + bary.y * b + bary.z * c;
+					const double d2 = length2(x - q);
+					if (d2 < dBest2)
+					{
+						dBest2 = d2;
+						iBest = t;
+						closest = vec3(x);
+						barycentric = vec3(bary);
+					}
+				}
+				continue;
+			}
+
+			// the nearer child is visited first, so it is pushed last
+			const int iLeft = node.iLeft, iRight = node.iLeft + 1;
+			const double dLeft2 = BoxDistance2(p, m_vecNode[iLeft].lo, m_vecNode[iLeft].hi);
+			const double dRight2 = BoxDistance2(p, m_vecNode[iRight].lo, m_vecNode[iRight].hi);
+			if (dLeft2 < dRight2)
+			{
+				stack[iTop++] = iRight;
+				stack[iTop++] = iLeft;
+			}
+			else
+			{
+				stack[iTop++] = iLeft;
+				stack[iTop++] = iRight;
+			}
+		}
+		return iBest;
+	}
+}
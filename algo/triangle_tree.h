@@ -0,0 +1,43 @@
+#pragma once
+
+#include "../core/types.h"
+#include <vector>
+
+namespace MV
+{
+	// A bounding volume hierarchy over a set of triangles, for closest point queries (e.g., to project points back
+	// onto a surface that is being modified). The tree keeps its own copy of the triangles, and the queries are const,
+	// so they can run in parallel.
+	class TriangleTree
+	{
+	public:
+		TriangleTree();
+		~TriangleTree();
+
+		// vecTriangles holds three indices into vecPoints per triangle
+		void Build(const std::vector<vec3>& vecPoints, const std::vector<int>& vecTriangles);
+		bool IsEmpty() const { return m_vecNode.empty(); }
+
+		// Returns the triangle closest to p (-1 if the tree is empty), the closest point on it, and the
+		// barycentric coordinates of that point with respect to the corners of the triangle.
+		int ClosestPoint(const vec3& p, vec3& closest, vec3& barycentric) const;
+
+	private:
+		struct Node
+		{
+			vec3 lo, hi;
+			int iLeft;      // -1 for a leaf; the right child follows the left one
+			int iFirst;     // the triangles of a leaf are m_vecOrder[iFirst .. iFirst + iCount)
+			int iCount;
+		};
+
+		// fills node iNode with the triangles m_vecOrder[iFirst .. iFirst + iCount), and splits it
+		void BuildNode(int iNode, int iFirst, int iCount, const std::vector<vec3>& vecCentroid);
+
+	private:
+		std::vector<vec3> m_vecPoint;
+		std::vector<int> m_vecTriangle;
+		std::vector<int> m_vecOrder;
+		std::vector<Node> m_vecNode;
+	};
+}
@@ -0,0 +1,120 @@
+// Micro-benchmark and accuracy test of GaussianWeightKernel (algo/gaussian_weight.h).
+//
+// It is a standalone program: the file is listed in the project but excluded from the application build.
+// Build it together with algo/gaussian_weight.cpp, e.g.
+//     g++ -O2 -std=c++17 bench/gaussian_weight_benchmark.cpp algo/gaussian_weight.cpp -o gaussian_weight_benchmark
+//     cl /O2 /std:c++17 /EHsc bench\gaussian_weight_benchmark.cpp algo\gaussian_weight.cpp
+//
+// The accuracy test compares FastExp() and every kernel supported by the CPU with std::exp in double
+// precision; the program returns 1 if an error bound documented in gaussian_weight.h is exceeded.
+
+#include "../algo/gaussian_weight.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace MV;
+
+namespace
+{
+    // the relative error bound of FastExp() on [-86, 88], see gaussian_weight.h
+    const double dFastExpBound = 2e-7;
+
+    // The argument f * |d|^2 is rounded to float before the exponential, which alone costs up to |x| float ulps
+    // of relative error; the kernels are checked against err / (1 + |x|) <= dKernelBound.
+    const double dKernelBound = 3e-7;
+
+    // the relative error of FastExp() over [-86, 88], sampled every 1e-4
+    double FastExpError(float& fWorst)
+    {
+        double dMaxError = 0.0;
+        fWorst = 0.0f;
+        for (int i = 0; i <= 1740000; i++)
+        {
+            const float x = -86.0f + 1e-4f * i;
+            const double dExact = std::exp(static_cast<double>(x));
+            const double dError = std::fabs(FastExp(x) - dExact) / dExact;
+            if (dError > dMaxError)
+            {
+                dMaxError = dError;
+                fWorst = x;
+            }
+        }
+        return dMaxError;
+    }
+}
+
+int main()
+{
+    bool bPassed = true;
+
+    float fWorst = 0.0f;
+    const double dFastExpError = FastExpError(fWorst);
+    std::printf("FastExp: max relative error %.3g at x = %g (bound %.3g), FastExp(-90) = %g\n", dFastExpError,
+                fWorst, dFastExpBound, FastExp(-90.0f));
+    bPassed = bPassed && dFastExpError <= dFastExpBound && FastExp(-90.0f) == 0.0f;
+
+    // differences of unit normals and scales of the order of a face area, as in the bilateral filters; the
+    // count is not a multiple of 8, so the tails of the SIMD paths are exercised as well
+    const std::size_t uiCount = (std::size_t(1) << 20) - 3;
+    const int iRepeats = 20;
+    std::vector<float> vecDX(uiCount), vecDY(uiCount), vecDZ(uiCount), vecScale(uiCount), vecWeight(uiCount);
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+    for (std::size_t i = 0; i < uiCount; i++)
+    {
+        vecDX[i] = distribution(generator);
+        vecDY[i] = distribution(generator);
+        vecDZ[i] = distribution(generator);
+        vecScale[i] = distribution(generator) + 1.0f;
+    }
+    const float fFactor = -0.5f / (0.35f * 0.35f);
+
+    double dScalarTime = 0.0;
+    const WeightKernelType types[] = { WeightKernelType::Scalar, WeightKernelType::SSE, WeightKernelType::AVX2 };
+    for (WeightKernelType eType : types)
+    {
+        if (!GaussianWeightKernel::IsSupported(eType))
+        {
+            std::printf("%-6s: not supported by this CPU\n", GaussianWeightKernel::GetTypeName(eType));
+            continue;
+        }
+        GaussianWeightKernel kernel(eType);
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < iRepeats; r++)
+        {
+            kernel.Evaluate(vecDX.data(), vecDY.data(), vecDZ.data(), vecScale.data(), fFactor, uiCount,
+                            vecWeight.data());
+        }
+        const double dTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (eType == WeightKernelType::Scalar)
+        {
+            dScalarTime = dTime;
+        }
+
+        double dMaxError = 0.0;
+        for (std::size_t i = 0; i < uiCount; i++)
+        {
+            const double d2 = (double)vecDX[i] * vecDX[i] + (double)vecDY[i] * vecDY[i] + (double)vecDZ[i] * vecDZ[i];
+            const double x = fFactor * d2;
+            const double dExact = vecScale[i] * std::exp(x);
+            if (dExact > 1e-30)
+            {
+                dMaxError = std::max(dMaxError, std::fabs(vecWeight[i] - dExact) / dExact / (1.0 + std::fabs(x)));
+            }
+        }
+        bPassed = bPassed && dMaxError <= dKernelBound;
+
+        std::printf("%-6s: %.2f ns per weight (%.2fx scalar), max relative error / (1 + |x|) %.3g (bound %.3g)\n",
+                    GaussianWeightKernel::GetTypeName(eType), 1e9 * dTime / iRepeats / uiCount,
+                    dTime > 0.0 ? dScalarTime / dTime : 0.0, dMaxError, dKernelBound);
+    }
+
+    std::printf("%s\n", bPassed ? "passed" : "FAILED");
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+// Benchmark and accuracy test of the batch normal kernels of core/normals.h against the per-element API.
+//
+// It is a standalone program: the file is listed in the project but excluded from the application build.
+// Build it together with the core sources it uses, e.g.
+//     g++ -O2 -std=c++17 -pthread -DELPP_STL_LOGGING -DELPP_THREAD_SAFE bench/normals_benchmark.cpp core/normals.cpp
+//         core/surface_mesh.cpp core/compact_tri_mesh.cpp core/model.cpp 3dparty/easyloggingpp/easylogging++.cc
+//         -o normals_benchmark
+//
+// The test mesh is a noisy torus of quads and triangles, so the polygon paths are exercised as well. The face
+// normals of face_normals() have to match face_normal(), and the angle weighted normals of vertex_normals() have
+// to match vertex_normal(); the program returns 1 if they differ by more than dBound.
+
+#include "../core/normals.h"
+#include "../util/parallel.h"
+#include "../3dparty/easyloggingpp/easylogging++.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+INITIALIZE_EASYLOGGINGPP
+
+using namespace MV;
+
+namespace
+{
+    // the largest distance between the unit normals of the two APIs (they sum the same terms in another order)
+    const double dBound = 1e-5;
+
+    // a torus of iRings x iSegments quads, the quads of every other ring split into two triangles
+    SurfaceMesh MakeTorus(int iRings, int iSegments, float fNoise)
+    {
+        SurfaceMesh mesh;
+        std::mt19937 generator(1);
+        std::uniform_real_distribution<float> distribution(-fNoise, fNoise);
+        std::vector<SurfaceMesh::Vertex> vecVertex;
+        for (int i = 0; i < iRings; i++)
+        {
+            for (int j = 0; j < iSegments; j++)
+            {
+                const float u = 6.2831853f * i / iRings, v = 6.2831853f * j / iSegments;
+                const float r = 0.4f + distribution(generator);
+                vecVertex.push_back(mesh.add_vertex(vec3((1.0f + r * std::cos(v)) * std::cos(u),
+                                                         (1.0f + r * std::cos(v)) * std::sin(u), r * std::sin(v))));
+            }
+        }
+        auto vertex = [&](int i, int j) { return vecVertex[(i % iRings) * iSegments + j % iSegments]; };
+        for (int i = 0; i < iRings; i++)
+        {
+            for (int j = 0; j < iSegments; j++)
+            {
+                const SurfaceMesh::Vertex a = vertex(i, j), b = vertex(i + 1, j);
+                const SurfaceMesh::Vertex c = vertex(i + 1, j + 1), d = vertex(i, j + 1);
+                if (i % 2 == 0)
+                {
+                    mesh.add_quad(a, b, c, d);
+                }
+                else
+                {
+                    mesh.add_triangle(a, b, c);
+                    mesh.add_triangle(a, c, d);
+                }
+            }
+        }
+        return mesh;
+    }
+
+    template <typename Func>
+    double Time(const Func& func, int iRepeats)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < iRepeats; r++)
+        {
+            func();
+        }
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / iRepeats;
+    }
+}
+
+int main()
+{
+    SurfaceMesh mesh = MakeTorus(1000, 700, 0.01f);
+    std::printf("%u vertices, %u faces, %u threads\n", mesh.n_vertices(), mesh.n_faces(), default_thread_count());
+    const int iRepeats = 5;
+
+    // per-element API
+    std::vector<Normal> vecFace(mesh.faces_size()), vecVertex(mesh.vertices_size());
+    const double dFaceTime = Time([&]() {
+        for (auto f : mesh.faces())
+        {
+            vecFace[f.idx()] = face_normal(mesh, f);
+        }
+    }, iRepeats);
+    const double dVertexTime = Time([&]() {
+        for (auto v : mesh.vertices())
+        {
+            vecVertex[v.idx()] = vertex_normal(mesh, v);
+        }
+    }, iRepeats);
+    std::printf("per element      : faces %.4f s, vertices %.4f s\n", dFaceTime, dVertexTime);
+
+    bool bPassed = true;
+    const unsigned int threads[] = { 1, 0 };
+    for (unsigned int uiThreads : threads)
+    {
+        const double dBatchFaceTime = Time([&]() { face_normals(mesh, uiThreads); }, iRepeats);
+        double dFaceError = 0.0;
+        auto fnormal = mesh.get_face_property<Normal>("f:normal");
+        for (auto f : mesh.faces())
+        {
+            dFaceError = std::max(dFaceError, static_cast<double>(distance(fnormal[f], vecFace[f.idx()])));
+        }
+
+        // the batch vertex pass includes the face normals
+        double dBatchVertexTime[3];
+        const NormalWeighting weightings[] = { NormalWeighting::Angle, NormalWeighting::Area,
+                                               NormalWeighting::Uniform };
+        for (int k = 2; k >= 0; k--)
+        {
+            dBatchVertexTime[k] = Time([&]() { vertex_normals(mesh, weightings[k], uiThreads); }, iRepeats);
+        }
+        double dVertexError = 0.0;
+        auto vnormal = mesh.get_vertex_property<Normal>("v:normal");
+        for (auto v : mesh.vertices())
+        {
+            dVertexError = std::max(dVertexError, static_cast<double>(distance(vnormal[v], vecVertex[v.idx()])));
+        }
+        bPassed = bPassed && dFaceError <= dBound && dVertexError <= dBound;
+
+        std::printf("batch, %2u threads: faces %.4f s (%.2fx), vertices %.4f s (%.2fx), area %.4f s, uniform %.4f s\n",
+                    uiThreads == 0 ? default_thread_count() : uiThreads, dBatchFaceTime, dFaceTime / dBatchFaceTime,
+                    dBatchVertexTime[0], dVertexTime / dBatchVertexTime[0], dBatchVertexTime[1], dBatchVertexTime[2]);
+        std::printf("                   max difference: faces %.3g, vertices %.3g (bound %.3g)\n", dFaceError,
+                    dVertexError, dBound);
+    }
+
+    std::printf("%s\n", bPassed ? "passed" : "FAILED");
+    return bPassed ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+#include "compact_tri_mesh.h"
+#include "surface_mesh.h"
+#include "../util/parallel.h"
+
+
+namespace MV {
+
+    CompactTriMesh::CompactTriMesh(std::vector<vec3> points, std::vector<unsigned int> indices)
+            : points_(std::move(points))
+    {
+        set_indices(std::move(indices));
+    }
+
+
+    CompactTriMesh::CompactTriMesh(const SurfaceMesh& mesh)
+    {
+        // new index of each vertex (the deleted ones are skipped)
+        std::vector<unsigned int> index(mesh.vertices_size());
+        points_.reserve(mesh.n_vertices());
+        for (auto v : mesh.vertices()) {
+            index[v.idx()] = static_cast<unsigned int>(points_.size());
+            points_.push_back(mesh.position(v));
+        }
+
+        indices_.reserve(mesh.n_faces() * 3);
+        for (auto f : mesh.faces()) {
+            auto h = mesh.halfedge(f);
+            const unsigned int v0 = index[mesh.source(h).idx()];
+            h = mesh.next(h);
+            unsigned int v1 = index[mesh.source(h).idx()];
+            // a triangle fan around the first vertex
+            for (h = mesh.next(h); h != mesh.halfedge(f); h = mesh.next(h)) {
+                const unsigned int v2 = index[mesh.source(h).idx()];
+                indices_.push_back(v0);
+                indices_.push_back(v1);
+                indices_.push_back(v2);
+                v1 = v2;
+            }
+        }
+    }
+
+
+    std::size_t CompactTriMesh::to_surface_mesh(SurfaceMesh& mesh) const
+    {
+        mesh.clear();
+        mesh.reserve(static_cast<unsigned int>(n_vertices()), static_cast<unsigned int>(n_corners() / 2),
+                     static_cast<unsigned int>(n_triangles()));
+        for (const auto& p : points_)
+            mesh.add_vertex(p);
+
+        std::size_t num_failed = 0;
+        for (std::size_t c = 0; c < indices_.size(); c += 3) {
+            const auto f = mesh.add_triangle(SurfaceMesh::Vertex(static_cast<int>(indices_[c])),
+                                             SurfaceMesh::Vertex(static_cast<int>(indices_[c + 1])),
+                                             SurfaceMesh::Vertex(static_cast<int>(indices_[c + 2])));
+            if (!f.is_valid())
+                ++num_failed;
+        }
+        return num_failed;
+    }
+
+
+    void CompactTriMesh::set_indices(std::vector<unsigned int> indices)
+    {
+        indices_ = std::move(indices);
+        indices_.resize(indices_.size() - indices_.size() % 3);
+        release_adjacency();
+    }
+
+
+    int CompactTriMesh::opposite(int c) const
+    {
+        if (!has_adjacency())
+            build_adjacency();
+        return opposite_[c];
+    }
+
+
+    const std::vector<int>& CompactTriMesh::vertex_corner_offsets() const
+    {
+        if (!has_adjacency())
+            build_adjacency();
+        return corner_offsets_;
+    }
+
+
+    const std::vector<int>& CompactTriMesh::vertex_corners() const
+    {
+        if (!has_adjacency())
+            build_adjacency();
+        return corners_;
+    }
+
+
+    void CompactTriMesh::build_adjacency() const
+    {
+        const int num_corners = static_cast<int>(indices_.size());
+
+        // the corners at each vertex, in CSR form (a counting sort keeps them in increasing order)
+        corner_offsets_.assign(points_.size() + 1, 0);
+        for (auto v : indices_)
+            ++corner_offsets_[v + 1];
+        for (std::size_t v = 0; v < points_.size(); ++v)
+            corner_offsets_[v + 1] += corner_offsets_[v];
+        corners_.resize(num_corners);
+        std::vector<int> pos(corner_offsets_.begin(), corner_offsets_.end() - 1);
+        for (int c = 0; c < num_corners; ++c)
+            corners_[pos[indices_[c]]++] = c;
+
+        // The edge opposite to c goes from a = vertex(next(c)) to b = vertex(prev(c)). The triangle on the other
+        // side has a corner e at b with vertex(next(e)) == a, and prev(e) faces c. The edge is manifold if this
+        // is the only such corner and a -> b is not used by another triangle either.
+        opposite_.resize(num_corners);
+        parallel_for(0, num_corners, [&](std::size_t i) {
+            const int c = static_cast<int>(i);
+            const unsigned int a = indices_[next(c)];
+            const unsigned int b = indices_[prev(c)];
+            int found = -1, count = 0;
+            for (int k = corner_offsets_[b]; k < corner_offsets_[b + 1]; ++k) {
+                const int e = corners_[k];
+                if (indices_[next(e)] == a) {
+                    found = prev(e);
+                    ++count;
+                }
+            }
+            int same = 0;
+            for (int k = corner_offsets_[a]; k < corner_offsets_[a + 1]; ++k) {
+                if (indices_[next(corners_[k])] == b)
+                    ++same;
+            }
+            opposite_[c] = (count == 1 && same == 1) ? found : -1;
+        });
+    }
+
+
+    void CompactTriMesh::release_adjacency() const
+    {
+        std::vector<int>().swap(opposite_);
+        std::vector<int>().swap(corner_offsets_);
+        std::vector<int>().swap(corners_);
+    }
+
+
+    std::size_t CompactTriMesh::memory_usage() const
+    {
+        return points_.capacity() * sizeof(vec3) + indices_.capacity() * sizeof(unsigned int)
+               + (opposite_.capacity() + corner_offsets_.capacity() + corners_.capacity()) * sizeof(int);
+    }
+
+}   // namespace MV
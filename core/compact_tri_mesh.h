@@ -0,0 +1,97 @@
+#ifndef EASY3D_CORE_COMPACT_TRI_MESH_H
+#define EASY3D_CORE_COMPACT_TRI_MESH_H
+
+#include <vector>
+
+#include "types.h"
+
+
+namespace MV {
+
+    class SurfaceMesh;
+
+    /**
+     * \brief A compact representation of a triangle mesh for read-mostly workloads (viewing, measuring, filtering).
+     * \class CompactTriMesh MV/core/compact_tri_mesh.h
+     * \details The mesh is stored as an indexed triangle list: the vertex positions and three vertex indices per
+     *      triangle. Corner c (0 <= c < 3 * n_triangles()) is the c % 3-th corner of triangle c / 3. This takes
+     *      about a third of the memory of a SurfaceMesh, which also stores the halfedge connectivity and the
+     *      deleted flags. The adjacency is only built when it is first queried:
+     *      - the corners incident to each vertex (vertex_corners()), and
+     *      - the opposite corner of each corner (opposite()), i.e., the corner facing it across its opposite edge.
+     *      Building the adjacency from a const method is not thread-safe: call build_adjacency() before sharing
+     *      the mesh between threads.
+     */
+    class CompactTriMesh
+    {
+    public:
+        CompactTriMesh() = default;
+
+        /// Takes the positions and the vertex indices (three per triangle).
+        CompactTriMesh(std::vector<vec3> points, std::vector<unsigned int> indices);
+
+        /// Converts a SurfaceMesh (in O(n)). Polygons are triangulated as fans, deleted elements are skipped.
+        explicit CompactTriMesh(const SurfaceMesh& mesh);
+
+        /// Converts the mesh into \p mesh (in O(n)), which is cleared first. Triangles that would make the
+        /// mesh non-manifold are skipped (see SurfaceMesh::add_triangle()).
+        /// \return The number of triangles that could not be added.
+        std::size_t to_surface_mesh(SurfaceMesh& mesh) const;
+
+        std::size_t n_vertices() const { return points_.size(); }
+        std::size_t n_triangles() const { return indices_.size() / 3; }
+        std::size_t n_corners() const { return indices_.size(); }
+        bool empty() const { return indices_.empty(); }
+
+        const std::vector<vec3>& points() const { return points_; }
+        /// The positions can be changed freely, the adjacency only depends on the indices.
+        std::vector<vec3>& points() { return points_; }
+        const vec3& position(unsigned int v) const { return points_[v]; }
+
+        /// The vertex indices, three per triangle.
+        const std::vector<unsigned int>& indices() const { return indices_; }
+        /// Replaces the triangles (the adjacency is rebuilt when queried next).
+        void set_indices(std::vector<unsigned int> indices);
+
+        /// The vertex at corner \p c.
+        unsigned int vertex(int c) const { return indices_[c]; }
+        /// The triangle of corner \p c.
+        static int triangle(int c) { return c / 3; }
+        /// The next corner in the triangle of \p c.
+        static int next(int c) { return (c % 3 == 2) ? c - 2 : c + 1; }
+        /// The previous corner in the triangle of \p c.
+        static int prev(int c) { return (c % 3 == 0) ? c + 2 : c - 1; }
+
+        /// The corner across the edge opposite to \p c (from vertex(next(c)) to vertex(prev(c))), or -1 if this
+        /// edge is on the border or shared by more than two triangles.
+        int opposite(int c) const;
+
+        /// The corners at vertex \p v are vertex_corners()[vertex_corner_offsets()[v] .. vertex_corner_offsets()[v+1]).
+        const std::vector<int>& vertex_corner_offsets() const;
+        const std::vector<int>& vertex_corners() const;
+
+        /// Builds the adjacency now (it is otherwise built by the first query).
+        void build_adjacency() const;
+        /// Frees the adjacency.
+        void release_adjacency() const;
+
+        /// The number of bytes used by the positions, the indices, and the adjacency (if built).
+        std::size_t memory_usage() const;
+
+    private:
+        bool has_adjacency() const { return corner_offsets_.size() == points_.size() + 1; }
+
+    private:
+        std::vector<vec3> points_;
+        std::vector<unsigned int> indices_;
+
+        // adjacency, built on demand
+        mutable std::vector<int> opposite_;
+        mutable std::vector<int> corner_offsets_;
+        mutable std::vector<int> corners_;
+    };
+
+}   // namespace MV
+
+
+#endif  // EASY3D_CORE_COMPACT_TRI_MESH_H
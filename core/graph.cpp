@@ -54,12 +54,13 @@ namespace MV {
     {
         if (this != &rhs)
         {
-            // deep copy of property containers
+            // copy of property containers (the arrays share their data until written)
             m_vprops = rhs.m_vprops;
             m_eprops = rhs.m_eprops;
             m_mprops = rhs.m_mprops;
 
-            // property handles contain pointers, have to be reassigned
+            // property handles contain pointers, have to be reassigned. this makes the standard properties
+            // exclusive to this model: its members write them without checking (see PropertyArray)
             m_vconn    = vertex_property<VertexConnectivity>("v:connectivity");
             m_econn    = edge_property<EdgeConnectivity>("e:connectivity");
             m_vdeleted = vertex_property<bool>("v:deleted");
@@ -101,6 +102,12 @@ namespace MV {
             m_vpoint.array()    = rhs.m_vpoint.array();
             m_vdeleted.array()  = rhs.m_vdeleted.array();
             m_edeleted.array()  = rhs.m_edeleted.array();
+            // the standard properties are not shared, see operator=()
+            m_vconn.array().detach();
+            m_econn.array().detach();
+            m_vpoint.array().detach();
+            m_vdeleted.array().detach();
+            m_edeleted.array().detach();
 
             // resize (needed by property containers)
             m_vprops.resize(rhs.vertices_size());
@@ -28,6 +28,8 @@
 #define EASY3D_CORE_HEAP_H
 
 #include <vector>
+#include <iostream>
+#include <cassert>
 
 namespace MV {
 
@@ -2,16 +2,62 @@
 // Distributed under a MIT-style license, see LICENSE.txt for details.
 
 #include "normals.h"
+#include "property_keys.h"
+#include "../util/parallel.h"
 
 namespace MV 
 {
 
+namespace {
+
+// Sum of the cross products of the consecutive corners of face f, i.e. twice
+// its vector area. Its direction is the face normal.
+inline Normal vector_area(const SurfaceMesh& mesh,
+                          const SurfaceMesh::VertexProperty<Point>& vpoint,
+                          SurfaceMesh::Face f)
+{
+    SurfaceMesh::Halfedge h = mesh.halfedge(f);
+    const Point& p0 = vpoint[mesh.source(h)];
+    const Point& p1 = vpoint[mesh.target(h)];
+    const SurfaceMesh::Halfedge hn = mesh.next(h);
+    const Point& p2 = vpoint[mesh.target(hn)];
+
+    if (mesh.next(hn) == mesh.prev(h)) // face is a triangle
+        return cross(p1 - p0, p2 - p0);
+
+    Normal n(0, 0, 0);
+    for (auto fh : mesh.halfedges(f))
+        n += cross(vpoint[mesh.source(fh)], vpoint[mesh.target(fh)]);
+    return n;
+}
+
+// Writes the normals of the faces (and their vector areas if requested).
+void compute_face_normals(const SurfaceMesh& mesh,
+                          const SurfaceMesh::VertexProperty<Point>& vpoint,
+                          SurfaceMesh::FaceProperty<Normal>& fnormal,
+                          std::vector<Normal>* areas,
+                          unsigned int num_threads)
+{
+    const SurfaceMesh::ReadScope scope(mesh);
+    parallel_for(0, mesh.faces_size(), [&](std::size_t i) {
+        const SurfaceMesh::Face f(static_cast<int>(i));
+        if (mesh.is_deleted(f))
+            return;
+        const Normal a = vector_area(mesh, vpoint, f);
+        fnormal[f] = normalize(a);
+        if (areas)
+            (*areas)[i] = a;
+    }, num_threads);
+}
+
+} // namespace
+
 Normal face_normal(const SurfaceMesh& mesh, SurfaceMesh::Face f)
 {
     SurfaceMesh::Halfedge h = mesh.halfedge(f);
     SurfaceMesh::Halfedge hend = h;
 
-    auto vpoint = mesh.get_vertex_property<Point>("v:point");
+    auto vpoint = mesh.get_vertex_property(keys::v_point);
     Point p0 = vpoint[mesh.target(h)];
     h = mesh.next(h);
     Point p1 = vpoint[mesh.target(h)];
@@ -34,7 +80,7 @@ Normal face_normal(const SurfaceMesh& mesh, SurfaceMesh::Face f)
         // This vector then has to be normalized.
         for (auto fh : mesh.halfedges(f))
         {
-            n += cross(vpoint[mesh.source(fh)], vpoint[mesh.source(fh)]);
+            n += cross(vpoint[mesh.source(fh)], vpoint[mesh.target(fh)]);
         }
 
         return normalize(n);
@@ -47,7 +93,7 @@ Normal vertex_normal(const SurfaceMesh& mesh, SurfaceMesh::Vertex v)
 
     if (!mesh.is_isolated(v))
     {
-        auto vpoint = mesh.get_vertex_property<Point>("v:point");
+        auto vpoint = mesh.get_vertex_property(keys::v_point);
         const Point p0 = vpoint[v];
 
         Normal n;
@@ -109,7 +155,7 @@ Normal corner_normal(const SurfaceMesh& mesh, SurfaceMesh::Halfedge h, float cre
 
     if (!mesh.is_border(h))
     {
-        auto vpoint = mesh.get_vertex_property<Point>("v:point");
+        auto vpoint = mesh.get_vertex_property(keys::v_point);
 
         const SurfaceMesh::Halfedge hend = h;
         const SurfaceMesh::Vertex v0 = mesh.target(h);
@@ -165,18 +211,141 @@ Normal corner_normal(const SurfaceMesh& mesh, SurfaceMesh::Halfedge h, float cre
     return nn;
 }
 
-void vertex_normals(SurfaceMesh& mesh)
+void vertex_normals(SurfaceMesh& mesh, NormalWeighting weighting, unsigned int num_threads)
 {
+    const auto vpoint = mesh.get_vertex_property(keys::v_point);
+    auto fnormal = mesh.face_property<Normal>("f:normal");
     auto vnormal = mesh.vertex_property<Normal>("v:normal");
-    for (auto v : mesh.vertices())
-        vnormal[v] = vertex_normal(mesh, v);
+
+    // the vector area of a face is twice its area times its normal
+    std::vector<Normal> areas;
+    if (weighting == NormalWeighting::Area)
+        areas.resize(mesh.faces_size());
+    compute_face_normals(mesh, vpoint, fnormal,
+                         weighting == NormalWeighting::Area ? &areas : nullptr,
+                         num_threads);
+
+    const SurfaceMesh::ReadScope scope(mesh);
+    parallel_for(0, mesh.vertices_size(), [&](std::size_t i) {
+        const SurfaceMesh::Vertex v(static_cast<int>(i));
+        if (mesh.is_deleted(v))
+            return;
+
+        Normal nn(0, 0, 0);
+        if (!mesh.is_isolated(v))
+        {
+            const Point& p0 = vpoint[v];
+            for (auto h : mesh.halfedges(v))
+            {
+                if (mesh.is_border(h))
+                    continue;
+                const SurfaceMesh::Face f = mesh.face(h);
+                if (weighting == NormalWeighting::Uniform)
+                {
+                    nn += fnormal[f];
+                }
+                else if (weighting == NormalWeighting::Area)
+                {
+                    nn += areas[f.idx()];
+                }
+                else
+                {
+                    const Point p1 = vpoint[mesh.target(h)] - p0;
+                    const Point p2 = vpoint[mesh.source(mesh.prev(h))] - p0;
+
+                    // check whether we can robustly compute angle
+                    const float denom = sqrt(dot(p1, p1) * dot(p2, p2));
+                    if (denom > std::numeric_limits<float>::min())
+                    {
+                        float cosine = dot(p1, p2) / denom;
+                        if (cosine < -1.0f)
+                            cosine = -1.0f;
+                        else if (cosine > 1.0f)
+                            cosine = 1.0f;
+                        nn += fnormal[f] * acos(cosine);
+                    }
+                }
+            }
+            nn = normalize(nn);
+        }
+        vnormal[v] = nn;
+    }, num_threads);
+}
+
+void face_normals(const CompactTriMesh& mesh, std::vector<Normal>& normals,
+                  unsigned int num_threads)
+{
+    const std::vector<Point>& points = mesh.points();
+    const std::vector<unsigned int>& indices = mesh.indices();
+    normals.resize(mesh.n_triangles());
+    parallel_for(0, normals.size(), [&](std::size_t t) {
+        const Point& p0 = points[indices[3 * t]];
+        const Point& p1 = points[indices[3 * t + 1]];
+        const Point& p2 = points[indices[3 * t + 2]];
+        normals[t] = normalize(cross(p1 - p0, p2 - p0));
+    }, num_threads);
+}
+
+void vertex_normals(const CompactTriMesh& mesh, std::vector<Normal>& normals,
+                    NormalWeighting weighting, unsigned int num_threads)
+{
+    const std::vector<Point>& points = mesh.points();
+    const std::vector<unsigned int>& indices = mesh.indices();
+    const std::vector<int>& offsets = mesh.vertex_corner_offsets();
+    const std::vector<int>& corners = mesh.vertex_corners();
+
+    // the vector areas of the triangles (twice their area times their normal)
+    std::vector<Normal> areas(mesh.n_triangles());
+    parallel_for(0, areas.size(), [&](std::size_t t) {
+        const Point& p0 = points[indices[3 * t]];
+        areas[t] = cross(points[indices[3 * t + 1]] - p0, points[indices[3 * t + 2]] - p0);
+    }, num_threads);
+
+    normals.resize(mesh.n_vertices());
+    parallel_for(0, normals.size(), [&](std::size_t v) {
+        Normal nn(0, 0, 0);
+        for (int k = offsets[v]; k < offsets[v + 1]; ++k)
+        {
+            const int c = corners[k];
+            const Normal& a = areas[CompactTriMesh::triangle(c)];
+            if (weighting == NormalWeighting::Area)
+            {
+                nn += a;
+                continue;
+            }
+            const float len = norm(a);
+            if (len <= std::numeric_limits<float>::min())
+                continue;
+            if (weighting == NormalWeighting::Uniform)
+            {
+                nn += a / len;
+                continue;
+            }
+
+            const Point p1 = points[indices[CompactTriMesh::next(c)]] - points[v];
+            const Point p2 = points[indices[CompactTriMesh::prev(c)]] - points[v];
+
+            // check whether we can robustly compute angle
+            const float denom = sqrt(dot(p1, p1) * dot(p2, p2));
+            if (denom > std::numeric_limits<float>::min())
+            {
+                float cosine = dot(p1, p2) / denom;
+                if (cosine < -1.0f)
+                    cosine = -1.0f;
+                else if (cosine > 1.0f)
+                    cosine = 1.0f;
+                nn += a * (acos(cosine) / len);
+            }
+        }
+        normals[v] = normalize(nn);
+    }, num_threads);
 }
 
-void face_normals(SurfaceMesh& mesh)
+void face_normals(SurfaceMesh& mesh, unsigned int num_threads)
 {
+    const auto vpoint = mesh.get_vertex_property(keys::v_point);
     auto fnormal = mesh.face_property<Normal>("f:normal");
-    for (auto f : mesh.faces())
-        fnormal[f] = face_normal(mesh, f);
+    compute_face_normals(mesh, vpoint, fnormal, nullptr, num_threads);
 }
 
 
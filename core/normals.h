@@ -4,23 +4,54 @@
 #pragma once
 
 #include "surface_mesh.h"
+#include "compact_tri_mesh.h"
 
 namespace MV
 {
 
+//! \brief How the normals of the incident faces are weighted in a vertex normal.
+enum class NormalWeighting
+{
+    Uniform, //!< all faces count the same
+    Area,    //!< by face area
+    Angle    //!< by the angle of the face at the vertex (as vertex_normal())
+};
+
 //! \brief Compute vertex normals for the whole \p mesh.
-//! \details Calls vertex_normal() for each vertex and adds a new
-//! vertex property of type Normal named "v:normal".
+//! \details Computes the face normals (stored in "f:normal") and then
+//! averages them around each vertex into a vertex property of type Normal
+//! named "v:normal". The point property is resolved once and both passes run
+//! in parallel, so this is much faster than calling vertex_normal() for each
+//! vertex. With NormalWeighting::Angle the result is the one of vertex_normal().
+//! \param num_threads The number of threads (0 means default_thread_count()).
 //! \note This algorithm works on general polygon meshes.
 //! \ingroup algorithms
-void vertex_normals(SurfaceMesh& mesh);
+void vertex_normals(SurfaceMesh& mesh,
+                    NormalWeighting weighting = NormalWeighting::Angle,
+                    unsigned int num_threads = 0);
 
 //! \brief Compute face normals for the whole \p mesh.
-//! \details Calls face_normal() for each face and adds a new face
-//! property of type Normal named "f:normal".
+//! \details Computes the normal of face_normal() for each face (in parallel)
+//! into a face property of type Normal named "f:normal".
+//! \param num_threads The number of threads (0 means default_thread_count()).
 //! \note This algorithm works on general polygon meshes.
 //! \ingroup algorithms
-void face_normals(SurfaceMesh& mesh);
+void face_normals(SurfaceMesh& mesh, unsigned int num_threads = 0);
+
+//! \brief Compute the normals of the triangles of a CompactTriMesh (in parallel).
+//! \param num_threads The number of threads (0 means default_thread_count()).
+//! \ingroup algorithms
+void face_normals(const CompactTriMesh& mesh, std::vector<Normal>& normals,
+                  unsigned int num_threads = 0);
+
+//! \brief Compute the vertex normals of a CompactTriMesh (in parallel).
+//! \details The same as vertex_normals() for a SurfaceMesh, but the incident
+//! triangles of each vertex are found with CompactTriMesh::vertex_corners().
+//! \param num_threads The number of threads (0 means default_thread_count()).
+//! \ingroup algorithms
+void vertex_normals(const CompactTriMesh& mesh, std::vector<Normal>& normals,
+                    NormalWeighting weighting = NormalWeighting::Angle,
+                    unsigned int num_threads = 0);
 
 //! \brief Compute the normal vector of vertex \p v.
 //! \note This algorithm works on general polygon meshes.
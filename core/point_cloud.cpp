@@ -49,11 +49,12 @@ namespace MV {
     {
         if (this != &rhs)
         {
-            // deep copy of property containers
+            // copy of property containers (the arrays share their data until written)
             m_vprops = rhs.m_vprops;
             m_mprops = rhs.m_mprops;
 
-            // property handles contain pointers, have to be reassigned
+            // property handles contain pointers, have to be reassigned. this makes the standard properties
+            // exclusive to this model: its members write them without checking (see PropertyArray)
             m_vdeleted = vertex_property<bool>("v:deleted");
             m_vpoint   = vertex_property<vec3>("v:point");
 
@@ -101,6 +102,9 @@ namespace MV {
             // copy properties from other cloud
             m_vpoint.array() = rhs.m_vpoint.array();
             m_vdeleted.array() = rhs.m_vdeleted.array();
+            // the standard properties are not shared, see operator=()
+            m_vpoint.array().detach();
+            m_vdeleted.array().detach();
 
             // resize (needed by property containers)
             m_vprops.resize(rhs.vertices_size());
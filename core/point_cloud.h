@@ -230,10 +230,12 @@ namespace MV {
         /// @brief destructor (is virtual, since we inherit from Geometry_representation)
         ~PointCloud() override = default;
 
-        /// @brief copy constructor: copies \c rhs to \c *this. performs a deep copy of all properties.
+        /// @brief copy constructor: copies \c rhs to \c *this. the properties share their data until written (copy-on-write, see PropertyArray), so this is cheap.
         PointCloud(const PointCloud& rhs) { operator=(rhs); }
 
-        /// @brief assign \c rhs to \c *this. performs a deep copy of all properties.
+        /// @brief assign \c rhs to \c *this. the properties share their data until written (copy-on-write, see PropertyArray).
+        /// The standard properties (the positions and the deletion flags) are copied right away, and handles of the
+        /// properties of either model obtained before must be obtained again for writing.
         PointCloud& operator=(const PointCloud& rhs);
 
 		/// \brief Merges another point cloud into the current one.
@@ -356,6 +358,32 @@ namespace MV {
             return ModelProperty<T>(m_mprops.get<T>(name));
         }
 
+        /** get a vertex property by its interned name (see PropertyKey), comparing integers instead of strings.
+         Use it in code that looks properties up often. */
+        template <class T> VertexProperty<T> get_vertex_property(const PropertyKey<T>& key) const
+        {
+            return VertexProperty<T>(m_vprops.get(key));
+        }
+
+        /** The get_*_property() of a const point cloud return handles for reading: after it was copied, the data
+         may still be shared with the copy (see PropertyArray). Those of a non-const point cloud, like
+         vertex_property() etc., make the data of the property exclusive to it, so the handles can be used
+         for writing. */
+        template <class T> VertexProperty<T> get_vertex_property(const std::string& name)
+        {
+            return VertexProperty<T>(m_vprops.get<T>(name));
+        }
+        /** get the model property named \c name of type \c T for writing. */
+        template <class T> ModelProperty<T> get_model_property(const std::string& name)
+        {
+            return ModelProperty<T>(m_mprops.get<T>(name));
+        }
+        /** get a vertex property by its interned name for writing. */
+        template <class T> VertexProperty<T> get_vertex_property(const PropertyKey<T>& key)
+        {
+            return VertexProperty<T>(m_vprops.get(key));
+        }
+
         /** @brief if a vertex property of type \c T with name \c name exists, it is returned.
          otherwise this property is added (with default value \c t) */
         template <class T> VertexProperty<T> vertex_property(const std::string& name, const T t=T())
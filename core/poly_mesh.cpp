@@ -151,7 +151,7 @@ namespace MV {
     {
         if (this != &rhs)
         {
-            // deep copy of property containers
+            // copy of property containers (the arrays share their data until written)
             m_vprops = rhs.m_vprops;
             m_eprops = rhs.m_eprops;
             hprops_ = rhs.hprops_;
@@ -159,7 +159,8 @@ namespace MV {
             cprops_ = rhs.cprops_;
             m_mprops = rhs.m_mprops;
 
-            // property handles contain pointers, have to be reassigned
+            // property handles contain pointers, have to be reassigned. this makes the standard properties
+            // exclusive to this model: its members write them without checking (see PropertyArray)
             m_vconn    = vertex_property<VertexConnectivity>("v:connectivity");
             m_econn    = edge_property<EdgeConnectivity>("e:connectivity");
             m_hconn    = halfface_property<HalfFaceConnectivity>("h:connectivity");
@@ -200,6 +201,11 @@ namespace MV {
             cconn_.array()     = rhs.cconn_.array();
             m_hconn.array()     = rhs.m_hconn.array();
             m_vpoint.array()    = rhs.m_vpoint.array();
+            // the standard properties are not shared, see operator=()
+            m_vconn.array().detach();
+            cconn_.array().detach();
+            m_hconn.array().detach();
+            m_vpoint.array().detach();
 
             // resize (needed by property containers)
             m_vprops.resize(rhs.n_vertices());
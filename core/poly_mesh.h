@@ -674,10 +674,12 @@ namespace MV {
         // destructor
         ~PolyMesh() override = default;
 
-        /// copy constructor: copies \c rhs to \c *this. performs a deep copy of all properties.
+        /// copy constructor: copies \c rhs to \c *this. the properties share their data until written (copy-on-write, see PropertyArray), so this is cheap.
         PolyMesh(const PolyMesh& rhs) { operator=(rhs); }
 
-        /// assign \c rhs to \c *this. performs a deep copy of all properties.
+        /// assign \c rhs to \c *this. the properties share their data until written (copy-on-write, see PropertyArray).
+        /// The standard properties (the positions and the connectivity) are copied right away, and handles of the
+        /// properties of either model obtained before must be obtained again for writing.
         PolyMesh& operator=(const PolyMesh& rhs);
 
         /// assign \c rhs to \c *this. does not copy custom properties.
@@ -919,6 +921,72 @@ namespace MV {
             return ModelProperty<T>(m_mprops.get<T>(name));
         }
 
+        /** get a vertex property by its interned name (see PropertyKey), comparing integers instead of strings.
+         Use it in code that looks properties up often. */
+        template <class T> VertexProperty<T> get_vertex_property(const PropertyKey<T>& key) const
+        {
+            return VertexProperty<T>(m_vprops.get(key));
+        }
+        /** get an edge property by its interned name (see PropertyKey). */
+        template <class T> EdgeProperty<T> get_edge_property(const PropertyKey<T>& key) const
+        {
+            return EdgeProperty<T>(m_eprops.get(key));
+        }
+        /** get a face property by its interned name (see PropertyKey). */
+        template <class T> FaceProperty<T> get_face_property(const PropertyKey<T>& key) const
+        {
+            return FaceProperty<T>(fprops_.get(key));
+        }
+
+        /** The get_*_property() of a const mesh return handles for reading: after it was copied, the data
+         may still be shared with the copy (see PropertyArray). Those of a non-const mesh, like
+         vertex_property() etc., make the data of the property exclusive to it, so the handles can be used
+         for writing. */
+        template <class T> VertexProperty<T> get_vertex_property(const std::string& name)
+        {
+            return VertexProperty<T>(m_vprops.get<T>(name));
+        }
+        /** get the edge property named \c name of type \c T for writing. */
+        template <class T> EdgeProperty<T> get_edge_property(const std::string& name)
+        {
+            return EdgeProperty<T>(m_eprops.get<T>(name));
+        }
+        /** get the halfface property named \c name of type \c T for writing. */
+        template <class T> HalfFaceProperty<T> get_halfface_property(const std::string& name)
+        {
+            return HalfFaceProperty<T>(hprops_.get<T>(name));
+        }
+        /** get the face property named \c name of type \c T for writing. */
+        template <class T> FaceProperty<T> get_face_property(const std::string& name)
+        {
+            return FaceProperty<T>(fprops_.get<T>(name));
+        }
+        /** get the cell property named \c name of type \c T for writing. */
+        template <class T> CellProperty<T> get_cell_property(const std::string& name)
+        {
+            return CellProperty<T>(cprops_.get<T>(name));
+        }
+        /** get the model property named \c name of type \c T for writing. */
+        template <class T> ModelProperty<T> get_model_property(const std::string& name)
+        {
+            return ModelProperty<T>(m_mprops.get<T>(name));
+        }
+        /** get a vertex property by its interned name for writing. */
+        template <class T> VertexProperty<T> get_vertex_property(const PropertyKey<T>& key)
+        {
+            return VertexProperty<T>(m_vprops.get(key));
+        }
+        /** get an edge property by its interned name for writing. */
+        template <class T> EdgeProperty<T> get_edge_property(const PropertyKey<T>& key)
+        {
+            return EdgeProperty<T>(m_eprops.get(key));
+        }
+        /** get a face property by its interned name for writing. */
+        template <class T> FaceProperty<T> get_face_property(const PropertyKey<T>& key)
+        {
+            return FaceProperty<T>(fprops_.get(key));
+        }
+
 
         /** if a vertex property of type \c T with name \c name exists, it is returned.
          otherwise this property is added (with default value \c t) */
@@ -31,10 +31,50 @@
 #include <algorithm>
 #include <typeinfo>
 #include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
 
 
 namespace MV {
 
+    /// Returns the process-wide id of a property name: equal names always get the same id. It is thread-safe, but
+    /// it locks and hashes the name, so call it once and keep the id (see PropertyKey).
+    inline unsigned int intern_property_name(const std::string& name)
+    {
+        static std::mutex mutex;
+        static std::unordered_map<std::string, unsigned int> ids;
+        std::lock_guard<std::mutex> lock(mutex);
+        return ids.emplace(name, static_cast<unsigned int>(ids.size())).first->second;
+    }
+
+
+    /// \brief The name of a property of type \p T, interned once.
+    /// \class PropertyKey MV/core/properties.h
+    /// \details Getting a property by its name compares the name with those of all properties. Getting it by a key
+    ///     compares integers only. Keep keys in static storage and use them in code that looks properties up
+    ///     often (per element or per frame). The keys of the standard properties are in property_keys.h.
+    ///     \code
+    ///         static const PropertyKey<float> key("v:curvature");
+    ///         auto curvature = mesh->get_vertex_property(key);
+    ///     \endcode
+    template <class T>
+    class PropertyKey
+    {
+    public:
+        explicit PropertyKey(const std::string& name) : name_(name), id_(intern_property_name(name)) {}
+
+        const std::string& name() const { return name_; }
+        unsigned int id() const { return id_; }
+
+    private:
+        std::string name_;
+        unsigned int id_;
+    };
+
+
     /// \brief Base class for a property array.
     /// \class BasePropertyArray MV/core/properties.h
     class BasePropertyArray
@@ -42,7 +82,7 @@ namespace MV {
     public:
 
         /// Default constructor
-        explicit BasePropertyArray(const std::string& name) : name_(name) {}
+        explicit BasePropertyArray(const std::string& name) : name_(name), id_(intern_property_name(name)), version_(0) {}
 
         /// Destructor.
         virtual ~BasePropertyArray() = default;
@@ -73,7 +113,11 @@ namespace MV {
         /// Let copy 'from' -> 'to'.
         virtual void copy(size_t from, size_t to) = 0;
 
-        /// Return a deep copy of self.
+        /// Rearranges the elements: element i becomes the former element new_to_old[i]. The array takes the size
+        /// of \p new_to_old, so elements that are not listed are dropped.
+        virtual void permute(const std::vector<int>& new_to_old) = 0;
+
+        /// Return a copy of self (sharing the data until either of them is written, see PropertyArray).
         virtual BasePropertyArray* clone () const = 0;
 
         /// Return a empty copy of self.
@@ -86,7 +130,17 @@ namespace MV {
         const std::string& name() const { return name_; }
 
         /// Set the name of the property
-        void set_name(const std::string& n) { name_ = n; }
+        void set_name(const std::string& n) { name_ = n; id_ = intern_property_name(n); ++renames(); }
+
+        /// The interned id of the name (see intern_property_name()).
+        unsigned int id() const { return id_; }
+
+        /// Counts the renames of all property arrays (a container whose index of ids is older has to check it).
+        static std::atomic<std::uint64_t>& renames()
+        {
+            static std::atomic<std::uint64_t> count(0);
+            return count;
+        }
 
         /// Test if two properties are the same.
         /// \return true only if their names and types are both identical.
@@ -95,9 +149,44 @@ namespace MV {
             return (name() == other.name() && type() == other.type());
         }
 
+        /// A counter that changes whenever the array is modified through this interface (resizing, swapping,
+        /// copying, ...) or touch(). Writing an element through operator[] or vector() does not change it: code
+        /// writing the values this way calls touch() to let the clients of the property know.
+        std::uint64_t version() const { return version_; }
+
+        /// Marks the values as modified.
+        void touch() { ++version_; }
+
     protected:
 
         std::string name_;
+        unsigned int id_;
+        std::uint64_t version_;
+    };
+
+
+
+    /// \brief How the values of a PropertyArray<T> are stored: as T, except for bool.
+    /// \details A std::vector<bool> packs the values into bits, so writing two different elements is not thread-safe
+    ///     and its elements cannot be referenced. Bool properties (e.g., "v:deleted", "f:select") are stored one
+    ///     byte per element instead, so they behave like any other property.
+    template <class T>
+    struct PropertyStorage
+    {
+        typedef T stored_type;
+        static T& value(stored_type& s) { return s; }
+        static const T& value(const stored_type& s) { return s; }
+    };
+
+    template <>
+    struct PropertyStorage<bool>
+    {
+        struct stored_type {
+            stored_type(bool v = false) : value(v) {}
+            bool value;
+        };
+        static bool& value(stored_type& s) { return s.value; }
+        static const bool& value(const stored_type& s) { return s.value; }
     };
 
 
@@ -106,46 +195,85 @@ namespace MV {
 
     /// \brief Implementation of a generic property array.
     /// \class PropertyArray MV/core/properties.h
+    /// \details Copies of an array (clone(), copy construction and assignment) share the data until one of them
+    ///     writes it (copy-on-write). So copying a mesh costs O(number of properties), and only the arrays that are
+    ///     written afterwards are actually duplicated. The data is made exclusive to an array when it is obtained
+    ///     for writing: by detach(), the non-const vector(), the modifiers (resize, swap, ...), and the handles
+    ///     returned by a non-const PropertyContainer (e.g., SurfaceMesh::get_vertex_property() of a non-const mesh).
+    ///     The element access (operator[]) does not check, so writing the elements costs the same as writing a
+    ///     std::vector. Three rules follow:
+    ///      - A handle, reference, or pointer obtained before a copy was made must not be used to write after it,
+    ///        because it still points into the shared data. Obtain it again.
+    ///      - A handle obtained from a const container (or a const mesh) is for reading only.
+    ///      - detach() replaces the data if it is shared, so it must not run concurrently with other accesses to
+    ///        the same array (concurrent calls of detach() are fine).
     template <class T>
     class PropertyArray : public BasePropertyArray
     {
     public:
 
         typedef T                                       value_type;
-        typedef std::vector<value_type>                 vector_type;
-        typedef typename vector_type::reference         reference;
-        typedef typename vector_type::const_reference   const_reference;
-
-        explicit PropertyArray(const std::string& name, T t=T()) : BasePropertyArray(name), value_(t) {}
+        /// The type of the stored elements: T, or a byte-sized wrapper if T is bool (see PropertyStorage).
+        typedef typename PropertyStorage<T>::stored_type  stored_type;
+        typedef std::vector<stored_type>                vector_type;
+        typedef T&                                      reference;
+        typedef const T&                                const_reference;
+
+        explicit PropertyArray(const std::string& name, T t=T())
+                : BasePropertyArray(name), data_(std::make_shared<vector_type>()), value_(t), shared_(false) {}
+
+        /// Shares the data of \p other.
+        PropertyArray(const PropertyArray& other)
+                : BasePropertyArray(other), data_(other.share()), value_(other.value_), shared_(true) {}
+
+        /// Shares the data of \p other.
+        PropertyArray& operator=(const PropertyArray& other)
+        {
+            if (this != &other) {
+                BasePropertyArray::operator=(other);
+                data_ = other.share();
+                value_ = other.value_;
+                shared_ = true;
+            }
+            return *this;
+        }
 
 
     public: // virtual interface of BasePropertyArray
 
         void reserve(size_t n) override
         {
-            data_.reserve(n);
+            if (n > data_->capacity())
+                write().reserve(n);
         }
 
         void resize(size_t n) override
         {
-            data_.resize(n, value_);
+            if (n != data_->size())
+                write().resize(n, value_);
+            ++version_;
         }
 
         void push_back() override
         {
-            data_.push_back(value_);
+            write().push_back(value_);
+            ++version_;
         }
 
         void reset(size_t idx) override
         {
-            data_[idx] = value_;
+            write()[idx] = value_;
+            ++version_;
         }
 
         bool transfer(const BasePropertyArray& other) override
         {
             const auto pa = dynamic_cast<const PropertyArray*>(&other);
             if(pa != nullptr){
-                std::copy((*pa).data_.begin(), (*pa).data_.end(), data_.end()-(*pa).data_.size());
+                const vector_type& src = *pa->data_;
+                vector_type& dst = write();
+                std::copy(src.begin(), src.end(), dst.end()-src.size());
+                ++version_;
                 return true;
             }
             return false;
@@ -156,7 +284,8 @@ namespace MV {
             const auto pa = dynamic_cast<const PropertyArray*>(&other);
             if (pa != nullptr)
             {
-                data_[to] = (*pa)[from];
+                write()[to] = (*pa)[from];
+                ++version_;
                 return true;
             }
 
@@ -165,26 +294,40 @@ namespace MV {
 
         void shrink_to_fit() override
         {
-            vector_type(data_).swap(data_);
+            if (data_->capacity() > data_->size())
+                replace(vector_type(*data_));
         }
 
         void swap(size_t i0, size_t i1) override
         {
-            T d(data_[i0]);
-            data_[i0]=data_[i1];
-            data_[i1]=d;
+            vector_type& data = write();
+            stored_type d(data[i0]);
+            data[i0]=data[i1];
+            data[i1]=d;
+            ++version_;
         }
 
         void copy(size_t from, size_t to) override
         {
-            data_[to]=data_[from];
+            vector_type& data = write();
+            data[to]=data[from];
+            ++version_;
+        }
+
+        void permute(const std::vector<int>& new_to_old) override
+        {
+            const vector_type& old = *data_;
+            vector_type data;
+            data.reserve(new_to_old.size());
+            for (auto i : new_to_old)
+                data.push_back(old[i]);
+            replace(std::move(data));
+            ++version_;
         }
 
         BasePropertyArray* clone() const override
         {
-            auto p = new PropertyArray<T>(name_, value_);
-            p->data_ = data_;
-            return p;
+            return new PropertyArray<T>(*this);
         }
 
         BasePropertyArray* empty_clone() const override
@@ -198,49 +341,105 @@ namespace MV {
 
     public:
 
-        /// Get pointer to array (does not work for T==bool)
+        /// Get pointer to array
         const T* data() const
         {
-            return &data_[0];
+            return data_->empty() ? nullptr : &PropertyStorage<T>::value(data_->front());
         }
 
 
-        /// Get reference to the underlying vector
-        std::vector<T>& vector()
+        /// Get reference to the underlying vector (for writing: makes the data exclusive to this array, see detach()).
+        /// It is a std::vector<T> unless T is bool (see PropertyStorage).
+        vector_type& vector()
         {
-            return data_;
+            return write();
         }
 
+        /// Get const reference to the underlying vector
+        const vector_type& vector() const
+        {
+            return *data_;
+        }
 
-        /// Access the i'th element. No range check is performed!
+
+        /// Access the i'th element. No range check is performed! It does not make the data exclusive to this
+        /// array, see detach().
         reference operator[](size_t _idx)
         {
-            assert( size_t(_idx) < data_.size() );
-            return data_[_idx];
+            assert( size_t(_idx) < data_->size() );
+            return PropertyStorage<T>::value((*data_)[_idx]);
         }
 
         /// Const access to the i'th element. No range check is performed!
         const_reference operator[](size_t _idx) const
         {
-            assert( size_t(_idx) < data_.size());
-            return data_[_idx];
+            assert( size_t(_idx) < data_->size());
+            return PropertyStorage<T>::value((*data_)[_idx]);
+        }
+
+        /// Returns \c true if the data is (possibly) shared with a copy of this array.
+        bool is_shared() const { return shared_.load(std::memory_order_acquire) && data_.use_count() > 1; }
+
+        /// Makes the data exclusive to this array, copying it if it is shared with a copy of the array (see the
+        /// class description).
+        void detach()
+        {
+            if (shared_.load(std::memory_order_acquire))
+                unshare();
         }
 
 
     private:
-        vector_type data_;
-        value_type  value_;
-    };
+        // Hands the data out to a copy of this array.
+        std::shared_ptr<vector_type> share() const
+        {
+            shared_.store(true, std::memory_order_release);
+            return data_;
+        }
+
+        // The data for writing. If it may be shared, it is copied first (unless the copies are gone).
+        vector_type& write()
+        {
+            detach();
+            return *data_;
+        }
 
+        // Kept apart from detach(), which is inlined into the callers.
+        void unshare()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (shared_.load(std::memory_order_relaxed)) {
+                if (data_.use_count() > 1) {
+                    auto data = std::make_shared<vector_type>();
+                    data->reserve(data_->capacity());
+                    data->assign(data_->begin(), data_->end());
+                    data_ = data;
+                }
+                shared_.store(false, std::memory_order_release);
+            }
+        }
 
-    // specialization for bool properties
-    template <>
-    inline const bool*
-    PropertyArray<bool>::data() const
-    {
-        assert(false);
-        return nullptr;
-    }
+        // Replaces the data with \p data (without copying the current data if it is shared).
+        void replace(vector_type&& data)
+        {
+            if (shared_.load(std::memory_order_acquire)) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                data_ = std::make_shared<vector_type>(std::move(data));
+                shared_.store(false, std::memory_order_release);
+            }
+            else
+                data_->swap(data);
+        }
+
+    private:
+        std::shared_ptr<vector_type> data_;
+        value_type  value_;
+
+        // true if data_ has been handed out to a copy (the copy may be gone already)
+        mutable std::atomic<bool> shared_;
+        // serializes the first writes after a copy
+        std::mutex mutex_;
+    };
 
 
 
@@ -281,7 +480,7 @@ namespace MV {
         virtual const_reference operator[](size_t i) const
         {
             assert(parray_ != nullptr);
-            return (*parray_)[i];
+            return static_cast<const PropertyArray<T>&>(*parray_)[i];
         }
 
         const T* data() const
@@ -290,16 +489,16 @@ namespace MV {
             return parray_->data();
         }
 
-        std::vector<T>& vector()
+        typename PropertyArray<T>::vector_type& vector()
         {
             assert(parray_ != nullptr);
             return parray_->vector();
         }
 
-        const std::vector<T>& vector() const
+        const typename PropertyArray<T>::vector_type& vector() const
         {
             assert(parray_ != nullptr);
-            return parray_->vector();
+            return static_cast<const PropertyArray<T>*>(parray_)->vector();
         }
 
         PropertyArray<T>& array()
@@ -326,6 +525,18 @@ namespace MV {
             parray_->set_name(n);
         }
 
+        /// The modification counter of the property array (see BasePropertyArray::version()).
+        std::uint64_t version() const {
+            assert(parray_ != nullptr);
+            return parray_->version();
+        }
+
+        /// Marks the values as modified (see BasePropertyArray::touch()).
+        void touch() {
+            assert(parray_ != nullptr);
+            parray_->touch();
+        }
+
     private:
         PropertyArray<T>* parray_;
     };
@@ -337,20 +548,28 @@ namespace MV {
 
     /// \brief Implementation of generic property container.
     /// \class PropertyContainer MV/core/properties.h
+    /// \details All arrays of a container grow together: the container keeps a capacity that every array has
+    ///     reserved. When push_back() reaches it, all arrays are reallocated in one pass (doubling the capacity), and
+    ///     a property added later reserves the same capacity right away. So reserve() before inserting elements
+    ///     makes each insertion an append without allocation, also for the properties added afterwards.
+    ///
+    ///     The container indexes its arrays by the interned ids of their names, so getting a property by a
+    ///     PropertyKey takes constant time. The index is updated whenever arrays are added, removed, or renamed
+    ///     through the container.
     class PropertyContainer
     {
     public:
 
         // default constructor
-        PropertyContainer() : size_(0) {}
+        PropertyContainer() : size_(0), capacity_(0), renames_(0) {}
 
         // destructor (deletes all property arrays)
         virtual ~PropertyContainer() { clear(); }
 
-        // copy constructor: performs deep copy of property arrays
-        PropertyContainer(const PropertyContainer& _rhs) { operator=(_rhs); }
+        // copy constructor: copies the property arrays (they share the data until written, see PropertyArray)
+        PropertyContainer(const PropertyContainer& _rhs) : size_(0), capacity_(0), renames_(0) { operator=(_rhs); }
 
-        // assignment: performs deep copy of property arrays
+        // assignment: copies the property arrays (they share the data until written, see PropertyArray)
         PropertyContainer& operator=(const PropertyContainer& _rhs)
         {
             if (this != &_rhs)
@@ -360,6 +579,8 @@ namespace MV {
                 size_ = _rhs.size();
                 for (size_t i=0; i<parrays_.size(); ++i)
                     parrays_[i] = _rhs.parrays_[i]->clone();
+                capacity_ = size_;  // the clones are not larger than needed
+                update_index();
             }
             return *this;
         }
@@ -393,8 +614,10 @@ namespace MV {
                     continue;
 
                 parrays_.push_back(rpa->empty_clone());
+                parrays_.back()->reserve(capacity_);
                 parrays_.back()->resize(size_);
             }
+            update_index();
         }
 
         // Transfer one element with all properties
@@ -411,6 +634,9 @@ namespace MV {
         // returns the current size of the property arrays
         size_t size() const { return size_; }
 
+        // returns the number of elements all property arrays can hold without reallocation
+        size_t capacity() const { return capacity_; }
+
         // returns the number of property arrays
         size_t n_properties() const { return parrays_.size(); }
 
@@ -440,13 +666,16 @@ namespace MV {
 
             // otherwise add the property
             auto p = new PropertyArray<T>(name, t);
+            p->reserve(capacity_);
             p->resize(size_);
             parrays_.push_back(p);
+            update_index();
             return Property<T>(p);
         }
 
 
         // get a property by its name. returns invalid property if it does not exist.
+        // the property is for reading only, its data may be shared with a copy of the container (see PropertyArray)
         template <class T> Property<T> get(const std::string& name) const
         {
             for(auto pa : parrays_)
@@ -455,8 +684,35 @@ namespace MV {
             return Property<T>();
         }
 
+        // get a property by its name for writing: its data is made exclusive to this container (see PropertyArray)
+        template <class T> Property<T> get(const std::string& name)
+        {
+            Property<T> p = static_cast<const PropertyContainer&>(*this).get<T>(name);
+            if (p) p.array().detach();
+            return p;
+        }
+
+
+        // get a property by its interned name. returns invalid property if it does not exist or has another type.
+        // the property is for reading only, its data may be shared with a copy of the container (see PropertyArray)
+        template <class T> Property<T> get(const PropertyKey<T>& key) const
+        {
+            BasePropertyArray* pa = find(key.id());
+            if (pa && pa->type() == typeid(T))
+                return Property<T>(static_cast<PropertyArray<T>*>(pa));
+            return Property<T>();
+        }
+
+        // get a property by its interned name for writing: its data is made exclusive to this container
+        template <class T> Property<T> get(const PropertyKey<T>& key)
+        {
+            Property<T> p = static_cast<const PropertyContainer&>(*this).get(key);
+            if (p) p.array().detach();
+            return p;
+        }
 
-        // returns a property if it exists, otherwise it creates it first.
+
+        // returns a property if it exists (for writing, see get()), otherwise it creates it first.
         template <class T> Property<T> get_or_add(const std::string& name, const T t=T())
         {
             Property<T> p = get<T>(name);
@@ -486,6 +742,7 @@ namespace MV {
                     delete *it;
                     parrays_.erase(it);
                     h.reset();
+                    update_index();
                     return true;
                 }
             }
@@ -502,6 +759,7 @@ namespace MV {
                 {
                     delete *it;
                     parrays_.erase(it);
+                    update_index();
                     return true;
                 }
             }
@@ -519,6 +777,7 @@ namespace MV {
                 if ((*it)->name() == old_name)
                 {
                     (*it)->set_name(new_name);
+                    update_index();
                     return true;
                 }
             }
@@ -533,14 +792,19 @@ namespace MV {
                 delete pa;
             parrays_.clear();
             size_ = 0;
+            capacity_ = 0;
+            update_index();
         }
 
 
-        // reserve memory for n entries in all arrays
-        void reserve(size_t n) const
+        // reserve memory for n entries in all arrays (and in the arrays added later)
+        void reserve(size_t n)
         {
+            if (n <= capacity_)
+                return;
             for(auto pa : parrays_)
                 pa->reserve(n);
+            capacity_ = n;
         }
 
         // resize all arrays to size n
@@ -549,6 +813,7 @@ namespace MV {
             for(auto pa : parrays_)
                 pa->resize(n);
             size_ = n;
+            capacity_ = std::max(capacity_, n);
         }
 
         // resize the vector of properties to n, deleting all other properties
@@ -561,18 +826,22 @@ namespace MV {
             for (std::size_t i=n; i<parrays_.size(); ++i)
                 delete parrays_[i];
             parrays_.resize(n);
+            update_index();
         }
 
         // free unused space in all arrays
-        void shrink_to_fit() const
+        void shrink_to_fit()
         {
             for(auto pa : parrays_)
                 pa->shrink_to_fit();
+            capacity_ = size_;
         }
 
         // add a new element to each vector
         void push_back()
         {
+            if (size_ == capacity_)
+                reserve(std::max<size_t>(2 * capacity_, 16));
             for(auto pa : parrays_)
                 pa->push_back();
             ++size_;
@@ -597,6 +866,9 @@ namespace MV {
         {
             this->parrays_.swap (other.parrays_);
             std::swap(this->size_, other.size_);
+            std::swap(this->capacity_, other.capacity_);
+            this->slots_.swap(other.slots_);
+            std::swap(this->renames_, other.renames_);
         }
 
         // copy 'from' -> 'to' in all arrays
@@ -606,12 +878,58 @@ namespace MV {
                 pa->copy(from, to);
         }
 
+        // rearrange the elements of all arrays: element i becomes the former element new_to_old[i]
+        void permute(const std::vector<int>& new_to_old)
+        {
+            for(auto pa : parrays_)
+                pa->permute(new_to_old);
+            size_ = new_to_old.size();
+            capacity_ = size_;
+        }
+
         const std::vector<BasePropertyArray*>& arrays() const { return parrays_; }
+        // the arrays must not be added, removed, or reordered through this (see update_index())
         std::vector<BasePropertyArray*>& arrays() { return parrays_; }
 
+    private:
+        // the array whose name has the interned id \p id, or nullptr
+        BasePropertyArray* find(unsigned int id) const
+        {
+            if (id < slots_.size() && slots_[id] >= 0) {
+                BasePropertyArray* pa = parrays_[slots_[id]];
+                if (pa->id() == id)
+                    return pa;
+            }
+            // an array may have been renamed through a handle since the index was made
+            if (renames_ != BasePropertyArray::renames().load(std::memory_order_relaxed)) {
+                for (auto pa : parrays_)
+                    if (pa->id() == id)
+                        return pa;
+            }
+            return nullptr;
+        }
+
+        // rebuilds the index of the arrays by the ids of their names
+        void update_index()
+        {
+            renames_ = BasePropertyArray::renames().load(std::memory_order_relaxed);
+            unsigned int max_id = 0;
+            for (auto pa : parrays_)
+                max_id = std::max(max_id, pa->id());
+            slots_.assign(parrays_.empty() ? 0 : max_id + 1, -1);
+            // the first array of a name wins, as in a linear search
+            for (std::size_t i = parrays_.size(); i-- > 0; )
+                slots_[parrays_[i]->id()] = static_cast<int>(i);
+        }
+
     private:
         std::vector<BasePropertyArray*>  parrays_;
         size_t  size_;
+        size_t  capacity_;
+
+        // the index of the array of each name id (-1 if none), and BasePropertyArray::renames() when it was made
+        std::vector<int>  slots_;
+        std::uint64_t  renames_;
     };
 
 } // namespace MV
@@ -0,0 +1,42 @@
+#ifndef EASY3D_CORE_PROPERTY_KEYS_H
+#define EASY3D_CORE_PROPERTY_KEYS_H
+
+#include "property.h"
+#include "types.h"
+
+
+namespace MV {
+
+    /**
+     * \brief The keys of the standard properties of the models (see PropertyKey).
+     * \details Looking a property up by these keys compares integers instead of strings, e.g.,
+     *      \code
+     *          auto normals = mesh->get_vertex_property(keys::v_normal);
+     *      \endcode
+     */
+    namespace keys {
+
+        inline const PropertyKey<vec3> v_point("v:point");
+        inline const PropertyKey<vec3> v_normal("v:normal");
+        inline const PropertyKey<vec3> v_color("v:color");
+        inline const PropertyKey<vec2> v_texcoord("v:texcoord");
+        inline const PropertyKey<bool> v_locked("v:locked");
+        inline const PropertyKey<float> v_curv_mean("v:curv-mean");
+        inline const PropertyKey<float> v_curv_gauss("v:curv-gauss");
+        inline const PropertyKey<float> v_curv_min("v:curv-min");
+        inline const PropertyKey<float> v_curv_max("v:curv-max");
+
+        inline const PropertyKey<vec2> h_texcoord("h:texcoord");
+
+        inline const PropertyKey<vec3> e_color("e:color");
+
+        inline const PropertyKey<vec3> f_normal("f:normal");
+        inline const PropertyKey<vec3> f_color("f:color");
+        inline const PropertyKey<int> f_chart("f:chart");
+
+    }   // namespace keys
+
+}   // namespace MV
+
+
+#endif  // EASY3D_CORE_PROPERTY_KEYS_H
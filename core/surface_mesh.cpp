@@ -24,13 +24,52 @@
 
 #include "surface_mesh.h"
 #include "../util/logging.h"
+#include "../util/parallel.h"
 #include "vec.h"
 
 #include <cmath>
 #include <fstream>
+#include <atomic>
+#include <algorithm>
 
 namespace MV {
 
+    namespace details {
+        // The high 32 bits of a topology stamp are unique per mesh (or per assignment), the low 32 bits count the
+        // connectivity changes made since then. So stamps of different meshes never collide.
+        std::atomic<std::uint64_t> topology_stamp_base(0);
+    }
+
+
+    void SurfaceMesh::renew_topology_version()
+    {
+#ifndef NDEBUG
+        if (m_num_readers.load() > 0)
+            report_change_while_read();
+#endif
+        m_topology_version = (details::topology_stamp_base.fetch_add(1) + 1) << 32;
+    }
+
+
+    void SurfaceMesh::report_change_while_read() const
+    {
+        LOG(FATAL) << "the connectivity of mesh '" << name() << "' is changed while " << m_num_readers.load()
+                   << " thread(s) read it (see SurfaceMesh::ReadScope)";
+    }
+
+
+    void SurfaceMesh::unshare_connectivity()
+    {
+        m_vconn.array().detach();
+        m_hconn.array().detach();
+        m_fconn.array().detach();
+        m_vdeleted.array().detach();
+        m_edeleted.array().detach();
+        m_fdeleted.array().detach();
+        m_shared_connectivity.store(false, std::memory_order_relaxed);
+    }
+
+
     SurfaceMesh::SurfaceMesh()
     {
         // allocate standard properties
@@ -47,6 +86,7 @@ namespace MV {
 
         m_uideletedvertices = m_uideletededges = m_deleted_faces = 0;
         m_bgarbage = false;
+        renew_topology_version();
     }
 
 
@@ -57,31 +97,39 @@ namespace MV {
     {
         if (this != &rhs)
         {
-            // deep copy of property containers
+            // copy of property containers (the arrays share their data until written)
             m_vprops = rhs.m_vprops;
             hprops_ = rhs.hprops_;
             m_eprops = rhs.m_eprops;
             fprops_ = rhs.fprops_;
             m_mprops = rhs.m_mprops;
 
-            // property handles contain pointers, have to be reassigned
-            m_vconn    = vertex_property<VertexConnectivity>("v:connectivity");
-            m_hconn    = halfedge_property<HalfedgeConnectivity>("h:connectivity");
-            m_fconn    = face_property<FaceConnectivity>("f:connectivity");
-            m_vdeleted = vertex_property<bool>("v:deleted");
-            m_edeleted = edge_property<bool>("e:deleted");
-            m_fdeleted = face_property<bool>("f:deleted");
-            m_vpoint   = vertex_property<vec3>("v:point");
+            // property handles contain pointers, have to be reassigned. they are looked up through the const
+            // interface, which leaves the data shared (see PropertyArray)
+            const SurfaceMesh& self = *this;
+            m_vconn    = self.get_vertex_property<VertexConnectivity>("v:connectivity");
+            m_hconn    = self.get_halfedge_property<HalfedgeConnectivity>("h:connectivity");
+            m_fconn    = self.get_face_property<FaceConnectivity>("f:connectivity");
+            m_vdeleted = self.get_vertex_property<bool>("v:deleted");
+            m_edeleted = self.get_edge_property<bool>("e:deleted");
+            m_fdeleted = self.get_face_property<bool>("f:deleted");
+            m_vpoint   = self.get_vertex_property<vec3>("v:point");
 
             // normals might be there, therefore use get_property
-            m_vnormal  = get_vertex_property<vec3>("v:normal");
-            m_fnormal  = get_face_property<vec3>("f:normal");
+            m_vnormal  = self.get_vertex_property<vec3>("v:normal");
+            m_fnormal  = self.get_face_property<vec3>("f:normal");
+
+            // the connectivity is copied by the first change of either mesh, the positions right away
+            m_shared_connectivity.store(true, std::memory_order_relaxed);
+            rhs.m_shared_connectivity.store(true, std::memory_order_relaxed);
+            m_vpoint.array().detach();
 
             // how many elements are deleted?
             m_uideletedvertices = rhs.m_uideletedvertices;
             m_uideletededges    = rhs.m_uideletededges;
             m_deleted_faces    = rhs.m_deleted_faces;
             m_bgarbage          = rhs.m_bgarbage;
+            renew_topology_version();
         }
 
         return *this;
@@ -92,6 +140,8 @@ namespace MV {
 
 
     SurfaceMesh &SurfaceMesh::join(const SurfaceMesh &other) {
+        detach_connectivity();
+
         // increase capacity
         const unsigned int nv = vertices_size(), nh = halfedges_size(), nf = faces_size();
         resize(vertices_size() + other.vertices_size(),
@@ -140,6 +190,7 @@ namespace MV {
         m_uideletedvertices += other.m_uideletedvertices;
         m_uideletededges += other.m_uideletededges;
         m_deleted_faces += other.m_deleted_faces;
+        topology_changed();
         return *this;
     }
 
@@ -171,7 +222,8 @@ namespace MV {
             m_vnormal  = get_vertex_property<vec3>("v:normal");
             m_fnormal  = get_face_property<vec3>("f:normal");
 
-            // copy properties from other mesh
+            // copy properties from other mesh (the connectivity is copied by the first change of either mesh, the
+            // positions right away, see operator=())
             m_vconn.array()     = rhs.m_vconn.array();
             m_hconn.array()     = rhs.m_hconn.array();
             m_fconn.array()     = rhs.m_fconn.array();
@@ -179,6 +231,9 @@ namespace MV {
             m_vdeleted.array()  = rhs.m_vdeleted.array();
             m_edeleted.array()  = rhs.m_edeleted.array();
             m_fdeleted.array()  = rhs.m_fdeleted.array();
+            m_shared_connectivity.store(true, std::memory_order_relaxed);
+            rhs.m_shared_connectivity.store(true, std::memory_order_relaxed);
+            m_vpoint.array().detach();
 
             // resize (needed by property containers)
             m_vprops.resize(rhs.vertices_size());
@@ -192,6 +247,7 @@ namespace MV {
             m_uideletededges    = rhs.m_uideletededges;
             m_deleted_faces    = rhs.m_deleted_faces;
             m_bgarbage          = rhs.m_bgarbage;
+            renew_topology_version();
         }
 
         return *this;
@@ -318,6 +374,7 @@ namespace MV {
 
         m_uideletedvertices = m_uideletededges = m_deleted_faces = 0;
         m_bgarbage = false;
+        renew_topology_version();
 
         //---- keep the standard properties and remove all the other properties
 
@@ -331,6 +388,7 @@ namespace MV {
         // update/invalidate the normal properties
         m_vnormal  = VertexProperty<vec3>();
         m_fnormal  = FaceProperty<vec3>();
+        std::vector<std::pair<Vertex, vec3> >().swap(m_normals_moved);
     }
 
 
@@ -832,6 +890,325 @@ namespace MV {
     //-----------------------------------------------------------------------------
 
 
+    std::size_t SurfaceMesh::build_from_indices(const std::vector<vec3>& points,
+                                                const std::vector<unsigned int>& face_offsets,
+                                                const std::vector<unsigned int>& face_indices,
+                                                std::vector<Face>* faces,
+                                                std::vector<Vertex>* copied_vertices,
+                                                unsigned int num_threads)
+    {
+        clear();
+        resize(static_cast<unsigned int>(points.size()), 0, 0);
+        m_vpoint.vector() = points;
+
+        std::vector<Vertex> copies;
+        const std::size_t num_rejected = build_connectivity(face_offsets, face_indices,
+                                                            std::numeric_limits<std::size_t>::max(), faces,
+                                                            &copies, num_threads);
+        if (num_rejected > 0)
+            LOG(WARNING) << num_rejected << " faces rejected (degenerate, or on non-manifold edges)";
+        if (!copies.empty())
+            LOG(WARNING) << copies.size() << " vertices copied to resolve non-manifold vertices";
+        if (copied_vertices)
+            copied_vertices->swap(copies);
+        return num_rejected;
+    }
+
+
+    std::size_t SurfaceMesh::build_connectivity(const std::vector<unsigned int>& face_offsets,
+                                                const std::vector<unsigned int>& face_indices,
+                                                std::size_t max_rejected,
+                                                std::vector<Face>* faces,
+                                                std::vector<Vertex>* copied_vertices,
+                                                unsigned int num_threads)
+    {
+        if (faces)
+            faces->clear();
+        if (copied_vertices)
+            copied_vertices->clear();
+
+        const int nV = static_cast<int>(vertices_size());
+        const int nF = face_offsets.empty() ? 0 : static_cast<int>(face_offsets.size() - 1);
+        const int nC = static_cast<int>(face_indices.size());
+        if (face_offsets.empty() || face_offsets.front() != 0 || face_offsets.back() != face_indices.size() ||
+            !std::is_sorted(face_offsets.begin(), face_offsets.end())) {
+            LOG(ERROR) << "invalid face offsets";
+            return nF;
+        }
+
+        // the face of each corner, and the next and previous corners in the face
+        std::vector<int> corner_face(nC);
+        parallel_for(0, nF, [&](std::size_t f) {
+            for (unsigned int c = face_offsets[f]; c < face_offsets[f + 1]; ++c)
+                corner_face[c] = static_cast<int>(f);
+        }, num_threads);
+        auto next_corner = [&](int c) -> int {
+            const int f = corner_face[c];
+            return (c + 1 == static_cast<int>(face_offsets[f + 1])) ? static_cast<int>(face_offsets[f]) : c + 1;
+        };
+        auto prev_corner = [&](int c) -> int {
+            const int f = corner_face[c];
+            return (c == static_cast<int>(face_offsets[f])) ? static_cast<int>(face_offsets[f + 1]) - 1 : c - 1;
+        };
+
+        // reject the faces that can not be added at all
+        std::vector<char> alive(nF, 1);
+        parallel_for(0, nF, [&](std::size_t f) {
+            const unsigned int begin = face_offsets[f], end = face_offsets[f + 1];
+            if (end - begin < 3) {
+                alive[f] = 0;
+                return;
+            }
+            for (unsigned int c = begin; c < end; ++c) {
+                if (face_indices[c] >= static_cast<unsigned int>(nV) ||
+                    std::find(face_indices.begin() + c + 1, face_indices.begin() + end, face_indices[c]) !=
+                    face_indices.begin() + end) {
+                    alive[f] = 0;
+                    return;
+                }
+            }
+        }, num_threads);
+
+        // Corner c stands for the directed edge from face_indices[c] to the vertex of the next corner. The corners
+        // are bucketed by the smaller vertex of their edge (a counting sort), so all the corners on the same edge
+        // end up in the same small bucket.
+        std::vector<int> bucket_offsets(nV + 1, 0);
+        for (int c = 0; c < nC; ++c) {
+            if (alive[corner_face[c]])
+                ++bucket_offsets[std::min(face_indices[c], face_indices[next_corner(c)]) + 1];
+        }
+        for (int v = 0; v < nV; ++v)
+            bucket_offsets[v + 1] += bucket_offsets[v];
+        std::vector<int> bucket_corners(bucket_offsets[nV]);
+        {
+            std::vector<int> pos(bucket_offsets.begin(), bucket_offsets.end() - 1);
+            for (int c = 0; c < nC; ++c) {
+                if (alive[corner_face[c]])
+                    bucket_corners[pos[std::min(face_indices[c], face_indices[next_corner(c)])]++] = c;
+            }
+        }
+
+        // Pair the corners of each edge. The first corner (i.e., of the first face) creates the edge and the first
+        // later corner of opposite direction becomes its mate; the faces of the other corners are rejected. As this
+        // frees edges of other faces, it is repeated until nothing is rejected.
+        std::vector<int> mate(nC, -1);
+        std::vector<char> leader(nC, 0);
+        std::size_t num_rejected = 0;
+        for (int f = 0; f < nF; ++f)
+            num_rejected += !alive[f];
+        const unsigned int max_chunks = (num_threads > 0) ? num_threads : default_thread_count();
+        while (true) {
+            std::vector<std::vector<int> > rejected(max_chunks);
+            const unsigned int num_chunks = parallel_for_chunks(0, nV, [&](std::size_t begin, std::size_t end, unsigned int chunk) {
+                std::vector<std::pair<unsigned int, int> > group;
+                for (std::size_t v = begin; v < end; ++v) {
+                    group.clear();
+                    for (int k = bucket_offsets[v]; k < bucket_offsets[v + 1]; ++k) {
+                        const int c = bucket_corners[k];
+                        if (alive[corner_face[c]])
+                            group.emplace_back(std::max(face_indices[c], face_indices[next_corner(c)]), c);
+                    }
+                    std::sort(group.begin(), group.end());
+                    for (std::size_t i = 0; i < group.size();) {
+                        std::size_t j = i + 1;
+                        while (j < group.size() && group[j].first == group[i].first)
+                            ++j;
+                        const int c0 = group[i].second;
+                        leader[c0] = 1;
+                        mate[c0] = -1;
+                        for (std::size_t k = i + 1; k < j; ++k) {
+                            const int c = group[k].second;
+                            leader[c] = 0;
+                            if (mate[c0] == -1 && face_indices[c] != face_indices[c0]) {
+                                mate[c0] = c;
+                                mate[c] = c0;
+                            } else
+                                rejected[chunk].push_back(corner_face[c]);
+                        }
+                        i = j;
+                    }
+                }
+            }, num_threads);
+
+            std::size_t count = 0;
+            for (unsigned int i = 0; i < num_chunks; ++i) {
+                for (auto f : rejected[i]) {
+                    if (alive[f]) {
+                        alive[f] = 0;
+                        ++count;
+                    }
+                }
+            }
+            if (count == 0)
+                break;
+            num_rejected += count;
+        }
+        if (num_rejected > max_rejected)
+            return num_rejected;
+
+        // number the faces in input order and the edges in bucket order
+        std::vector<int> face_id(nF, -1);
+        int num_faces = 0;
+        for (int f = 0; f < nF; ++f) {
+            if (alive[f])
+                face_id[f] = num_faces++;
+        }
+        std::vector<int> halfedge_of_corner(nC, -1);
+        int num_edges = 0;
+        for (auto c : bucket_corners) {
+            if (alive[corner_face[c]] && leader[c]) {
+                halfedge_of_corner[c] = 2 * num_edges;
+                if (mate[c] != -1)
+                    halfedge_of_corner[mate[c]] = 2 * num_edges + 1;
+                ++num_edges;
+            }
+        }
+
+        resize(nV, num_edges, num_faces);
+        std::vector<VertexConnectivity>& vconn = m_vconn.vector();
+        std::vector<HalfedgeConnectivity>& hconn = m_hconn.vector();
+        std::vector<FaceConnectivity>& fconn = m_fconn.vector();
+
+        // the halfedges inside the faces
+        parallel_for(0, nF, [&](std::size_t f) {
+            if (!alive[f])
+                return;
+            const Face face(face_id[f]);
+            // the halfedge of the last corner points to the first vertex
+            fconn[face.idx()].halfedge_ = Halfedge(halfedge_of_corner[face_offsets[f + 1] - 1]);
+            for (int c = face_offsets[f]; c < static_cast<int>(face_offsets[f + 1]); ++c) {
+                HalfedgeConnectivity& conn = hconn[halfedge_of_corner[c]];
+                conn.vertex_ = Vertex(face_indices[next_corner(c)]);
+                conn.face_ = face;
+                conn.next_ = Halfedge(halfedge_of_corner[next_corner(c)]);
+                conn.prev_ = Halfedge(halfedge_of_corner[prev_corner(c)]);
+            }
+        }, num_threads);
+
+        // the border halfedges point to the first vertex of the edge of their face
+        for (auto c : bucket_corners) {
+            if (alive[corner_face[c]] && leader[c] && mate[c] == -1)
+                hconn[halfedge_of_corner[c] + 1].vertex_ = Vertex(face_indices[c]);
+        }
+
+        // The outgoing halfedges of each vertex (the source of h is the target of its opposite), in CSR form.
+        const int nH = 2 * num_edges;
+        std::vector<int> out_offsets(nV + 1, 0);
+        for (int h = 0; h < nH; ++h)
+            ++out_offsets[hconn[h ^ 1].vertex_.idx() + 1];
+        for (int v = 0; v < nV; ++v)
+            out_offsets[v + 1] += out_offsets[v];
+        std::vector<int> out_halfedges(nH);
+        {
+            std::vector<int> pos(out_offsets.begin(), out_offsets.end() - 1);
+            for (int h = 0; h < nH; ++h)
+                out_halfedges[pos[hconn[h ^ 1].vertex_.idx()]++] = h;
+        }
+
+        // Splits the outgoing halfedges of vertex v into fans: an interior halfedge h and the opposite of prev(h)
+        // are consecutive around v. Returns the number of fans, the fan of each outgoing halfedge is in fan.
+        auto find_fans = [&](int v, std::vector<int>& fan) -> int {
+            const int begin = out_offsets[v], n = out_offsets[v + 1] - begin;
+            // the counting sort listed the outgoing halfedges in increasing order
+            const auto first = out_halfedges.begin() + begin, last = first + n;
+            fan.resize(n);
+            for (int i = 0; i < n; ++i)
+                fan[i] = i;
+            auto find = [&](int i) { while (fan[i] != i) i = fan[i] = fan[fan[i]]; return i; };
+            for (int i = 0; i < n; ++i) {
+                const int h = out_halfedges[begin + i];
+                if (!hconn[h].face_.is_valid())
+                    continue;
+                const int j = static_cast<int>(std::lower_bound(first, last, hconn[h].prev_.idx() ^ 1) - first);
+                fan[find(i)] = find(j);
+            }
+            int num_fans = 0;
+            std::vector<int> label(n, -1);
+            for (int i = 0; i < n; ++i) {
+                const int r = find(i);
+                if (label[r] == -1)
+                    label[r] = num_fans++;
+            }
+            for (int i = 0; i < n; ++i)
+                fan[i] = label[find(i)];
+            return num_fans;
+        };
+
+        // a boundary fan has exactly one outgoing border halfedge, which becomes the outgoing halfedge of its vertex
+        auto out_halfedge_of_fan = [&](int v, const std::vector<int>& fan, int which) -> Halfedge {
+            Halfedge result;
+            for (int i = 0; i < static_cast<int>(fan.size()); ++i) {
+                if (fan[i] != which)
+                    continue;
+                const int h = out_halfedges[out_offsets[v] + i];
+                if (!hconn[h].face_.is_valid())
+                    return Halfedge(h);
+                if (!result.is_valid())
+                    result = Halfedge(h);
+            }
+            return result;
+        };
+
+        std::vector<std::vector<int> > complex_vertices(max_chunks);
+        const unsigned int num_chunks = parallel_for_chunks(0, nV, [&](std::size_t begin, std::size_t end, unsigned int chunk) {
+            std::vector<int> fan;
+            for (std::size_t v = begin; v < end; ++v) {
+                if (out_offsets[v] == out_offsets[v + 1])
+                    continue;   // isolated
+                if (find_fans(static_cast<int>(v), fan) > 1)
+                    complex_vertices[chunk].push_back(static_cast<int>(v));
+                else
+                    vconn[v].halfedge_ = out_halfedge_of_fan(static_cast<int>(v), fan, 0);
+            }
+        }, num_threads);
+
+        // each extra fan of a non-manifold vertex gets its own copy of the vertex
+        std::vector<int> fan;
+        for (unsigned int i = 0; i < num_chunks; ++i) {
+            for (auto v : complex_vertices[i]) {
+                const int num_fans = find_fans(v, fan);
+                vconn[v].halfedge_ = out_halfedge_of_fan(v, fan, 0);
+                for (int k = 1; k < num_fans; ++k) {
+                    const vec3 p = m_vpoint[Vertex(v)];
+                    const Vertex w = new_vertex();
+                    m_vpoint[w] = p;
+                    // hconn and vconn may have been reallocated by new_vertex()
+                    m_vconn[w].halfedge_ = out_halfedge_of_fan(v, fan, k);
+                    for (int j = 0; j < static_cast<int>(fan.size()); ++j) {
+                        if (fan[j] == k)
+                            m_hconn[Halfedge(out_halfedges[out_offsets[v] + j] ^ 1)].vertex_ = w;
+                    }
+                    if (copied_vertices)
+                        copied_vertices->push_back(Vertex(v));
+                }
+            }
+        }
+
+        // link the border halfedges: the next of a border halfedge is the outgoing border halfedge of its target
+        std::vector<HalfedgeConnectivity>& hc = m_hconn.vector();
+        const std::vector<VertexConnectivity>& vc = m_vconn.vector();
+        parallel_for(0, nH, [&](std::size_t h) {
+            if (hc[h].face_.is_valid())
+                return;
+            const Halfedge next = vc[hc[h].vertex_.idx()].halfedge_;
+            hc[h].next_ = next;
+            hc[next.idx()].prev_ = Halfedge(static_cast<int>(h));
+        }, num_threads);
+
+        if (faces) {
+            faces->resize(nF);
+            for (int f = 0; f < nF; ++f)
+                (*faces)[f] = Face(face_id[f]);
+        }
+
+        topology_changed();
+        return num_rejected;
+    }
+
+
+    //-----------------------------------------------------------------------------
+
+
     unsigned int SurfaceMesh::valence(Vertex v) const
     {
         unsigned int count(0);
@@ -1011,19 +1388,21 @@ namespace MV {
 
     void SurfaceMesh::update_face_normals()
     {
-        if (!m_fnormal)
-            m_fnormal = face_property<vec3>("f:normal");
-
-        FaceIterator fit, fend=faces_end();
-
-        int num_degenerate = 0;
-        for (fit=faces_begin(); fit!=fend; ++fit) {
-            if (is_degenerate(*fit)) {
+        // obtained again: the normals may still be shared with a copy of the mesh (see PropertyArray)
+        m_fnormal = face_property<vec3>("f:normal");
+
+        const ReadScope scope(*this);
+        std::atomic<int> num_degenerate(0);
+        parallel_for(0, faces_size(), [&](std::size_t i) {
+            const Face f(static_cast<int>(i));
+            if (m_fdeleted[f])
+                return;
+            if (is_degenerate(f)) {
                 ++num_degenerate;
-                m_fnormal[*fit] = vec3(0, 0, 1);
+                m_fnormal[f] = vec3(0, 0, 1);
             } else
-                m_fnormal[*fit] = compute_face_normal(*fit);
-        }
+                m_fnormal[f] = compute_face_normal(f);
+        });
 
         if (num_degenerate > 0)
             LOG(WARNING) << "model has " << num_degenerate << " degenerate faces";
@@ -1093,17 +1472,69 @@ namespace MV {
 
     void SurfaceMesh::update_vertex_normals()
     {
-        if (!m_vnormal)
-            m_vnormal = vertex_property<vec3>("v:normal");
+        // the recorded changes only describe all the changes if nothing else changed the positions since
+        const bool recorded = m_vnormal && m_fnormal
+                              && m_normals_topology == m_topology_version
+                              && m_normals_points_version == m_vpoint.version();
+        if (recorded && m_normals_moved.empty())
+            return;
 
-        // compute face normals if needed.
-        // Note: this is not needed if you compute the face normal on the fly using cross product of two
-        //       incident edges of a face (but the "cross product" approach is not stable for concave polygons)
-        if (!m_fnormal)
+        // obtained again: the normals may still be shared with a copy of the mesh (see PropertyArray)
+        m_vnormal = vertex_property<vec3>("v:normal");
+        m_fnormal = face_property<vec3>("f:normal");
+        if (!recorded) {
+
+            // Note: the face normals are not needed if you compute the face normal on the fly using cross product
+            //       of two incident edges of a face (but the "cross product" approach is not stable for concave
+            //       polygons)
             update_face_normals();
 
-        for (VertexIterator vit=vertices_begin(), vend = vertices_end(); vit!=vend; ++vit)
-            m_vnormal[*vit] = compute_vertex_normal(*vit);
+            const ReadScope scope(*this);
+            parallel_for(0, vertices_size(), [&](std::size_t i) {
+                const Vertex v(static_cast<int>(i));
+                if (!m_vdeleted[v])
+                    m_vnormal[v] = compute_vertex_normal(v);
+            });
+        }
+        else {
+            // The faces around the vertices that actually moved (a vertex may be set to the position it had, or
+            // recorded several times; its first record holds the position the normals were computed for), and the
+            // vertices of these faces.
+            std::vector<Face> faces;
+            std::vector<Vertex> vertices;
+            std::vector<bool> vertex_seen(vertices_size(), false);
+            std::vector<bool> face_listed(faces_size(), false);
+            std::vector<bool> vertex_listed(vertices_size(), false);
+            for (const auto& moved : m_normals_moved) {
+                const Vertex v = moved.first;
+                if (vertex_seen[v.idx()])
+                    continue;
+                vertex_seen[v.idx()] = true;
+                if (m_vdeleted[v] || m_vpoint[v] == moved.second)
+                    continue;
+                for (auto f : this->faces(v)) {
+                    if (face_listed[f.idx()])
+                        continue;
+                    face_listed[f.idx()] = true;
+                    faces.push_back(f);
+                    for (auto fv : this->vertices(f)) {
+                        if (!vertex_listed[fv.idx()]) {
+                            vertex_listed[fv.idx()] = true;
+                            vertices.push_back(fv);
+                        }
+                    }
+                }
+            }
+
+            for (auto f : faces)
+                m_fnormal[f] = is_degenerate(f) ? vec3(0, 0, 1) : compute_face_normal(f);
+            for (auto v : vertices)
+                m_vnormal[v] = compute_vertex_normal(v);
+        }
+
+        m_normals_moved.clear();
+        m_normals_topology = m_topology_version;
+        m_normals_points_version = m_vpoint.version();
     }
 
 
@@ -1237,20 +1668,161 @@ namespace MV {
 
 
     SurfaceMesh::Halfedge SurfaceMesh::split(Edge e, Vertex v)
+    {
+        detach_connectivity();
+
+        Halfedge h0 = halfedge(e, 0);
+        Halfedge o0 = halfedge(e, 1);
+
+        Halfedge e1 = new_edge(v, target(o0));
+        Halfedge e0, e2;
+        Face     f1, f2;
+        if (!is_border(h0))
+        {
+            e0 = new_edge(v, target(next(h0)));
+            f1 = new_face();
+        }
+        if (!is_border(o0))
+        {
+            e2 = new_edge(v, target(next(o0)));
+            f2 = new_face();
+        }
+
+        topology_changed();
+        return split_into(e, v, e0, e1, e2, f1, f2);
+    }
+
+
+    //-----------------------------------------------------------------------------
+
+
+    std::vector<SurfaceMesh::Vertex> SurfaceMesh::split_edges(const std::vector<Edge>& edges,
+                                                              const std::vector<vec3>& points,
+                                                              unsigned int num_threads)
+    {
+        assert(edges.size() == points.size());
+        const std::size_t num = edges.size();
+        detach_connectivity();
+
+        // the new elements are allocated at once, in the order of split(Edge, Vertex) for each edge in turn
+        struct NewElements
+        {
+            Halfedge e0, e1, e2;
+            Face f1, f2;
+        };
+        std::vector<NewElements> elements(num);
+        const unsigned int first_vertex = vertices_size();
+        unsigned int next_edge = edges_size(), next_face = faces_size();
+        for (std::size_t i = 0; i < num; ++i)
+        {
+            NewElements& n = elements[i];
+            n.e1 = Halfedge(static_cast<int>(2 * next_edge++));
+            if (!is_border(halfedge(edges[i], 0)))
+            {
+                n.e0 = Halfedge(static_cast<int>(2 * next_edge++));
+                n.f1 = Face(static_cast<int>(next_face++));
+            }
+            if (!is_border(halfedge(edges[i], 1)))
+            {
+                n.e2 = Halfedge(static_cast<int>(2 * next_edge++));
+                n.f2 = Face(static_cast<int>(next_face++));
+            }
+        }
+
+        // resizing copies the arrays that are shared, so the splits below write to arrays of their own
+        resize(first_vertex + static_cast<unsigned int>(num), next_edge, next_face);
+        std::vector<vec3>& positions = m_vpoint.vector();
+        std::vector<Vertex> vertices(num);
+        for (std::size_t i = 0; i < num; ++i)
+        {
+            vertices[i] = Vertex(static_cast<int>(first_vertex + i));
+            positions[first_vertex + i] = points[i];
+        }
+
+        // The splits are done from the longest edge to the shortest. The ties are broken by a mix of the indices,
+        // not by the indices themselves: consecutive edges often share a face, which makes long chains of splits
+        // that have to wait for each other.
+        std::vector<float> lengths(num);
+        for (std::size_t i = 0; i < num; ++i)
+            lengths[i] = length2(positions[vertex(edges[i], 0).idx()] - positions[vertex(edges[i], 1).idx()]);
+        std::vector<std::size_t> pending(num);
+        for (std::size_t i = 0; i < num; ++i)
+            pending[i] = i;
+        auto mix = [](std::size_t i) { return static_cast<std::uint32_t>(i) * 2654435761u; };
+        std::sort(pending.begin(), pending.end(), [&](std::size_t a, std::size_t b) {
+            return lengths[a] > lengths[b] || (lengths[a] == lengths[b] && mix(a) < mix(b));
+        });
+
+        // A round takes the edges, in this order, that have no vertex in common with an edge taken before in the
+        // round, and no face in common with an edge before them that is not split yet. Splits in different faces
+        // give the same result in any order, so the result is that of the splits one after the other.
+        std::vector<unsigned int> vertex_round(first_vertex, 0), face_round(next_face, 0);
+        std::vector<std::size_t> round;
+        for (unsigned int r = 1; !pending.empty(); ++r)
+        {
+            round.clear();
+            std::size_t num_pending = 0;
+            for (std::size_t i : pending)
+            {
+                const int v0 = vertex(edges[i], 0).idx(), v1 = vertex(edges[i], 1).idx();
+                const Face f0 = face(halfedge(edges[i], 0)), f1 = face(halfedge(edges[i], 1));
+                const bool wait = vertex_round[v0] == r || vertex_round[v1] == r
+                                  || (f0.is_valid() && face_round[f0.idx()] == r)
+                                  || (f1.is_valid() && face_round[f1.idx()] == r);
+                if (f0.is_valid())
+                    face_round[f0.idx()] = r;
+                if (f1.is_valid())
+                    face_round[f1.idx()] = r;
+                if (wait)
+                {
+                    pending[num_pending++] = i;
+                    continue;
+                }
+                vertex_round[v0] = r;
+                vertex_round[v1] = r;
+                round.push_back(i);
+            }
+            pending.resize(num_pending);
+
+            parallel_for(0, round.size(), [&](std::size_t k) {
+                const std::size_t i = round[k];
+                const NewElements& n = elements[i];
+                split_into(edges[i], vertices[i], n.e0, n.e1, n.e2, n.f1, n.f2);
+            }, num_threads, 256);
+        }
+
+        topology_changed();
+        return vertices;
+    }
+
+
+    //-----------------------------------------------------------------------------
+
+
+    SurfaceMesh::Halfedge SurfaceMesh::split_into(Edge e, Vertex v, Halfedge e0, Halfedge e1, Halfedge e2,
+                                                  Face f1, Face f2)
     {
         Halfedge h0 = halfedge(e, 0);
         Halfedge o0 = halfedge(e, 1);
 
         Vertex   v2 = target(o0);
 
-        Halfedge e1 = new_edge(v, v2);
         Halfedge t1 = opposite(e1);
+        m_hconn[e1].vertex_ = v2;
+        m_hconn[t1].vertex_ = v;
 
         Face     f0 = face(h0);
         Face     f3 = face(o0);
 
-        set_out_halfedge(v, h0);
-        set_target(o0, v);
+        // the links are written directly: set_next() etc. record each change, which the parallel splits of
+        // split_edges() must not do
+        auto link = [this](Halfedge h, Halfedge nh) {
+            m_hconn[h].next_ = nh;
+            m_hconn[nh].prev_ = h;
+        };
+
+        m_vconn[v].halfedge_ = h0;
+        m_hconn[o0].vertex_ = v;
 
         if (!is_border(h0))
         {
@@ -1259,33 +1831,33 @@ namespace MV {
 
             Vertex   v1 = target(h1);
 
-            Halfedge e0 = new_edge(v, v1);
             Halfedge t0 = opposite(e0);
+            m_hconn[e0].vertex_ = v1;
+            m_hconn[t0].vertex_ = v;
 
-            Face f1 = new_face();
-            set_halfedge(f0, h0);
-            set_halfedge(f1, h2);
+            m_fconn[f0].halfedge_ = h0;
+            m_fconn[f1].halfedge_ = h2;
 
-            set_face(h1, f0);
-            set_face(t0, f0);
-            set_face(h0, f0);
+            m_hconn[h1].face_ = f0;
+            m_hconn[t0].face_ = f0;
+            m_hconn[h0].face_ = f0;
 
-            set_face(h2, f1);
-            set_face(t1, f1);
-            set_face(e0, f1);
+            m_hconn[h2].face_ = f1;
+            m_hconn[t1].face_ = f1;
+            m_hconn[e0].face_ = f1;
 
-            set_next(h0, h1);
-            set_next(h1, t0);
-            set_next(t0, h0);
+            link(h0, h1);
+            link(h1, t0);
+            link(t0, h0);
 
-            set_next(e0, h2);
-            set_next(h2, t1);
-            set_next(t1, e0);
+            link(e0, h2);
+            link(h2, t1);
+            link(t1, e0);
         }
         else
         {
-            set_next(prev(h0), t1);
-            set_next(t1, h0);
+            link(prev(h0), t1);
+            link(t1, h0);
             // halfedge handle of _vh already is h0
         }
 
@@ -1297,38 +1869,38 @@ namespace MV {
 
             Vertex v3 = target(o1);
 
-            Halfedge e2 = new_edge(v, v3);
             Halfedge t2 = opposite(e2);
+            m_hconn[e2].vertex_ = v3;
+            m_hconn[t2].vertex_ = v;
 
-            Face f2 = new_face();
-            set_halfedge(f2, o1);
-            set_halfedge(f3, o0);
+            m_fconn[f2].halfedge_ = o1;
+            m_fconn[f3].halfedge_ = o0;
 
-            set_face(o1, f2);
-            set_face(t2, f2);
-            set_face(e1, f2);
+            m_hconn[o1].face_ = f2;
+            m_hconn[t2].face_ = f2;
+            m_hconn[e1].face_ = f2;
 
-            set_face(o2, f3);
-            set_face(o0, f3);
-            set_face(e2, f3);
+            m_hconn[o2].face_ = f3;
+            m_hconn[o0].face_ = f3;
+            m_hconn[e2].face_ = f3;
 
-            set_next(e1, o1);
-            set_next(o1, t2);
-            set_next(t2, e1);
+            link(e1, o1);
+            link(o1, t2);
+            link(t2, e1);
 
-            set_next(o0, e2);
-            set_next(e2, o2);
-            set_next(o2, o0);
+            link(o0, e2);
+            link(e2, o2);
+            link(o2, o0);
         }
         else
         {
-            set_next(e1, next(o0));
-            set_next(o0, e1);
-            set_out_halfedge(v, e1);
+            link(e1, next(o0));
+            link(o0, e1);
+            m_vconn[v].halfedge_ = e1;
         }
 
         if (out_halfedge(v2) == h0)
-            set_out_halfedge(v2, t1);
+            m_vconn[v2].halfedge_ = t1;
 
         return t1;
     }
@@ -1602,6 +2174,7 @@ namespace MV {
 
         //let's make it sure it is actually checked
         assert(is_stitch_ok(h0, h1));
+        detach_connectivity();
 
         // the new position of the end points
         auto org0 = source(h0);
@@ -1615,6 +2188,7 @@ namespace MV {
         Halfedge new_h1 = opposite(new_h0);
         m_vpoint[org0] = p_org0;
         m_vpoint[org1] = p_org1;
+        m_vpoint.touch();
 
         set_target(new_h0, org0);
         set_target(new_h1, org1);
@@ -1660,6 +2234,7 @@ namespace MV {
                 set_out_halfedge(dest1, Halfedge());
                 m_uideletedvertices++;
                 m_bgarbage = true;
+                topology_changed();
             }
         }
 
@@ -1670,6 +2245,7 @@ namespace MV {
                 set_out_halfedge(dest0, Halfedge());
                 m_uideletedvertices++;
                 m_bgarbage = true;
+                topology_changed();
             }
         }
 
@@ -1691,12 +2267,14 @@ namespace MV {
             m_edeleted[e0] = true;
             m_uideletededges++;
             m_bgarbage = true;
+            topology_changed();
         }
         auto e1 = edge(h1);
         if (!m_edeleted[e1]) {
             m_edeleted[e1] = true;
             m_uideletededges++;
             m_bgarbage = true;
+            topology_changed();
         }
     }
 
@@ -1770,6 +2348,7 @@ namespace MV {
     {
         //let's make it sure it is actually checked
         assert(is_collapse_ok(h));
+        detach_connectivity();
 
         Halfedge h0 = h;
         Halfedge h1 = prev(h0);
@@ -1839,6 +2418,7 @@ namespace MV {
         m_vdeleted[vo]      = true; ++m_uideletedvertices;
         m_edeleted[edge(h)] = true; ++m_uideletededges;
         m_bgarbage = true;
+        topology_changed();
     }
 
 
@@ -1890,6 +2470,7 @@ namespace MV {
         if (fh.is_valid()) { m_fdeleted[fh] = true; ++m_deleted_faces; }
         m_edeleted[edge(h0)] = true; ++m_uideletededges;
         m_bgarbage = true;
+        topology_changed();
     }
 
 
@@ -1899,6 +2480,7 @@ namespace MV {
     void SurfaceMesh::delete_vertex(Vertex v)
     {
         if (m_vdeleted[v])  return;
+        detach_connectivity();
 
         // collect incident faces
         std::vector<Face> incident_faces;
@@ -1923,6 +2505,7 @@ namespace MV {
             m_vdeleted[v] = true;
             m_uideletedvertices++;
             m_bgarbage = true;
+            topology_changed();
         }
     }
 
@@ -1947,6 +2530,7 @@ namespace MV {
     void SurfaceMesh::delete_face(Face f)
     {
         if (m_fdeleted[f])  return;
+        detach_connectivity();
 
         // mark face deleted
         if (!m_fdeleted[f])
@@ -2052,16 +2636,44 @@ namespace MV {
             adjust_outgoing_halfedge(v);
 
         m_bgarbage = true;
+        topology_changed();
     }
 
 
     //-----------------------------------------------------------------------------
 
 
-    void SurfaceMesh::collect_garbage()
+    void SurfaceMesh::collect_garbage(bool keep_order)
     {
         if (!m_bgarbage)
             return;
+        detach_connectivity();
+
+        if (keep_order)
+        {
+            std::vector<int> vorder, eorder, forder;
+            vorder.reserve(vertices_size() - m_uideletedvertices);
+            eorder.reserve(edges_size() - m_uideletededges);
+            forder.reserve(faces_size() - m_deleted_faces);
+            for (int i = 0; i < static_cast<int>(vertices_size()); ++i)
+                if (!m_vdeleted[Vertex(i)]) vorder.push_back(i);
+            for (int i = 0; i < static_cast<int>(edges_size()); ++i)
+                if (!m_edeleted[Edge(i)]) eorder.push_back(i);
+            for (int i = 0; i < static_cast<int>(faces_size()); ++i)
+                if (!m_fdeleted[Face(i)]) forder.push_back(i);
+
+            remap(vorder, eorder, forder);
+            m_vprops.shrink_to_fit();
+            hprops_.shrink_to_fit();
+            m_eprops.shrink_to_fit();
+            fprops_.shrink_to_fit();
+
+            m_uideletedvertices = m_uideletededges = m_deleted_faces = 0;
+            m_bgarbage = false;
+            // the outgoing halfedge of a vertex may have been a deleted one (see below)
+            adjust_outgoing_halfedges();
+            return;
+        }
 
         int  i, i0, i1,
         nV(static_cast<int>(vertices_size())),
@@ -2193,6 +2805,7 @@ namespace MV {
 
         m_uideletedvertices = m_uideletededges = m_deleted_faces = 0;
         m_bgarbage = false;
+        topology_changed();
 
 #if 1
         // [Liangliang]: It seems the outgoing halfedges of the vertices may be broken after garbage collection, e.g.,
@@ -2205,6 +2818,219 @@ namespace MV {
     }
 
 
+    void SurfaceMesh::remap(const std::vector<int>& vertex_order, const std::vector<int>& edge_order,
+                            const std::vector<int>& face_order, unsigned int num_threads)
+    {
+        detach_connectivity();
+        const std::size_t nV = vertex_order.size();
+        const std::size_t nE = edge_order.size();
+        const std::size_t nH = 2 * nE;
+        const std::size_t nF = face_order.size();
+
+        // the two halfedges of an edge stay together
+        std::vector<int> halfedge_order(nH);
+        parallel_for(0, nE, [&](std::size_t i) {
+            halfedge_order[2 * i] = 2 * edge_order[i];
+            halfedge_order[2 * i + 1] = 2 * edge_order[i] + 1;
+        }, num_threads);
+
+        // new index of each former element (-1 for the dropped ones)
+        std::vector<int> vnew(vertices_size(), -1), hnew(halfedges_size(), -1), fnew(faces_size(), -1);
+        parallel_for(0, nV, [&](std::size_t i) { vnew[vertex_order[i]] = static_cast<int>(i); }, num_threads);
+        parallel_for(0, nH, [&](std::size_t i) { hnew[halfedge_order[i]] = static_cast<int>(i); }, num_threads);
+        parallel_for(0, nF, [&](std::size_t i) { fnew[face_order[i]] = static_cast<int>(i); }, num_threads);
+
+        // move the properties, one container per thread
+        PropertyContainer* containers[] = { &m_vprops, &hprops_, &m_eprops, &fprops_ };
+        const std::vector<int>* orders[] = { &vertex_order, &halfedge_order, &edge_order, &face_order };
+        parallel_for(0, 4, [&](std::size_t i) { containers[i]->permute(*orders[i]); }, num_threads, 1);
+
+        // renumber the connectivity
+        auto new_vertex = [&](Vertex v) { return v.is_valid() ? Vertex(vnew[v.idx()]) : v; };
+        auto new_halfedge = [&](Halfedge h) { return h.is_valid() ? Halfedge(hnew[h.idx()]) : h; };
+        auto new_face = [&](Face f) { return f.is_valid() ? Face(fnew[f.idx()]) : f; };
+
+        std::vector<VertexConnectivity>& vconn = m_vconn.vector();
+        parallel_for(0, nV, [&](std::size_t i) {
+            vconn[i].halfedge_ = new_halfedge(vconn[i].halfedge_);
+        }, num_threads);
+
+        std::vector<HalfedgeConnectivity>& hconn = m_hconn.vector();
+        parallel_for(0, nH, [&](std::size_t i) {
+            HalfedgeConnectivity& c = hconn[i];
+            c.face_ = new_face(c.face_);
+            c.vertex_ = new_vertex(c.vertex_);
+            c.next_ = new_halfedge(c.next_);
+            c.prev_ = new_halfedge(c.prev_);
+        }, num_threads);
+
+        std::vector<FaceConnectivity>& fconn = m_fconn.vector();
+        parallel_for(0, nF, [&](std::size_t i) {
+            fconn[i].halfedge_ = new_halfedge(fconn[i].halfedge_);
+        }, num_threads);
+
+        topology_changed();
+    }
+
+
+    namespace details {
+
+        // Spreads the 21 lowest bits of v so that there are two zero bits between each two of them.
+        inline std::uint64_t spread_bits(std::uint64_t v) {
+            v &= 0x1fffff;
+            v = (v | v << 32) & 0x1f00000000ffffull;
+            v = (v | v << 16) & 0x1f0000ff0000ffull;
+            v = (v | v << 8)  & 0x100f00f00f00f00full;
+            v = (v | v << 4)  & 0x10c30c30c30c30c3ull;
+            v = (v | v << 2)  & 0x1249249249249249ull;
+            return v;
+        }
+
+        inline std::uint64_t morton_index(std::uint32_t x, std::uint32_t y, std::uint32_t z) {
+            return spread_bits(x) << 2 | spread_bits(y) << 1 | spread_bits(z);
+        }
+
+        // Index along the 3D Hilbert curve of 21-bit coordinates (J. Skilling, "Programming the Hilbert curve",
+        // AIP Conf. Proc. 707, 2004): the coordinates are transformed in place into the "transposed" index,
+        // whose bits are then interleaved like the Morton index.
+        inline std::uint64_t hilbert_index(std::uint32_t x, std::uint32_t y, std::uint32_t z) {
+            std::uint32_t X[3] = { x, y, z };
+            const std::uint32_t M = 1u << 20;
+            for (std::uint32_t Q = M; Q > 1; Q >>= 1) {
+                const std::uint32_t P = Q - 1;
+                for (int i = 0; i < 3; ++i) {
+                    if (X[i] & Q)
+                        X[0] ^= P;
+                    else {
+                        const std::uint32_t t = (X[0] ^ X[i]) & P;
+                        X[0] ^= t;
+                        X[i] ^= t;
+                    }
+                }
+            }
+            X[1] ^= X[0];
+            X[2] ^= X[1];
+            std::uint32_t t = 0;
+            for (std::uint32_t Q = M; Q > 1; Q >>= 1) {
+                if (X[2] & Q)
+                    t ^= Q - 1;
+            }
+            X[0] ^= t; X[1] ^= t; X[2] ^= t;
+            return morton_index(X[0], X[1], X[2]);
+        }
+
+        // Sorts the points along a space-filling curve and returns their indices in that order.
+        std::vector<int> spatial_order(const std::vector<vec3>& points, SurfaceMesh::SpatialOrder order,
+                                       unsigned int num_threads)
+        {
+            Box3 box;
+            for (const auto& p : points)
+                box.grow(p);
+            // the same scale along all axes, so the curve is not distorted
+            const float extent = box.is_valid() ? std::max(box.max_range(), 1e-30f) : 1.0f;
+            const float scale = static_cast<float>((1u << 21) - 1) / extent;
+            const vec3 origin = box.is_valid() ? box.min_point() : vec3(0, 0, 0);
+
+            std::vector<std::pair<std::uint64_t, int> > keys(points.size());
+            parallel_for(0, points.size(), [&](std::size_t i) {
+                const vec3 q = (points[i] - origin) * scale;
+                const auto x = static_cast<std::uint32_t>(std::min(std::max(q.x, 0.0f), 2097151.0f));
+                const auto y = static_cast<std::uint32_t>(std::min(std::max(q.y, 0.0f), 2097151.0f));
+                const auto z = static_cast<std::uint32_t>(std::min(std::max(q.z, 0.0f), 2097151.0f));
+                const std::uint64_t key = (order == SurfaceMesh::HILBERT_ORDER) ? hilbert_index(x, y, z)
+                                                                                : morton_index(x, y, z);
+                keys[i] = std::make_pair(key, static_cast<int>(i));
+            }, num_threads);
+            std::sort(keys.begin(), keys.end());
+
+            std::vector<int> result(keys.size());
+            for (std::size_t i = 0; i < keys.size(); ++i)
+                result[i] = keys[i].second;
+            return result;
+        }
+    }
+
+
+    void SurfaceMesh::reorder(SpatialOrder order, unsigned int num_threads)
+    {
+        collect_garbage(true);
+
+        const std::vector<int> vorder = details::spatial_order(m_vpoint.vector(), order, num_threads);
+
+        std::vector<vec3> centroids(faces_size());
+        parallel_for(0, faces_size(), [&](std::size_t i) {
+            vec3 c(0, 0, 0);
+            int n = 0;
+            for (auto v : vertices(Face(static_cast<int>(i)))) {
+                c += m_vpoint[v];
+                ++n;
+            }
+            centroids[i] = n > 0 ? c / static_cast<float>(n) : c;
+        }, num_threads);
+        const std::vector<int> forder = details::spatial_order(centroids, order, num_threads);
+
+        std::vector<Vertex> vertex_order(vorder.size());
+        for (std::size_t i = 0; i < vorder.size(); ++i)
+            vertex_order[i] = Vertex(vorder[i]);
+        std::vector<Face> face_order(forder.size());
+        for (std::size_t i = 0; i < forder.size(); ++i)
+            face_order[i] = Face(forder[i]);
+        reorder(vertex_order, face_order);
+    }
+
+
+    bool SurfaceMesh::reorder(const std::vector<Vertex>& vertex_order, const std::vector<Face>& face_order)
+    {
+        if (m_bgarbage || vertex_order.size() != vertices_size() || face_order.size() != faces_size()) {
+            LOG(ERROR) << "the new orders must list all the elements of a mesh without garbage";
+            return false;
+        }
+
+        std::vector<int> vorder(vertex_order.size()), forder(face_order.size());
+        std::vector<char> listed(std::max(vorder.size(), forder.size()), 0);
+        for (std::size_t i = 0; i < vorder.size(); ++i) {
+            const int idx = vertex_order[i].idx();
+            if (idx < 0 || idx >= static_cast<int>(vorder.size()) || listed[idx]) {
+                LOG(ERROR) << "the new order of the vertices is not a permutation";
+                return false;
+            }
+            listed[idx] = 1;
+            vorder[i] = idx;
+        }
+        std::fill(listed.begin(), listed.end(), 0);
+        for (std::size_t i = 0; i < forder.size(); ++i) {
+            const int idx = face_order[i].idx();
+            if (idx < 0 || idx >= static_cast<int>(forder.size()) || listed[idx]) {
+                LOG(ERROR) << "the new order of the faces is not a permutation";
+                return false;
+            }
+            listed[idx] = 1;
+            forder[i] = idx;
+        }
+
+        // an edge comes with the first face containing it, the edges without faces come last
+        std::vector<int> eorder;
+        eorder.reserve(edges_size());
+        std::vector<char> placed(edges_size(), 0);
+        for (auto idx : forder) {
+            for (auto h : halfedges(Face(idx))) {
+                const int e = edge(h).idx();
+                if (!placed[e]) {
+                    placed[e] = 1;
+                    eorder.push_back(e);
+                }
+            }
+        }
+        for (int e = 0; e < static_cast<int>(edges_size()); ++e) {
+            if (!placed[e])
+                eorder.push_back(e);
+        }
+
+        remap(vorder, eorder, forder);
+        return true;
+    }
+
+
     bool SurfaceMesh::is_degenerate(Face f) const {
         Halfedge h = halfedge(f);
         Halfedge hend = h;
@@ -44,6 +44,17 @@ namespace MV {
      *      SurfaceMeshBuilder should be used for the construction, which guarantees you end up with a polygonal
      *      mesh of a 2-manifold topology. In any case, client code is highly recommended to use SurfaceMeshBuilder.
      *
+     * @par Thread safety
+     *      - Any number of threads may call the const methods of a mesh concurrently (traversal, circulators,
+     *        the const access to the properties). The exception is Model::bounding_box(), which computes the box
+     *        on its first call: call it once before sharing the mesh.
+     *      - Different threads may write different elements of a property concurrently, including the bool
+     *        properties (see PropertyStorage). After the mesh has been copied, obtaining a property for writing
+     *        duplicates its data, see PropertyArray for what this implies.
+     *      - Adding, deleting, or re-linking elements (and adding or removing properties) must not run concurrently
+     *        with any other access. In debug builds, changing the connectivity while a ReadScope of the mesh exists
+     *        is reported as a fatal error.
+     *
      * \class SurfaceMesh MV/core/surface_mesh.h
      * \sa SurfaceMeshBuilder.
      */
@@ -985,10 +996,13 @@ namespace MV {
         /// destructor (is virtual, since we inherit from Geometry_representation)
         ~SurfaceMesh() override = default;
 
-        /// copy constructor: copies \c rhs to \c *this. performs a deep copy of all properties.
+        /// copy constructor: copies \c rhs to \c *this. the properties share their data until written (copy-on-write, see PropertyArray), so this is cheap.
         SurfaceMesh(const SurfaceMesh& rhs) { operator=(rhs); }
 
-        /// assign \c rhs to \c *this. performs a deep copy of all properties.
+        /// assign \c rhs to \c *this. the properties share their data until written (copy-on-write, see PropertyArray).
+        /// Handles of the properties of either mesh obtained before must be obtained again for writing. The
+        /// connectivity stays shared until either mesh changes it, the positions are copied right away (12 bytes
+        /// per vertex), so that position(v) can hand them out for writing without any check.
         SurfaceMesh& operator=(const SurfaceMesh& rhs);
 
         /// \brief Merges another surface mesh into the current one.
@@ -1048,6 +1062,35 @@ namespace MV {
         /// \sa add_triangle, add_face
         Face add_quad(Vertex v1, Vertex v2, Vertex v3, Vertex v4);
 
+        /**
+         * \brief Builds the mesh from indexed arrays in one go. The mesh is cleared first.
+         * \details This is much faster than adding the faces one by one: the halfedges are paired by bucketing
+         *      the edges by their smaller vertex (a counting sort), and most passes run in parallel. Problems are
+         *      handled in bulk instead of face by face:
+         *      - faces with fewer than three vertices, or with invalid or repeated vertex indices, are rejected;
+         *      - an edge shared by more than two faces, or by two faces with the same orientation, keeps the first
+         *        face and the first face of opposite orientation; the other faces are rejected;
+         *      - a vertex whose faces form several fans (a non-manifold vertex) is copied once per extra fan.
+         *      The accepted faces keep the input order, and halfedge(f) points to the first vertex of the face (as
+         *      with add_face()). Face properties, halfedge properties, etc. can thus be mapped from the input.
+         *      SurfaceMeshBuilder::add_faces() uses it to load files, with the repair rules of the builder.
+         * \param points The vertex positions. Vertex i is at points[i].
+         * \param face_offsets The vertices of face i are face_indices[face_offsets[i] .. face_offsets[i + 1]). It
+         *      has one entry more than there are faces, starting with 0 and ending with face_indices.size().
+         * \param face_indices The vertex indices of all faces.
+         * \param faces If not null, receives the face created for each input face (an invalid face if rejected).
+         * \param copied_vertices If not null, receives the vertex each copy was made from. The copies are added
+         *      after the input vertices, i.e., vertex points.size() + i is a copy of (*copied_vertices)[i].
+         * \param num_threads The number of threads (0 means default_thread_count()).
+         * \return The number of rejected faces.
+         */
+        std::size_t build_from_indices(const std::vector<vec3>& points,
+                                       const std::vector<unsigned int>& face_offsets,
+                                       const std::vector<unsigned int>& face_indices,
+                                       std::vector<Face>* faces = nullptr,
+                                       std::vector<Vertex>* copied_vertices = nullptr,
+                                       unsigned int num_threads = 0);
+
         //@}
 
 
@@ -1089,6 +1132,7 @@ namespace MV {
         /// associated properties.
         /// Note: ne is the number of edges. for halfedges, nh = 2 * ne. */
         void resize(unsigned int nv, unsigned int ne, unsigned int nf) {
+            topology_changed();
             m_vprops.resize(nv);
             hprops_.resize(2 * ne);
             m_eprops.resize(ne);
@@ -1098,8 +1142,72 @@ namespace MV {
         /// are there deleted vertices, edges or faces?
         bool has_garbage() const { return m_bgarbage; }
 
-        /// remove deleted vertices/edges/faces
-        void collect_garbage();
+        /// \brief Returns a stamp identifying the current connectivity of the mesh.
+        /// \details The stamp changes whenever elements are added, deleted, or re-linked (this includes
+        /// collect_garbage(), clear(), resize(), and assignment), and two different meshes never share a stamp.
+        /// Moving vertices does not change it. Data derived from the connectivity alone (e.g., adjacency tables)
+        /// can thus be cached and rebuilt only when the stamp differs from the one it was built for.
+        std::uint64_t topology_version() const { return m_topology_version; }
+
+        /**
+         * \brief Declares that the calling thread traverses a mesh until the scope ends.
+         * \details This is a debug aid: in debug builds, changing the connectivity of the mesh while a ReadScope of
+         *      it exists is reported as a fatal error (see "Thread safety" in the class description). It costs
+         *      nothing in release builds. Open it around parallel traversals:
+         *      \code
+         *          SurfaceMesh::ReadScope scope(mesh);
+         *          parallel_for(0, mesh.faces_size(), [&](std::size_t i) { ... });
+         *      \endcode
+         */
+        class ReadScope {
+        public:
+            explicit ReadScope(const SurfaceMesh& mesh) : mesh_(mesh) {
+#ifndef NDEBUG
+                ++mesh_.m_num_readers;
+#endif
+            }
+            ~ReadScope() {
+#ifndef NDEBUG
+                --mesh_.m_num_readers;
+#endif
+            }
+            ReadScope(const ReadScope&) = delete;
+            ReadScope& operator=(const ReadScope&) = delete;
+
+        private:
+            const SurfaceMesh& mesh_;
+        };
+
+        /**
+         * \brief Removes deleted vertices/edges/faces.
+         * \param keep_order By default, each deleted element is filled with the last live one, which scatters
+         *      the elements a bit more after each deletion. With \p keep_order, the live elements are compacted
+         *      in their current order instead (in parallel), so a mesh with a good layout keeps it.
+         */
+        void collect_garbage(bool keep_order = false);
+
+        /// The space-filling curves reorder() can lay the elements along.
+        enum SpatialOrder { MORTON_ORDER, HILBERT_ORDER };
+
+        /**
+         * \brief Renumbers the vertices and the faces along a space-filling curve, so that elements close in space
+         *      are also close in memory.
+         * \details The vertices are sorted by the curve index of their positions and the faces by that of their
+         *      centroids. The edges (and their halfedges) follow the new order of the faces. All the properties are
+         *      permuted accordingly. This improves the locality of circulators and of the index buffers built
+         *      from the mesh. Garbage is collected first.
+         * \param order The Hilbert curve gives slightly better locality, the Morton order is cheaper to compute.
+         * \param num_threads The number of threads used (0 means default_thread_count()).
+         */
+        void reorder(SpatialOrder order = HILBERT_ORDER, unsigned int num_threads = 0);
+
+        /**
+         * \brief Renumbers the vertices and the faces in a given order.
+         * \details The new vertex i is the former vertex \p vertex_order[i] (and the same for faces). Both must be
+         *      permutations of all the elements of a mesh without garbage, otherwise nothing is changed and
+         *      \c false is returned. The edges follow the new order of the faces.
+         */
+        bool reorder(const std::vector<Vertex>& vertex_order, const std::vector<Face>& face_order);
 
 
         /// returns whether vertex \c v is deleted
@@ -1169,7 +1277,9 @@ namespace MV {
         /// set the outgoing halfedge of vertex \c v to \c h
         void set_out_halfedge(Vertex v, Halfedge h)
         {
+            detach_connectivity();
             m_vconn[v].halfedge_ = h;
+            topology_changed();
         }
 
         /// returns whether \c v is a boundary vertex
@@ -1222,7 +1332,9 @@ namespace MV {
         /// sets the vertex the halfedge \c h points to to \c v
         void set_target(Halfedge h, Vertex v)
         {
+            detach_connectivity();
             m_hconn[h].vertex_ = v;
+            topology_changed();
         }
 
         /// returns the face incident to halfedge \c h
@@ -1234,7 +1346,9 @@ namespace MV {
         /// sets the incident face to halfedge \c h to \c f
         void set_face(Halfedge h, Face f)
         {
+            detach_connectivity();
             m_hconn[h].face_ = f;
+            topology_changed();
         }
 
         /// returns the next halfedge within the incident face
@@ -1246,8 +1360,10 @@ namespace MV {
         /// sets the next halfedge of \c h within the face to \c nh
         void set_next(Halfedge h, Halfedge nh)
         {
+            detach_connectivity();
             m_hconn[h].next_ = nh;
             m_hconn[nh].prev_ = h;
+            topology_changed();
         }
 
         /// returns the previous halfedge within the incident face
@@ -1340,7 +1456,9 @@ namespace MV {
         /// sets the halfedge of face \c f to \c h
         void set_halfedge(Face f, Halfedge h)
         {
+            detach_connectivity();
             m_fconn[f].halfedge_ = h;
+            topology_changed();
         }
 
         /// returns whether \c f is a boundary face, i.e., it one of its edges is a boundary edge.
@@ -1451,6 +1569,78 @@ namespace MV {
             return ModelProperty<T>(m_mprops.get<T>(name));
         }
 
+        /** The get_*_property() of a const mesh return handles for reading: after the mesh was copied, the data
+         may still be shared with the copy (see PropertyArray). Those of a non-const mesh, like vertex_property()
+         etc., make the data of the property exclusive to this mesh, so the handles can be used for writing. */
+        template <class T> VertexProperty<T> get_vertex_property(const std::string& name)
+        {
+            return VertexProperty<T>(m_vprops.get<T>(name));
+        }
+        /** get the halfedge property named \c name of type \c T for writing. */
+        template <class T> HalfedgeProperty<T> get_halfedge_property(const std::string& name)
+        {
+            return HalfedgeProperty<T>(hprops_.get<T>(name));
+        }
+        /** get the edge property named \c name of type \c T for writing. */
+        template <class T> EdgeProperty<T> get_edge_property(const std::string& name)
+        {
+            return EdgeProperty<T>(m_eprops.get<T>(name));
+        }
+        /** get the face property named \c name of type \c T for writing. */
+        template <class T> FaceProperty<T> get_face_property(const std::string& name)
+        {
+            return FaceProperty<T>(fprops_.get<T>(name));
+        }
+        /** get the model property named \c name of type \c T for writing. */
+        template <class T> ModelProperty<T> get_model_property(const std::string& name)
+        {
+            return ModelProperty<T>(m_mprops.get<T>(name));
+        }
+
+        /** get a property by its interned name (see PropertyKey), comparing integers instead of strings. Use it in
+         code that looks properties up often. returns an invalid property if it does not exist or if the type does
+         not match. */
+        template <class T> VertexProperty<T> get_vertex_property(const PropertyKey<T>& key) const
+        {
+            return VertexProperty<T>(m_vprops.get(key));
+        }
+        /** get a halfedge property by its interned name (see PropertyKey). */
+        template <class T> HalfedgeProperty<T> get_halfedge_property(const PropertyKey<T>& key) const
+        {
+            return HalfedgeProperty<T>(hprops_.get(key));
+        }
+        /** get an edge property by its interned name (see PropertyKey). */
+        template <class T> EdgeProperty<T> get_edge_property(const PropertyKey<T>& key) const
+        {
+            return EdgeProperty<T>(m_eprops.get(key));
+        }
+        /** get a face property by its interned name (see PropertyKey). */
+        template <class T> FaceProperty<T> get_face_property(const PropertyKey<T>& key) const
+        {
+            return FaceProperty<T>(fprops_.get(key));
+        }
+
+        /** get a vertex property by its interned name for writing (see get_vertex_property(const std::string&)). */
+        template <class T> VertexProperty<T> get_vertex_property(const PropertyKey<T>& key)
+        {
+            return VertexProperty<T>(m_vprops.get(key));
+        }
+        /** get a halfedge property by its interned name for writing. */
+        template <class T> HalfedgeProperty<T> get_halfedge_property(const PropertyKey<T>& key)
+        {
+            return HalfedgeProperty<T>(hprops_.get(key));
+        }
+        /** get an edge property by its interned name for writing. */
+        template <class T> EdgeProperty<T> get_edge_property(const PropertyKey<T>& key)
+        {
+            return EdgeProperty<T>(m_eprops.get(key));
+        }
+        /** get a face property by its interned name for writing. */
+        template <class T> FaceProperty<T> get_face_property(const PropertyKey<T>& key)
+        {
+            return FaceProperty<T>(fprops_.get(key));
+        }
+
 
         /** if a vertex property of type \c T with name \c name exists, it is returned.
          otherwise this property is added (with default value \c t) */
@@ -1803,6 +1993,23 @@ namespace MV {
         Halfedge split(Edge e, Vertex v);
 
 
+        /**
+         * \brief Splits the edges \p edges at the points \p points, in parallel.
+         * \details The result is that of split(Edge, const vec3&) on the edges one after the other, from the
+         *      longest to the shortest (ties in a fixed pseudo-random order), at the point with the same index; the
+         *      new elements are numbered in the order of \p edges. A split only changes its edge, the faces of the
+         *      edge, and the boundary halfedges at its vertices, so the splits of edges without a common vertex are
+         *      independent, unless one of them has to wait for a longer edge of one of its faces. The splits are
+         *      done in rounds of such edges, each round in parallel, and the result does not depend on the number
+         *      of threads.
+         * \param num_threads The number of threads (0 means default_thread_count()).
+         * \return The new vertices, in the order of the edges.
+         * \attention This function is only valid for triangle meshes.
+         */
+        std::vector<Vertex> split_edges(const std::vector<Edge>& edges, const std::vector<vec3>& points,
+                                        unsigned int num_threads = 0);
+
+
         /** Subdivide the edge \c e = (v0,v1) by splitting it into the two edge
          (v0,p) and (p,v1). Note that this function does not introduce any
          other edge or faces. It simply splits the edge. Returns halfedge that
@@ -1927,22 +2134,54 @@ namespace MV {
         /// position of a vertex (read only)
         const vec3& position(Vertex v) const { return m_vpoint[v]; }
 
-        /// position of a vertex
+        /// position of a vertex. Writing through it is not recorded, see set_position().
         vec3& position(Vertex v) { return m_vpoint[v]; }
 
+        /// sets the position of a vertex and records the change (see update_vertex_normals()).
+        void set_position(Vertex v, const vec3& p) {
+            // only the changes since the normals were computed are recorded, and only as long as nothing else
+            // invalidated them and recomputing the normals locally pays off
+            const bool tracked = m_normals_topology == m_topology_version
+                                 && m_normals_points_version == m_vpoint.version()
+                                 && m_normals_moved.size() * 8 < vertices_size();
+            if (tracked)
+                m_normals_moved.emplace_back(v, m_vpoint[v]);
+            m_vpoint[v] = p;
+            m_vpoint.touch();
+            if (tracked)
+                m_normals_points_version = m_vpoint.version();
+        }
+
         /// vector of vertex positions (read only)
         const std::vector<vec3>& points() const override { return m_vpoint.vector(); }
 
-        /// vector of vertex positions
+        /// vector of vertex positions. Writing through it is not recorded, see mark_positions_changed().
         std::vector<vec3>& points() override { return m_vpoint.vector(); }
 
+        /// records that the positions were written through points(), position(v), or a handle of "v:point" (see
+        /// update_vertex_normals()).
+        void mark_positions_changed() { m_vpoint.touch(); }
+
         /// compute face normals by calling compute_face_normal(Face) for each face.
         void update_face_normals();
 
         /// compute normal vector of face \c f. This method is robust for concave and general polygonal faces.
         vec3 compute_face_normal(Face f) const;
 
-        /// compute vertex normals by calling compute_vertex_normal(Vertex) for each vertex.
+        /**
+         * \brief Brings the vertex normals (and the face normals they are computed from) up to date.
+         * \details The normals are only recomputed if the connectivity or the positions changed since the last
+         *      call. The changes of the positions are recorded when they are made:
+         *      - set_position(v, p) records v together with its former position. Only the recorded vertices whose
+         *        position actually differs are then taken into account: the normals of the faces around them and
+         *        of the vertices of these faces are recomputed. Once more than an eighth of the vertices have been
+         *        recorded, the recording stops and everything is recomputed;
+         *      - mark_positions_changed(), touch() on "v:point", and any change made through the interface of the
+         *        property array (resize, swap, ...) invalidate all the normals.
+         *      Writes through position(v), points(), or a handle of "v:point" are not seen: code writing the
+         *      positions that way has to call mark_positions_changed() afterwards. As the recording is not
+         *      synchronized, parallel code writes the positions that way rather than through set_position().
+         */
         void update_vertex_normals();
 
         /// compute normal vector of vertex \c v. This is the angle-weighted average of incident face normals.
@@ -1963,6 +2202,7 @@ namespace MV {
         Vertex new_vertex()
         {
             m_vprops.push_back();
+            topology_changed();
             return Vertex(static_cast<int>(vertices_size()-1));
         }
 
@@ -1988,6 +2228,7 @@ namespace MV {
         Face new_face()
         {
             fprops_.push_back();
+            topology_changed();
             return Face(static_cast<int>(faces_size()-1));
         }
 
@@ -2016,6 +2257,55 @@ namespace MV {
         /// twice by is_stitch_ok(), once per orientation of the edges.
         bool can_merge_vertices(Halfedge h0, Halfedge h1) const;
 
+        /// Gives the mesh a topology stamp that no other mesh has used (see topology_version()).
+        void renew_topology_version();
+
+        /// Records a change of the connectivity (see topology_version()). In debug builds, it also checks that
+        /// no ReadScope of the mesh exists.
+        void topology_changed() {
+#ifndef NDEBUG
+            if (m_num_readers.load() > 0)
+                report_change_while_read();
+#endif
+            ++m_topology_version;
+        }
+
+        /// Reports a change of the connectivity while the mesh is being read (debug builds only).
+        void report_change_while_read() const;
+
+        /// Gives the mesh its own copy of the connectivity and of the deletion flags if it may share them with a
+        /// copy of the mesh (see operator=()). The members writing them call it first, since the element access
+        /// of the property arrays does not check (see PropertyArray).
+        void detach_connectivity() {
+            if (m_shared_connectivity.load(std::memory_order_relaxed))
+                unshare_connectivity();
+        }
+
+        /// The part of detach_connectivity() that copies the data.
+        void unshare_connectivity();
+
+        /// Builds the connectivity of build_from_indices() on the current vertices (there must be no edges and
+        /// faces, and no deleted vertices). If more than \p max_rejected faces would be rejected, the mesh is not
+        /// changed. Returns the number of rejected faces.
+        std::size_t build_connectivity(const std::vector<unsigned int>& face_offsets,
+                                       const std::vector<unsigned int>& face_indices,
+                                       std::size_t max_rejected,
+                                       std::vector<Face>* faces,
+                                       std::vector<Vertex>* copied_vertices,
+                                       unsigned int num_threads);
+
+        /// Splits \p e at \p v (see split(Edge, Vertex)) with elements allocated before: the new edge from \p v to
+        /// the second vertex of \p e is \p e1, and the edges from \p v to the vertices opposite to \p e and the new
+        /// faces are \p e0 and \p f1 for the face of halfedge(e, 0), and \p e2 and \p f2 for that of
+        /// halfedge(e, 1) (invalid if there is no such face). It does not record the change (topology_changed()).
+        Halfedge split_into(Edge e, Vertex v, Halfedge e0, Halfedge e1, Halfedge e2, Face f1, Face f2);
+
+        /// Keeps the vertices, edges, and faces listed in \p vertex_order, \p edge_order, and \p face_order (in
+        /// this order) and drops the others: the new element i is the former element order[i]. All the properties
+        /// are moved and the connectivity is renumbered. References to dropped elements become invalid handles.
+        void remap(const std::vector<int>& vertex_order, const std::vector<int>& edge_order,
+                   const std::vector<int>& face_order, unsigned int num_threads = 0);
+
     private: //------------------------------------------------------- private data
 
         PropertyContainer m_vprops;
@@ -2040,6 +2330,19 @@ namespace MV {
         unsigned int m_uideletededges;
         unsigned int m_deleted_faces;
         bool m_bgarbage;
+        std::uint64_t m_topology_version;
+
+        // the number of ReadScopes of this mesh (counted in debug builds only)
+        mutable std::atomic<int> m_num_readers{0};
+
+        // whether the connectivity may be shared with a copy of the mesh (see detach_connectivity())
+        mutable std::atomic<bool> m_shared_connectivity{false};
+
+        // what the normals were last computed for, and the positions recorded as changed since then (see
+        // update_vertex_normals()); the version of "v:point" is advanced with each recorded change
+        std::uint64_t m_normals_topology = 0;
+        std::uint64_t m_normals_points_version = 0;
+        std::vector<std::pair<Vertex, vec3> > m_normals_moved;     // vertex and its former position
 
         // helper data for add_face()
         typedef std::pair<Halfedge, Halfedge>  NextCacheEntry;
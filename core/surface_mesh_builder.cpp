@@ -25,7 +25,7 @@
  ********************************************************************/
 
 #include "surface_mesh_builder.h"
-#include <set>
+#include <algorithm>
 
 #include "../util/logging.h"
 #include "../util/file_system.h"
@@ -34,9 +34,6 @@
 namespace MV {
 
 
-    static const std::string name_known_nm_vertex("v:SurfaceMeshBuilder:known_nm_vertex");
-    static const std::string name_visited_vertex("v:SurfaceMeshBuilder:visited_vertex");
-    static const std::string name_visited_halfedge("h:SurfaceMeshBuilder:visited_halfedge");
     static const std::string name_original_vertex("h:SurfaceMeshBuilder:original_vertex");
 
 
@@ -59,7 +56,8 @@ namespace MV {
         face_vertices_.clear();
         copied_vertices_.clear();
         copied_vertices_for_linking_.clear();
-        outgoing_halfedges_.clear();
+        halfedge_sources_.clear();
+        halfedge_targets_.clear();
 
         original_vertex_ = mesh_->add_vertex_property<Vertex>(name_original_vertex);
     }
@@ -83,27 +81,19 @@ namespace MV {
         // now all copy occurrences are known
         // mark all copied vertices in property "v:locked"
         auto locked = mesh_->vertex_property<bool>("v:locked");
-        std::size_t num_non_manifold_vertices = copied_vertices_.size();
-        std::size_t num_copy_occurrences(0);
-        for (const auto& copies : copied_vertices_) {
-            LOG_IF(copies.second.empty(), FATAL) << "vertex " << copies.first << " not actually copied";
-            num_copy_occurrences += copies.second.size();
-            for (auto v : copies.second)
-                locked[v] = true;
-        }
+        std::size_t num_non_manifold_vertices = copied_vertices_.num_vertices();
+        std::size_t num_copy_occurrences = copied_vertices_.copies().size();
+        for (auto v : copied_vertices_.copies())
+            locked[v] = true;
         // Release memory immediately when not needed any more.
         copied_vertices_.clear();
 
         // Query the number of non-manifold edges.
-        std::size_t num_non_manifold_edges(0);
-        for (const auto &targets : outgoing_halfedges_) {
-            const auto& halfedges = targets.second;
-            std::set<int> tmp(halfedges.begin(), halfedges.end());
-            num_non_manifold_edges += (halfedges.size() - tmp.size());
-        }
+        std::size_t num_non_manifold_edges = count_non_manifold_edges();
 
         // Release memory immediately when not needed any more.
-        outgoing_halfedges_.clear();
+        std::vector<int>().swap(halfedge_sources_);
+        std::vector<int>().swap(halfedge_targets_);
 
         // ----------------------------------------------------------------------------------
 
@@ -202,15 +192,10 @@ namespace MV {
                 issues += "\n   - " + std::to_string(num_non_manifold_vertices) + " vertices copied ("
                           + std::to_string(num_copy_occurrences) + " occurrences)";
 
-                if (!copied_vertices_for_linking_.empty()) {
-                    std::size_t occurrences(0);
-                    for (const auto &copies : copied_vertices_for_linking_) {
-                        LOG_IF(copies.second.empty(), FATAL) << "vertex " << copies.first << " not actually copied";
-                        occurrences += copies.second.size();
-                    }
-                    issues += ", among which " + std::to_string(copied_vertices_for_linking_.size()) + " vertices with "
-                              + std::to_string(occurrences) + " occurrences for linking new faces";
-                    copied_vertices_for_linking_.clear();
+                if (copied_vertices_for_linking_.num_vertices() > 0) {
+                    issues += ", among which " + std::to_string(copied_vertices_for_linking_.num_vertices())
+                              + " vertices with " + std::to_string(copied_vertices_for_linking_.copies().size())
+                              + " occurrences for linking new faces";
                 }
             }
             if (num_isolated_vertices > 0)
@@ -219,6 +204,8 @@ namespace MV {
 
         // ----------------------------------------------------------------------------------
 
+        copied_vertices_for_linking_.clear();
+
         if (!issues.empty())
             LOG(WARNING) << "mesh has topological issues:" << issues;
     }
@@ -325,7 +312,7 @@ namespace MV {
                         face_vertices_[t] = copy_vertex(vertices[t]);
 
                         // keep a record that this copy if for linking a face to the mesh. This is just for the report.
-                        copied_vertices_for_linking_[vertices[t]].push_back(face_vertices_[t]);
+                        copied_vertices_for_linking_.add(vertices[t], face_vertices_[t]);
                     }
                 }
             }
@@ -338,9 +325,8 @@ namespace MV {
         if (face.is_valid()) {
             // put the halfedges into our record (of the original vertex indices)
             for (std::size_t s = 0, t = 1; s < n; ++s, ++t, t %= n) {
-                int s_idx = vertices[s].idx();
-                int t_idx = vertices[t].idx();
-                outgoing_halfedges_[s_idx].push_back(t_idx);
+                halfedge_sources_.push_back(vertices[s].idx());
+                halfedge_targets_.push_back(vertices[t].idx());
             }
         } else {
             ++num_faces_unknown_topology_;
@@ -351,6 +337,111 @@ namespace MV {
     }
 
 
+    std::size_t SurfaceMeshBuilder::add_faces(const std::vector<unsigned int> &face_offsets,
+                                              const std::vector<unsigned int> &face_indices,
+                                              std::vector<Face> *faces) {
+        DLOG_IF(!original_vertex_, ERROR) << "you must call begin_surface() before the constructing a surface mesh";
+        const std::size_t num_faces = face_offsets.empty() ? 0 : face_offsets.size() - 1;
+        if (faces)
+            faces->assign(num_faces, Face());
+        if (num_faces == 0)
+            return 0;
+        if (face_offsets.front() != 0 || face_offsets.back() != face_indices.size() ||
+            !std::is_sorted(face_offsets.begin(), face_offsets.end())) {
+            LOG(ERROR) << "invalid face offsets";
+            return 0;
+        }
+
+        // The faces add_face() ignores, counted as vertices_valid() and SurfaceMesh::add_face() do. These are exactly
+        // the faces build_from_indices() rejects before it pairs the halfedges.
+        const auto num_vertices = static_cast<unsigned int>(mesh_->vertices_size());
+        std::size_t num_invalid = 0;
+        std::vector<unsigned int> sorted;
+        for (std::size_t f = 0; f < num_faces; ++f) {
+            const unsigned int begin = face_offsets[f], end = face_offsets[f + 1], n = end - begin;
+            bool invalid = true;
+            if (n < 3)
+                ++num_faces_less_three_vertices_;
+            else {
+                bool consecutive = false, out_of_range = false;
+                for (unsigned int s = 0; s < n; ++s) {
+                    consecutive = consecutive || face_indices[begin + s] == face_indices[begin + (s + 1) % n];
+                    out_of_range = out_of_range || face_indices[begin + s] >= num_vertices;
+                }
+                sorted.assign(face_indices.begin() + begin, face_indices.begin() + end);
+                std::sort(sorted.begin(), sorted.end());
+                if (consecutive)
+                    ++num_faces_duplicate_vertices;
+                else if (out_of_range)
+                    ++num_faces_out_of_range_vertices_;
+                else if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+                    ++num_faces_unknown_topology_;
+                else
+                    invalid = false;
+            }
+            num_invalid += invalid;
+        }
+
+        std::size_t num_added = 0;
+        std::vector<Face> result;
+        std::vector<Vertex> copies;
+        if (mesh_->n_faces() == 0 &&
+            mesh_->build_connectivity(face_offsets, face_indices, num_invalid, &result, &copies, 0) == num_invalid) {
+            // the copies made for non-manifold vertices follow the input vertices
+            for (std::size_t i = 0; i < copies.size(); ++i)
+                record_copy(copies[i], Vertex(static_cast<int>(num_vertices + i)));
+            num_added = num_faces - num_invalid;
+        }
+        else {
+            // some faces are on non-manifold edges, which add_face() resolves by copying vertices
+            LOG(INFO) << "faces on non-manifold edges, adding the faces one by one";
+            num_faces_less_three_vertices_ = 0;
+            num_faces_duplicate_vertices = 0;
+            num_faces_out_of_range_vertices_ = 0;
+            num_faces_unknown_topology_ = 0;
+            result.resize(num_faces);
+            std::vector<Vertex> vertices;
+            for (std::size_t f = 0; f < num_faces; ++f) {
+                vertices.clear();
+                for (unsigned int c = face_offsets[f]; c < face_offsets[f + 1]; ++c)
+                    vertices.emplace_back(static_cast<int>(face_indices[c]));
+                result[f] = add_face(vertices);
+                num_added += result[f].is_valid();
+            }
+        }
+
+        if (faces)
+            faces->swap(result);
+        return num_added;
+    }
+
+
+    std::size_t SurfaceMeshBuilder::count_non_manifold_edges() const {
+        // Group the halfedges by their source vertex (a counting sort), then count the duplicate targets of each.
+        int num_vertices = 0;
+        for (auto s : halfedge_sources_)
+            num_vertices = std::max(num_vertices, s + 1);
+        std::vector<int> offsets(num_vertices + 1, 0);
+        for (auto s : halfedge_sources_)
+            ++offsets[s + 1];
+        for (int v = 0; v < num_vertices; ++v)
+            offsets[v + 1] += offsets[v];
+
+        std::vector<int> targets(halfedge_targets_.size());
+        std::vector<int> pos(offsets.begin(), offsets.end() - 1);
+        for (std::size_t i = 0; i < halfedge_sources_.size(); ++i)
+            targets[pos[halfedge_sources_[i]]++] = halfedge_targets_[i];
+
+        std::size_t count(0);
+        for (int v = 0; v < num_vertices; ++v) {
+            auto begin = targets.begin() + offsets[v], end = targets.begin() + offsets[v + 1];
+            std::sort(begin, end);
+            count += (end - std::unique(begin, end));
+        }
+        return count;
+    }
+
+
     SurfaceMesh::Face SurfaceMeshBuilder::add_triangle(Vertex v1, Vertex v2, Vertex v3) {
         return add_face({v1, v2, v3});
     }
@@ -363,13 +454,13 @@ namespace MV {
 
 
     SurfaceMesh::Vertex SurfaceMeshBuilder::get(Vertex v) {
-        auto pos = copied_vertices_.find(v);
-        if (pos == copied_vertices_.end()) { // no copies
+        int entry = copied_vertices_.first(v);
+        if (entry == -1) { // no copies
             if (mesh_->is_border(v))
                 return v;
         } else { // has copies
-            const auto &copies = pos->second;
-            for (auto c : copies) {
+            for (; entry != -1; entry = copied_vertices_.next(entry)) {
+                const Vertex c = copied_vertices_.copy(entry);
                 if (mesh_->is_border(c))
                     return c;
             }
@@ -380,25 +471,54 @@ namespace MV {
     }
 
 
+    void SurfaceMeshBuilder::CopyRecord::clear() {
+        std::vector<int>().swap(head_);
+        std::vector<int>().swap(tail_);
+        std::vector<Vertex>().swap(copies_);
+        std::vector<int>().swap(next_);
+        num_vertices_ = 0;
+    }
+
+
+    void SurfaceMeshBuilder::CopyRecord::add(Vertex v, Vertex copy) {
+        if (v.idx() >= static_cast<int>(head_.size())) {
+            // grow geometrically, the vertices are added one by one
+            const std::size_t size = std::max<std::size_t>(v.idx() + 1, head_.size() * 2);
+            head_.resize(size, -1);
+            tail_.resize(size, -1);
+        }
+
+        const int entry = static_cast<int>(copies_.size());
+        copies_.push_back(copy);
+        next_.push_back(-1);
+        if (head_[v.idx()] == -1) {
+            head_[v.idx()] = entry;
+            ++num_vertices_;
+        } else
+            next_[tail_[v.idx()]] = entry;
+        tail_[v.idx()] = entry;
+    }
+
+
     SurfaceMesh::Vertex SurfaceMeshBuilder::copy_vertex(Vertex v) {
         const vec3 p = mesh_->position(v); // [Liangliang]: 'const vec3&' won't work because the vector is growing.
         auto new_v = mesh_->add_vertex(p);
-        original_vertex_[new_v] = v;
-        copied_vertices_[v].push_back(new_v);
+        record_copy(v, new_v);
+        return new_v;
+    }
+
+
+    void SurfaceMeshBuilder::record_copy(Vertex v, Vertex copy) {
+        original_vertex_[copy] = v;
+        copied_vertices_.add(v, copy);
 
         // copy all vertex properties except "v:connectivity" and "v:deleted"
         auto &arrays = mesh_->m_vprops.arrays();
         for (auto &a : arrays) {
-            if (a->name() == "v:connectivity" || a->name() == "v:deleted" ||
-                a->name() == name_known_nm_vertex ||
-                a->name() == name_visited_vertex ||
-                a->name() == name_visited_halfedge||
-                a->name() == name_original_vertex)
+            if (a->name() == "v:connectivity" || a->name() == "v:deleted" || a->name() == name_original_vertex)
                 continue;
-            a->copy(v.idx(), new_v.idx());
+            a->copy(v.idx(), copy.idx());
         }
-
-        return new_v;
     }
 
 
@@ -411,25 +531,21 @@ namespace MV {
 
         auto null_h = Halfedge();
 
-        auto known_nm_vertex = mesh->add_vertex_property<bool>(name_known_nm_vertex, false);
-        auto visited_vertex = mesh->add_vertex_property<Halfedge>(name_visited_vertex, null_h);
-        auto visited_halfedge = mesh->add_halfedge_property<bool>(name_visited_halfedge, false);
-
-        // keep a record that the vertex copies are occurred in the 'resolve_non_manifold_vertices()' phase.
-        // NOTE: not possible to reuse 'copied_vertices_', because this phase requires a clean record but some vertices
-        //       might have already been copied in the previous phase (i.e., in add_face()).
-        CopyRecord copy_record;
+        // flat arrays indexed by the vertices/halfedges (instead of temporary properties)
+        std::vector<char> known_nm_vertex(mesh->vertices_size(), false);
+        std::vector<Halfedge> visited_vertex(mesh->vertices_size(), null_h);
+        std::vector<char> visited_halfedge(mesh->halfedges_size(), false);
 
         std::vector<Halfedge> non_manifold_cones;
         for (auto h : mesh->halfedges()) {
             // If 'h' is not visited yet, we walk around the target of 'h' and mark these
             // halfedges as visited. Thus, if we are here and the target is already marked as visited,
             // it means that the vertex is non-manifold.
-            if (!visited_halfedge[h]) {
-                visited_halfedge[h] = true;
+            if (!visited_halfedge[h.idx()]) {
+                visited_halfedge[h.idx()] = true;
                 bool is_non_manifold = false;
 
-                auto v = mesh->target(h);
+                auto v = mesh->target(h).idx();
                 if (visited_vertex[v] != null_h) // already seen this vertex, but not from this star
                 {
                     is_non_manifold = true;
@@ -449,7 +565,7 @@ namespace MV {
                 auto ih = h, done = ih;
                 int border_counter = 0;
                 do {
-                    visited_halfedge[ih] = true;
+                    visited_halfedge[ih.idx()] = true;
                     if (mesh->is_border(ih))
                         ++border_counter;
 
@@ -466,28 +582,23 @@ namespace MV {
             }
         }
 
-        // for each umbrella
-        for (auto h : non_manifold_cones)
-            resolve_non_manifold_vertex(h, mesh, copy_record);
-
-#if 0    // This is the history how vertices were duplicate.
-        for (const auto& copy : dmap) {
-            LOG(INFO) << "Non-manifold vertex " << copy.first << " was fixed by creating";
-            for (auto v : copy.second)
-                std::cout << " " << v;
-            std::cout << std::endl;
-        }
-#endif
+        // Release memory immediately when not needed any more.
+        std::vector<char>().swap(known_nm_vertex);
+        std::vector<Halfedge>().swap(visited_vertex);
+        std::vector<char>().swap(visited_halfedge);
 
-        mesh->remove_vertex_property(known_nm_vertex);
-        mesh->remove_vertex_property(visited_vertex);
-        mesh->remove_halfedge_property(visited_halfedge);
+        // For each umbrella. The stars of a vertex met first keep the vertex, all others are moved to copies.
+        // NOTE: not possible to reuse 'copied_vertices_', because this phase requires a clean record but some vertices
+        //       might have already been copied in the previous phase (i.e., in add_face()).
+        std::vector<char> met(mesh->vertices_size(), false);
+        for (auto h : non_manifold_cones)
+            resolve_non_manifold_vertex(h, mesh, met);
 
-        return copy_record.size();
+        return std::count(met.begin(), met.end(), true);
     }
 
 
-    std::size_t SurfaceMeshBuilder::resolve_non_manifold_vertex(Halfedge h, SurfaceMesh *mesh, CopyRecord &copy_record) {
+    std::size_t SurfaceMeshBuilder::resolve_non_manifold_vertex(Halfedge h, SurfaceMesh *mesh, std::vector<char> &met) {
         auto create_new_vertex_for_sector = [this](Halfedge sector_begin_h,
                                                    Halfedge sector_last_h,
                                                    SurfaceMesh *mesh) -> Vertex {
@@ -526,17 +637,16 @@ namespace MV {
 
         bool is_non_manifold_within_umbrella = (border_counter > 1);
         if (!is_non_manifold_within_umbrella) {
-            if (copy_record.find(old_v) == copy_record.end()) { // first time meeting the vertex
+            if (!met[old_v.idx()]) { // first time meeting the vertex
                 // The star is manifold, so if it is the first time we have met that vertex,
                 // there is nothing to do, we just keep the same vertex.
                 mesh->set_out_halfedge(old_v, h); // to ensure halfedge(old_v, pm) stays valid
-                copy_record[old_v]; // so that we know we have met old_v already, next time, we'll have to duplicate
+                met[old_v.idx()] = true; // so that we know we have met old_v already, next time, we'll have to duplicate
             } else {
                 // This is not the canonical star associated to 'v'.
                 // Create a new vertex, and move the whole star to that new vertex
                 auto last_h = mesh->opposite(mesh->next(h));
-                auto new_v = create_new_vertex_for_sector(h, last_h, mesh);
-                copy_record[old_v].push_back(new_v);
+                create_new_vertex_for_sector(h, last_h, mesh);
                 nb_new_vertices = 1;
             }
         }
@@ -568,14 +678,13 @@ namespace MV {
                 // there are multiple CCs incident to this particular vertex, and we should create a new vertex
                 // if it's not the first umbrella around 'old_v' or not the first sector, but only not if it's
                 // both the first umbrella and first sector.
-                bool must_create_new_vertex = (!is_main_sector || copy_record.find(old_v) != copy_record.end());
+                bool must_create_new_vertex = (!is_main_sector || met[old_v.idx()]);
 
                 // In any case, we must set up the next pointer correctly
                 mesh->set_next(sector_start_h, mesh->opposite(sector_last_h));
 
                 if (must_create_new_vertex) {
-                    auto new_v = create_new_vertex_for_sector(sector_start_h, sector_last_h, mesh);
-                    copy_record[old_v].push_back(new_v);
+                    create_new_vertex_for_sector(sector_start_h, sector_last_h, mesh);
                     ++nb_new_vertices;
                 } else {
                     // Ensure that halfedge(old_v, pm) stays valid
@@ -586,6 +695,7 @@ namespace MV {
                 sector_start_h = next_start_h;
                 should_stop = (sector_start_h == border_h);
             } while (!should_stop);
+            met[old_v.idx()] = true;
         }
 
         return nb_new_vertices;
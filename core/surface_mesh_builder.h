@@ -28,7 +28,7 @@
 #define EASY3D_CORE_SURFACE_MESH_BUILDER_H
 
 
-#include <unordered_map>
+#include <vector>
 #include "surface_mesh.h"
 
 
@@ -102,6 +102,24 @@ namespace MV {
          */
         Face add_quad(Vertex v1, Vertex v2, Vertex v3, Vertex v4);
 
+        /**
+         * @brief Add all the faces at once, instead of calling add_face() for each of them.
+         * @details This is much faster for large meshes. It must be called after all the vertices have been added
+         *      (and their properties, see add_face()) and before any other face. The faces are first built by
+         *      SurfaceMesh::build_from_indices(), which copies non-manifold vertices like end_surface() does but
+         *      rejects the faces on non-manifold edges. If it would reject a face that add_face() keeps, the faces
+         *      are added one by one with add_face() instead. Either way, the same faces are kept.
+         * @param face_offsets The vertices of face i are face_indices[face_offsets[i] .. face_offsets[i + 1]).
+         * @param face_indices The vertex indices of all faces.
+         * @param faces If not null, receives the face of each input face (an invalid face if it was ignored). As
+         *      with add_face(), the halfedge of a face points to the (actual) vertex of its first corner.
+         * @return The number of faces added.
+         * @related add_face().
+         */
+        std::size_t add_faces(const std::vector<unsigned int> &face_offsets,
+                              const std::vector<unsigned int> &face_indices,
+                              std::vector<Face> *faces = nullptr);
+
         /**
          * @brief Finalize surface construction. Must be called at the end of the surface construction and used in
          *        pair with begin_surface() at the beginning of surface mesh construction.
@@ -132,29 +150,67 @@ namespace MV {
         // Return the new vertex.
         Vertex copy_vertex(Vertex v);
 
+        // Copy the attributes of vertex v to 'copy' (an existing vertex) and record the copy.
+        void record_copy(Vertex v, Vertex copy);
+
+        // Vertices might be copied, for two reasons:
+        //  - resolve non-manifoldness. In two phases: during the construction of the mesh by call to 'add_face()' and
+        //    in 'resolve_non_manifold_vertices()'.
+        //  - ensure boundary consistency. All happen during the construction of the mesh by call to 'add_face()'.
+        //
+        // The copies of each vertex, in the order they were made. Usually only a small number of vertices will be
+        // copied, but noisy scans may have many. The lists of all vertices share one pool: the copies of vertex v are
+        // chained from first(v) through next(), so recording a copy never allocates a list of its own.
+        class CopyRecord {
+        public:
+            CopyRecord() : num_vertices_(0) {}
+
+            // Clear the record and release its memory.
+            void clear();
+            // Record that 'copy' was copied from 'v'.
+            void add(Vertex v, Vertex copy);
+
+            // The first copy of v in the pool, or -1 if v has not been copied.
+            int first(Vertex v) const { return v.idx() < static_cast<int>(head_.size()) ? head_[v.idx()] : -1; }
+            // The copy following 'entry' (of the same vertex), or -1.
+            int next(int entry) const { return next_[entry]; }
+            Vertex copy(int entry) const { return copies_[entry]; }
+
+            // The number of vertices that have been copied.
+            std::size_t num_vertices() const { return num_vertices_; }
+            // All the copies (of all vertices).
+            const std::vector<Vertex>& copies() const { return copies_; }
+
+        private:
+            // the first and the last copy of each vertex (indexed by vertex, -1 if not copied)
+            std::vector<int> head_;
+            std::vector<int> tail_;
+            // the pool: the copies and the next copy of the same vertex
+            std::vector<Vertex> copies_;
+            std::vector<int> next_;
+            std::size_t num_vertices_;
+        };
+
         // A vertex might have been copied a few times. If copies occurred before, the original vertex will never work.
         // To avoid unnecessary duplication, we reuse one of its copy that is not on a closed disk. We test each copy in
         // the order the copies were made. If no valid copy can be found, we make a new copy.
         // If no copy exists and v is on a closed disk, we simply copy it.
         Vertex get(Vertex v);
 
-        // Resolve all non-manifold vertices of a mesh.
+        // Resolve all non-manifold vertices of a mesh. All the non-manifold stars are collected in a single pass over
+        // the halfedges and then split.
         // Return the number of non-manifold vertices.
         std::size_t resolve_non_manifold_vertices(SurfaceMesh *mesh);
 
-        // Vertices might be copied, for two reasons:
-        //  - resolve non-manifoldness. In two phases: during the construction of the mesh by call to 'add_face()' and
-        //    in 'resolve_non_manifold_vertices()'.
-        //  - ensure boundary consistency. All happen during the construction of the mesh by call to 'add_face()'.
-        //
-        // The copied vertices: vertices in 'second' were copied from 'first'.
-        // Usually only a small number of vertices will be copied, so no need to use vertex property.
-        typedef std::unordered_map<Vertex, std::vector<Vertex>, Vertex::Hash> CopyRecord;
-
         // Resolve the non-manifoldness of a vertex that is denoted by an incoming halfedge.
         // @param h The halfedge pointing to the non-manifold vertex.
+        // @param met The vertices whose first star has been met (indexed by vertex). Any other star of such a vertex
+        //        is moved to a new copy.
         // Return the number of vertex copies.
-        std::size_t resolve_non_manifold_vertex(Halfedge h, SurfaceMesh *mesh, CopyRecord &copy_record);
+        std::size_t resolve_non_manifold_vertex(Halfedge h, SurfaceMesh *mesh, std::vector<char> &met);
+
+        // The number of directed edges (of the original vertices) shared by more than one face.
+        std::size_t count_non_manifold_edges() const;
 
     private:
         SurfaceMesh *mesh_;
@@ -182,11 +238,10 @@ namespace MV {
         // A vertex property to record the original vertex of each vertex.
         SurfaceMesh::VertexProperty <Vertex> original_vertex_;
 
-        // The record of all halfedges (each associated with a valid face) originating from a vertex.
-        // This is used for fast query of duplicate edges. All vertices are their original indices.
-        //  - first: the index of a vertex
-        //  - second: the indices of the target vertices
-        std::unordered_map<int, std::vector<int> > outgoing_halfedges_;
+        // The record of all halfedges (each associated with a valid face), in the order they were added. This is used
+        // for counting duplicate edges. All vertices are their original indices.
+        std::vector<int> halfedge_sources_;
+        std::vector<int> halfedge_targets_;
     };
 
 }
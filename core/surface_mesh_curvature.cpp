@@ -0,0 +1,229 @@
+#include "surface_mesh_curvature.h"
+#include "property_keys.h"
+#include "../util/parallel.h"
+
+#include <limits>
+#include <cmath>
+#include <algorithm>
+
+
+namespace MV {
+
+    namespace geom {
+
+        namespace details {
+
+            // Clamps the values to the range between their fraction and (1 - fraction) quantiles (the same indices
+            // as the clamping of scalar fields for rendering).
+            void clamp_to_quantiles(std::vector<double> &values, const std::vector<char> &used, float fraction,
+                                    unsigned int num_threads) {
+                std::vector<double> sorted;
+                sorted.reserve(values.size());
+                for (std::size_t i = 0; i < values.size(); ++i) {
+                    if (used[i])
+                        sorted.push_back(values[i]);
+                }
+                if (sorted.empty())
+                    return;
+
+                const std::size_t n = sorted.size() - 1;
+                const std::size_t index_lower = static_cast<std::size_t>(n * fraction);
+                const std::size_t index_upper = n - static_cast<std::size_t>(n * fraction);
+                std::nth_element(sorted.begin(), sorted.begin() + index_lower, sorted.end());
+                const double lower = sorted[index_lower];
+                std::nth_element(sorted.begin(), sorted.begin() + index_upper, sorted.end());
+                const double upper = sorted[index_upper];
+                if (lower >= upper)
+                    return;
+
+                parallel_for(0, values.size(), [&](std::size_t i) {
+                    values[i] = std::min(std::max(values[i], lower), upper);
+                }, num_threads);
+            }
+
+        }
+
+
+        void vertex_curvatures(SurfaceMesh *mesh, unsigned int smoothing_steps, float clamp_fraction,
+                               unsigned int num_threads) {
+            auto kmean = mesh->vertex_property<float>(keys::v_curv_mean.name());
+            auto kgauss = mesh->vertex_property<float>(keys::v_curv_gauss.name());
+            auto kmin = mesh->vertex_property<float>(keys::v_curv_min.name());
+            auto kmax = mesh->vertex_property<float>(keys::v_curv_max.name());
+
+            const SurfaceMesh *cmesh = mesh;
+            const SurfaceMesh::ReadScope scope(*cmesh);
+            const std::vector<vec3> &points = cmesh->points();
+            const std::size_t num_vertices = cmesh->vertices_size();
+
+            // Per halfedge h (inside a face):
+            //  - cot: the cotangent of the angle opposite to h (see cotan_weight()),
+            //  - area: what the corner at the source of h contributes to its Voronoi area (see voronoi_area()),
+            //  - angle: the angle of the corner at the source of h (see angle_sum()).
+            std::vector<double> cot(cmesh->halfedges_size(), 0.0);
+            std::vector<double> area(cmesh->halfedges_size(), 0.0);
+            std::vector<double> angle(cmesh->halfedges_size(), 0.0);
+            parallel_for(0, cmesh->faces_size(), [&](std::size_t i) {
+                const SurfaceMesh::Face f(static_cast<int>(i));
+                if (cmesh->is_deleted(f))
+                    return;
+
+                // A triangle: its area and the dot products at its corners serve all three halfedges. The corner
+                // k is at the source of hs[k], and e[k] goes from corner k to corner k + 1.
+                SurfaceMesh::Halfedge hs[3];
+                hs[0] = cmesh->halfedge(f);
+                hs[1] = cmesh->next(hs[0]);
+                hs[2] = cmesh->next(hs[1]);
+                if (cmesh->next(hs[2]) == hs[0]) {
+                    dvec3 c[3], e[3];
+                    for (int k = 0; k < 3; ++k)
+                        c[k] = dvec3(points[cmesh->source(hs[k]).idx()]);
+                    for (int k = 0; k < 3; ++k)
+                        e[k] = c[(k + 1) % 3] - c[k];
+                    const double tri_area = norm(cross(e[0], e[1]));
+                    if (tri_area > std::numeric_limits<double>::min()) {
+                        double len2[3], dots[3];
+                        for (int k = 0; k < 3; ++k) {
+                            len2[k] = length2(e[k]);
+                            dots[k] = -dot(e[k], e[(k + 2) % 3]);
+                        }
+                        for (int k = 0; k < 3; ++k) {
+                            const int h = hs[k].idx();
+                            const int k1 = (k + 1) % 3, k2 = (k + 2) % 3;
+                            cot[h] = clamp_cot(dots[k2] / tri_area);
+                            if (dots[k] < 0.0)
+                                area[h] = 0.25 * tri_area;
+                            else if (dots[k1] < 0.0 || dots[k2] < 0.0)
+                                area[h] = 0.125 * tri_area;
+                            else
+                                area[h] = 0.125 * (len2[k2] * clamp_cot(dots[k1] / tri_area) +
+                                                   len2[k] * clamp_cot(dots[k2] / tri_area));
+                            angle[h] = std::acos(clamp_cos(dots[k] / std::sqrt(len2[k] * len2[k2])));
+                        }
+                        return;
+                    }
+                }
+
+                // other faces (and degenerate triangles) are handled like the per-vertex functions do
+                for (auto h : cmesh->halfedges(f)) {
+                    const SurfaceMesh::Halfedge h1 = cmesh->next(h);
+                    const SurfaceMesh::Halfedge h2 = cmesh->next(h1);
+                    const dvec3 p(points[cmesh->target(h2).idx()]);
+                    const dvec3 q(points[cmesh->target(h).idx()]);
+                    const dvec3 r(points[cmesh->target(h1).idx()]);
+
+                    // the angle opposite to h is at r (p is the source of h in a triangle)
+                    const dvec3 d0 = q - r;
+                    const dvec3 d1 = dvec3(points[cmesh->source(h).idx()]) - r;
+                    const double a = norm(cross(d0, d1));
+                    if (a > std::numeric_limits<double>::min())
+                        cot[h.idx()] = clamp_cot(dot(d0, d1) / a);
+
+                    const dvec3 pq = q - p, qr = r - q, pr = r - p;
+                    const double tri_area = norm(cross(pq, pr));
+                    if (tri_area > std::numeric_limits<double>::min()) {
+                        const double dotp = dot(pq, pr);
+                        const double dotq = -dot(qr, pq);
+                        const double dotr = dot(qr, pr);
+                        if (dotp < 0.0)     // angle at p is obtuse
+                            area[h.idx()] = 0.25 * tri_area;
+                        else if (dotq < 0.0 || dotr < 0.0)  // angle at q or r obtuse
+                            area[h.idx()] = 0.125 * tri_area;
+                        else
+                            area[h.idx()] = 0.125 * (length2(pr) * clamp_cot(dotq / tri_area) +
+                                                     length2(pq) * clamp_cot(dotr / tri_area));
+                    }
+
+                    const dvec3 s(points[cmesh->source(h).idx()]);
+                    const dvec3 e0 = normalize(q - s);
+                    const dvec3 e1 = normalize(dvec3(points[cmesh->source(cmesh->prev(h)).idx()]) - s);
+                    angle[h.idx()] = std::acos(clamp_cos(dot(e0, e1)));
+                }
+            }, num_threads);
+
+            // the mean and Gaussian curvatures
+            std::vector<double> mean(num_vertices, 0.0), gauss(num_vertices, 0.0);
+            std::vector<char> used(num_vertices, 0);
+            parallel_for(0, num_vertices, [&](std::size_t i) {
+                const SurfaceMesh::Vertex v(static_cast<int>(i));
+                if (cmesh->is_deleted(v))
+                    return;
+                used[i] = 1;
+                if (cmesh->is_isolated(v))
+                    return;
+
+                const dvec3 p(points[i]);
+                double voronoi(0.0), angles(0.0);
+                dvec3 laplace(0.0, 0.0, 0.0);
+                for (auto h : cmesh->halfedges(v)) {
+                    voronoi += area[h.idx()];
+                    angles += angle[h.idx()];
+                    const double w = cot[h.idx()] + cot[cmesh->opposite(h).idx()];
+                    laplace += w * (dvec3(points[cmesh->target(h).idx()]) - p);
+                }
+                if (voronoi > std::numeric_limits<double>::min()) {
+                    mean[i] = 0.5 * norm(laplace) / (2.0 * voronoi);
+                    // angle_sum() is 0 for boundary vertices
+                    gauss[i] = (2.0 * M_PI - (cmesh->is_border(v) ? 0.0 : angles)) / voronoi;
+                }
+            }, num_threads);
+
+            // Jacobi smoothing, so the result does not depend on the number of threads
+            if (smoothing_steps > 0) {
+                std::vector<double> mean_next(num_vertices), gauss_next(num_vertices);
+                for (unsigned int step = 0; step < smoothing_steps; ++step) {
+                    parallel_for(0, num_vertices, [&](std::size_t i) {
+                        const SurfaceMesh::Vertex v(static_cast<int>(i));
+                        mean_next[i] = mean[i];
+                        gauss_next[i] = gauss[i];
+                        if (!used[i] || cmesh->is_isolated(v) || cmesh->is_border(v))
+                            return;
+                        double sum_weights(0.0), sum_mean(0.0), sum_gauss(0.0);
+                        for (auto h : cmesh->halfedges(v)) {
+                            const double w = std::max(0.0, cot[h.idx()] + cot[cmesh->opposite(h).idx()]);
+                            const int j = cmesh->target(h).idx();
+                            sum_weights += w;
+                            sum_mean += w * mean[j];
+                            sum_gauss += w * gauss[j];
+                        }
+                        if (sum_weights > 0.0) {
+                            mean_next[i] = sum_mean / sum_weights;
+                            gauss_next[i] = sum_gauss / sum_weights;
+                        }
+                    }, num_threads);
+                    mean.swap(mean_next);
+                    gauss.swap(gauss_next);
+                }
+            }
+
+            // the principal curvatures
+            std::vector<double> minimum(num_vertices), maximum(num_vertices);
+            parallel_for(0, num_vertices, [&](std::size_t i) {
+                const double s = std::sqrt(std::max(0.0, mean[i] * mean[i] - gauss[i]));
+                minimum[i] = mean[i] - s;
+                maximum[i] = mean[i] + s;
+            }, num_threads);
+
+            if (clamp_fraction > 0.0f) {
+                details::clamp_to_quantiles(mean, used, clamp_fraction, num_threads);
+                details::clamp_to_quantiles(gauss, used, clamp_fraction, num_threads);
+                details::clamp_to_quantiles(minimum, used, clamp_fraction, num_threads);
+                details::clamp_to_quantiles(maximum, used, clamp_fraction, num_threads);
+            }
+
+            // the properties may still share their data with a copy of the mesh, see PropertyArray
+            std::vector<float> &mean_values = kmean.vector();
+            std::vector<float> &gauss_values = kgauss.vector();
+            std::vector<float> &min_values = kmin.vector();
+            std::vector<float> &max_values = kmax.vector();
+            parallel_for(0, num_vertices, [&](std::size_t i) {
+                mean_values[i] = static_cast<float>(mean[i]);
+                gauss_values[i] = static_cast<float>(gauss[i]);
+                min_values[i] = static_cast<float>(minimum[i]);
+                max_values[i] = static_cast<float>(maximum[i]);
+            }, num_threads);
+        }
+
+    }
+
+}   // namespace MV
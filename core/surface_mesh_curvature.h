@@ -0,0 +1,37 @@
+#ifndef EASY3D_CORE_SURFACE_MESH_CURVATURE_H
+#define EASY3D_CORE_SURFACE_MESH_CURVATURE_H
+
+#include "surface_mesh.h"
+
+
+namespace MV {
+
+    namespace geom {
+
+        /**
+         * \brief Computes the curvatures of all the vertices of a mesh at once.
+         * \details The mean, Gaussian, minimum, and maximum curvatures are those of vertex_curvature(), and they
+         *      are stored in the float vertex properties "v:curv-mean", "v:curv-gauss", "v:curv-min", and
+         *      "v:curv-max" (see keys::v_curv_mean etc.), ready to be rendered as scalar fields. Calling
+         *      vertex_curvature() for each vertex computes every cotangent and every Voronoi area several times.
+         *      Here, the cotangent, the Voronoi area contribution, and the angle of each corner are computed once
+         *      (in double precision) in a pass over the faces, and the vertices then only sum them up. Both passes
+         *      run in parallel.
+         * \param smoothing_steps The number of smoothing steps applied to the mean and Gaussian curvatures, which
+         *      the minimum and maximum curvatures are derived from. A step replaces the value of each interior
+         *      vertex by the average of its neighbors, weighted by the (non-negative) cotangent weights.
+         * \param clamp_fraction If positive, each curvature is clamped to the range between its \p clamp_fraction
+         *      and (1 - \p clamp_fraction) quantiles, which removes the spikes at degenerate and boundary vertices.
+         * \param num_threads The number of threads (0 means default_thread_count()).
+         * \attention As with vertex_curvature(), the values of boundary vertices are not reliable.
+         * \pre The mesh is a triangle mesh.
+         */
+        void vertex_curvatures(SurfaceMesh *mesh, unsigned int smoothing_steps = 0, float clamp_fraction = 0.0f,
+                               unsigned int num_threads = 0);
+
+    }
+
+}   // namespace MV
+
+
+#endif  // EASY3D_CORE_SURFACE_MESH_CURVATURE_H
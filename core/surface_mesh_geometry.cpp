@@ -1,7 +1,10 @@
 #include "surface_mesh_geometry.h"
 
+#include "../util/parallel.h"
+
 #include <limits>
 #include <cmath>
+#include <array>
 
 
 namespace MV
@@ -9,6 +12,65 @@ namespace MV
     namespace geom 
     {
 
+        namespace details {
+
+            // Sums N terms per item over the items [0, n) in double precision. The items are split into blocks of a
+            // fixed size, each block is summed with compensated (Neumaier) summation, and the block sums are added
+            // pairwise. As the blocks do not depend on the number of threads, neither does the result.
+            // term(i, t) writes the terms of item i into t, or returns false if the item does not count.
+            template <std::size_t N, typename Term>
+            std::array<double, N> stable_sum(std::size_t n, const Term& term, unsigned int num_threads) {
+                const std::size_t block_size = 4096;
+                const std::size_t num_blocks = (n + block_size - 1) / block_size;
+                std::vector<std::array<double, N> > sums(num_blocks);
+                parallel_for(0, num_blocks, [&](std::size_t b) {
+                    std::array<double, N> sum, comp, t;
+                    sum.fill(0.0);
+                    comp.fill(0.0);
+                    const std::size_t end = std::min(n, (b + 1) * block_size);
+                    for (std::size_t i = b * block_size; i < end; ++i) {
+                        if (!term(i, t))
+                            continue;
+                        for (std::size_t k = 0; k < N; ++k) {
+                            const double s = sum[k] + t[k];
+                            comp[k] += (std::abs(sum[k]) >= std::abs(t[k])) ? (sum[k] - s) + t[k] : (t[k] - s) + sum[k];
+                            sum[k] = s;
+                        }
+                    }
+                    for (std::size_t k = 0; k < N; ++k)
+                        sums[b][k] = sum[k] + comp[k];
+                }, num_threads, 1);
+
+                for (std::size_t width = 1; width < num_blocks; width *= 2) {
+                    for (std::size_t b = 0; b + width < num_blocks; b += 2 * width) {
+                        for (std::size_t k = 0; k < N; ++k)
+                            sums[b][k] += sums[b + width][k];
+                    }
+                }
+
+                std::array<double, N> result;
+                result.fill(0.0);
+                return num_blocks > 0 ? sums[0] : result;
+            }
+
+            // Calls func(p0, p1, p2) for each triangle of the fan triangulation of face f.
+            template <typename Func>
+            void for_each_triangle(const SurfaceMesh *mesh, SurfaceMesh::Face f, const Func& func) {
+                auto h = mesh->halfedge(f);
+                const dvec3 p0(mesh->position(mesh->source(h)));
+                h = mesh->next(h);
+                dvec3 p1(mesh->position(mesh->source(h)));
+                for (h = mesh->next(h); h != mesh->halfedge(f); h = mesh->next(h)) {
+                    const dvec3 p2(mesh->position(mesh->source(h)));
+                    func(p0, p1, p2);
+                    p1 = p2;
+                }
+            }
+
+        }
+
+        //-----------------------------------------------------------------------------
+
         float triangle_area(const SurfaceMesh *mesh, SurfaceMesh::Face f)
         {
             assert(mesh->valence(f) == 3);
@@ -23,13 +85,19 @@ namespace MV
 
         //-----------------------------------------------------------------------------
 
-        float surface_area(const SurfaceMesh *mesh)
+        float surface_area(const SurfaceMesh *mesh, unsigned int num_threads)
         {
-            float area(0);
-            for (auto f : mesh->faces()) {
-                area += triangle_area(mesh, f);
-            }
-            return area;
+            const auto sum = details::stable_sum<1>(mesh->faces_size(), [&](std::size_t i, std::array<double, 1>& t) {
+                const SurfaceMesh::Face f(static_cast<int>(i));
+                if (mesh->is_deleted(f))
+                    return false;
+                t[0] = 0.0;
+                details::for_each_triangle(mesh, f, [&](const dvec3& p0, const dvec3& p1, const dvec3& p2) {
+                    t[0] += 0.5 * norm(cross(p1 - p0, p2 - p0));
+                });
+                return true;
+            }, num_threads);
+            return static_cast<float>(sum[0]);
         }
 
         float face_area(const SurfaceMesh& mesh, SurfaceMesh::Face f)
@@ -46,24 +114,19 @@ namespace MV
 
         //-----------------------------------------------------------------------------
 
-        float volume(const SurfaceMesh& mesh)
+        float volume(const SurfaceMesh *mesh, unsigned int num_threads)
         {
-            if (!mesh.is_triangle_mesh()) {
-                LOG(ERROR) << "input is not a pure triangle mesh!";
-                return 0;
-            }
-
-            float volume(0);
-            for (const auto f : mesh.faces()) {
-                auto fv = mesh.vertices(f);
-                const auto& p0 = mesh.position(*fv);
-                const auto& p1 = mesh.position(*(++fv));
-                const auto& p2 = mesh.position(*(++fv));
-
-                volume += float(1.0) / float(6.0) * dot(cross(p0, p1), p2);
-            }
-
-            return std::abs(volume);
+            const auto sum = details::stable_sum<1>(mesh->faces_size(), [&](std::size_t i, std::array<double, 1>& t) {
+                const SurfaceMesh::Face f(static_cast<int>(i));
+                if (mesh->is_deleted(f))
+                    return false;
+                t[0] = 0.0;
+                details::for_each_triangle(mesh, f, [&](const dvec3& p0, const dvec3& p1, const dvec3& p2) {
+                    t[0] += dot(cross(p0, p1), p2);
+                });
+                return true;
+            }, num_threads);
+            return static_cast<float>(std::abs(sum[0]) / 6.0);
         }
 
         //-----------------------------------------------------------------------------
@@ -81,17 +144,129 @@ namespace MV
 
         //-----------------------------------------------------------------------------
 
-        vec3 centroid(const SurfaceMesh *mesh) {
-            vec3 center(0, 0, 0), c;
-            float area(0), a;
-            for (auto f : mesh->faces()) {
-                a = triangle_area(mesh, f);
-                c = centroid(mesh, f);
-                area += a;
-                center += a * c;
+        vec3 centroid(const SurfaceMesh *mesh, unsigned int num_threads) {
+            const auto sum = details::stable_sum<4>(mesh->faces_size(), [&](std::size_t i, std::array<double, 4>& t) {
+                const SurfaceMesh::Face f(static_cast<int>(i));
+                if (mesh->is_deleted(f))
+                    return false;
+                t.fill(0.0);
+                details::for_each_triangle(mesh, f, [&](const dvec3& p0, const dvec3& p1, const dvec3& p2) {
+                    const double a = 0.5 * norm(cross(p1 - p0, p2 - p0));
+                    const dvec3 c = (p0 + p1 + p2) / 3.0;
+                    t[0] += a;
+                    t[1] += a * c.x;
+                    t[2] += a * c.y;
+                    t[3] += a * c.z;
+                });
+                return true;
+            }, num_threads);
+            return sum[0] > 0.0 ? vec3(dvec3(sum[1], sum[2], sum[3]) / sum[0]) : vec3(0, 0, 0);
+        }
+
+        //-----------------------------------------------------------------------------
+
+        MeshIntegrals integrals(const SurfaceMesh *mesh, unsigned int num_threads) {
+            // 0: area, 1-3: area-weighted centroids, 4: six times the volume, 5-7: first moments of the volume,
+            // 8-13: second moments (xx, yy, zz, xy, yz, zx) of the volume
+            const auto sum = details::stable_sum<14>(mesh->faces_size(), [&](std::size_t i, std::array<double, 14>& t) {
+                const SurfaceMesh::Face f(static_cast<int>(i));
+                if (mesh->is_deleted(f))
+                    return false;
+                t.fill(0.0);
+                details::for_each_triangle(mesh, f, [&](const dvec3& p0, const dvec3& p1, const dvec3& p2) {
+                    const double a = 0.5 * norm(cross(p1 - p0, p2 - p0));
+                    const dvec3 c = (p0 + p1 + p2) / 3.0;
+                    t[0] += a;
+                    t[1] += a * c.x;
+                    t[2] += a * c.y;
+                    t[3] += a * c.z;
+
+                    // the tetrahedron (origin, p0, p1, p2): with v = d / 6 its signed volume and s = p0 + p1 + p2,
+                    // the integral of x_i over it is v * s_i / 4, and that of x_i * x_j is
+                    // v / 20 * (p0_i * p0_j + p1_i * p1_j + p2_i * p2_j + s_i * s_j).
+                    const double d = dot(p0, cross(p1, p2));
+                    const dvec3 s = p0 + p1 + p2;
+                    t[4] += d;
+                    t[5] += d * s.x;
+                    t[6] += d * s.y;
+                    t[7] += d * s.z;
+                    t[8] += d * (p0.x * p0.x + p1.x * p1.x + p2.x * p2.x + s.x * s.x);
+                    t[9] += d * (p0.y * p0.y + p1.y * p1.y + p2.y * p2.y + s.y * s.y);
+                    t[10] += d * (p0.z * p0.z + p1.z * p1.z + p2.z * p2.z + s.z * s.z);
+                    t[11] += d * (p0.x * p0.y + p1.x * p1.y + p2.x * p2.y + s.x * s.y);
+                    t[12] += d * (p0.y * p0.z + p1.y * p1.z + p2.y * p2.z + s.y * s.z);
+                    t[13] += d * (p0.z * p0.x + p1.z * p1.x + p2.z * p2.x + s.z * s.x);
+                });
+                return true;
+            }, num_threads);
+
+            MeshIntegrals result;
+            result.area = sum[0];
+            if (sum[0] > 0.0)
+                result.centroid = dvec3(sum[1], sum[2], sum[3]) / sum[0];
+
+            // faces oriented inwards give negative integrals
+            const double sign = sum[4] < 0.0 ? -1.0 : 1.0;
+            result.volume = sign * sum[4] / 6.0;
+            if (result.volume > 0.0) {
+                const dvec3 first = sign * dvec3(sum[5], sum[6], sum[7]) / 24.0;
+                const dvec3 cm = first / result.volume;
+                result.center_of_mass = cm;
+
+                // the second moments about the center of mass
+                const double xx = sign * sum[8] / 120.0 - result.volume * cm.x * cm.x;
+                const double yy = sign * sum[9] / 120.0 - result.volume * cm.y * cm.y;
+                const double zz = sign * sum[10] / 120.0 - result.volume * cm.z * cm.z;
+                const double xy = sign * sum[11] / 120.0 - result.volume * cm.x * cm.y;
+                const double yz = sign * sum[12] / 120.0 - result.volume * cm.y * cm.z;
+                const double zx = sign * sum[13] / 120.0 - result.volume * cm.z * cm.x;
+                result.inertia = dmat3(yy + zz, -xy, -zx,
+                                       -xy, xx + zz, -yz,
+                                       -zx, -yz, xx + yy);
             }
-            center /= area;
-            return center;
+            return result;
+        }
+
+        //-----------------------------------------------------------------------------
+
+        float surface_area(const CompactTriMesh& mesh)
+        {
+            const auto& points = mesh.points();
+            const auto& indices = mesh.indices();
+            const auto sum = details::stable_sum<1>(mesh.n_triangles(), [&](std::size_t t, std::array<double, 1>& a) {
+                const dvec3 p0(points[indices[3 * t]]), p1(points[indices[3 * t + 1]]), p2(points[indices[3 * t + 2]]);
+                a[0] = 0.5 * norm(cross(p1 - p0, p2 - p0));
+                return true;
+            }, 0);
+            return static_cast<float>(sum[0]);
+        }
+
+        float volume(const CompactTriMesh& mesh)
+        {
+            const auto& points = mesh.points();
+            const auto& indices = mesh.indices();
+            const auto sum = details::stable_sum<1>(mesh.n_triangles(), [&](std::size_t t, std::array<double, 1>& v) {
+                const dvec3 p0(points[indices[3 * t]]), p1(points[indices[3 * t + 1]]), p2(points[indices[3 * t + 2]]);
+                v[0] = dot(cross(p0, p1), p2);
+                return true;
+            }, 0);
+            return static_cast<float>(std::abs(sum[0]) / 6.0);
+        }
+
+        vec3 centroid(const CompactTriMesh& mesh)
+        {
+            const auto& points = mesh.points();
+            const auto& indices = mesh.indices();
+            const auto sum = details::stable_sum<4>(mesh.n_triangles(), [&](std::size_t t, std::array<double, 4>& c) {
+                const dvec3 p0(points[indices[3 * t]]), p1(points[indices[3 * t + 1]]), p2(points[indices[3 * t + 2]]);
+                const double a = 0.5 * norm(cross(p1 - p0, p2 - p0));
+                c[0] = a;
+                c[1] = a * (p0.x + p1.x + p2.x) / 3.0;
+                c[2] = a * (p0.y + p1.y + p2.y) / 3.0;
+                c[3] = a * (p0.z + p1.z + p2.z) / 3.0;
+                return true;
+            }, 0);
+            return sum[0] > 0.0 ? vec3(dvec3(sum[1], sum[2], sum[3]) / sum[0]) : vec3(0, 0, 0);
         }
 
         //-----------------------------------------------------------------------------
@@ -3,6 +3,7 @@
 
 #include "types.h"
 #include "surface_mesh.h"
+#include "compact_tri_mesh.h"
 
 namespace MV 
 {
@@ -13,22 +14,45 @@ namespace MV
         3*/
         float triangle_area(const SurfaceMesh *mesh, SurfaceMesh::Face f);
 
-        /** \brief surface area of the mesh (assumes triangular faces)    */
-        float surface_area(const SurfaceMesh *mesh);
+        /** \brief surface area of the mesh (polygons are triangulated as fans)    */
+        /** \note The integrals of the mesh (surface_area(), volume(), centroid(), and integrals()) are summed in
+         *      double precision, in parallel, and in an order that does not depend on the number of threads, so
+         *      they give the same result on every run.    */
+        float surface_area(const SurfaceMesh *mesh, unsigned int num_threads = 0);
 
         float face_area(const SurfaceMesh& mesh, SurfaceMesh::Face f);
 
         //! \brief Compute the volume of a mesh
-        //! \details See \cite zhang_2002_efficient for details.
-        //! \pre Input mesh needs to be a pure triangle mesh.
-        float volume(const SurfaceMesh *mesh);
+        //! \details See \cite zhang_2002_efficient for details. Polygons are triangulated as fans.
+        //! \pre Input mesh needs to be closed.
+        float volume(const SurfaceMesh *mesh, unsigned int num_threads = 0);
 
         /** \brief barycenter/centroid of a face    */
         vec3 centroid(const SurfaceMesh *mesh, SurfaceMesh::Face f);
 
         /** \brief barycenter/centroid of mesh, computed as area-weighted mean of vertices.    */
-        /** \note assumes triangular faces.    */
-        vec3 centroid(const SurfaceMesh *mesh);
+        /** \note polygons are triangulated as fans.    */
+        vec3 centroid(const SurfaceMesh *mesh, unsigned int num_threads = 0);
+
+        /** \brief The integrals of a mesh and of the solid it encloses, see integrals().    */
+        struct MeshIntegrals {
+            MeshIntegrals() : area(0.0), volume(0.0), centroid(0, 0, 0), center_of_mass(0, 0, 0), inertia(0.0) {}
+
+            double area;            ///< the surface area
+            double volume;          ///< the enclosed volume
+            dvec3 centroid;         ///< the area-weighted centroid of the surface (see centroid())
+            dvec3 center_of_mass;   ///< the centroid of the enclosed solid
+            dmat3 inertia;          ///< the inertia tensor of the solid (of unit density) about its center of mass
+        };
+
+        /**
+         * \brief Computes the area, the volume, the centroids, and the inertia tensor of a mesh in one pass.
+         * \details The solid is the sum of the signed tetrahedra joining the origin to the faces (polygons are
+         *      triangulated as fans), and its integrals are made positive if the faces are oriented inwards.
+         * \param num_threads The number of threads (0 means default_thread_count()). It does not change the result.
+         * \pre The solid integrals are only meaningful if the mesh is closed.
+         */
+        MeshIntegrals integrals(const SurfaceMesh *mesh, unsigned int num_threads = 0);
 
         //! \brief Compute dual of a mesh.
         //! \warning Changes the mesh in place. All properties are cleared.
@@ -59,6 +83,15 @@ namespace MV
             float min;
         };
 
+        /** \brief surface area of a compact triangle mesh    */
+        float surface_area(const CompactTriMesh& mesh);
+
+        /** \brief volume enclosed by a compact triangle mesh (it must be closed)    */
+        float volume(const CompactTriMesh& mesh);
+
+        /** \brief barycenter/centroid of a compact triangle mesh, computed as area-weighted mean of triangle centers */
+        vec3 centroid(const CompactTriMesh& mesh);
+
         /** \brief compute min, max, mean, and Gaussian curvature for vertex v. */
         /** \attention This will not give reliable values for boundary vertices.    */
         VertexCurvature vertex_curvature(const SurfaceMesh *mesh, SurfaceMesh::Vertex v);
@@ -0,0 +1,260 @@
+#include "mesh_stream_reader.h"
+#include "ply_reader_writer.h"
+#include "../util/file_system.h"
+#include "../util/logging.h"
+
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+
+#include "../3dparty/rply/rply.h"
+
+
+namespace MV {
+
+    namespace io {
+
+        namespace internal {
+
+            // what the rply callbacks need
+            struct PlyStream {
+                const MeshStreamReader::VertexCallback *on_vertex;
+                const MeshStreamReader::FaceCallback *on_face;
+                dvec3 point;
+                long last_coordinate;   // the vertex is complete when this coordinate is read
+                long num_vertices;
+                std::vector<int> face;
+                bool stopped;
+            };
+
+            // a callback asking to stop is not an error
+            void ply_stream_error(p_ply ply, const char *message) {
+                void *data = nullptr;
+                ply_get_ply_user_data(ply, &data, nullptr);
+                if (!static_cast<const PlyStream *>(data)->stopped)
+                    LOG(ERROR) << message;
+            }
+
+            int ply_stream_coordinate(p_ply_argument argument) {
+                void *data = nullptr;
+                long coordinate = 0;
+                ply_get_argument_user_data(argument, &data, &coordinate);
+                auto stream = static_cast<PlyStream *>(data);
+                stream->point[coordinate] = ply_get_argument_value(argument);
+                if (coordinate != stream->last_coordinate)
+                    return 1;
+
+                long index = 0;
+                ply_get_argument_element(argument, nullptr, &index);
+                // without a face callback, there is nothing to read after the last vertex
+                if (!(*stream->on_vertex)(stream->point) || (!*stream->on_face && index + 1 == stream->num_vertices)) {
+                    stream->stopped = true;
+                    return 0;
+                }
+                return 1;
+            }
+
+            int ply_stream_face(p_ply_argument argument) {
+                void *data = nullptr;
+                ply_get_argument_user_data(argument, &data, nullptr);
+                auto stream = static_cast<PlyStream *>(data);
+
+                long length = 0, value_index = 0;
+                ply_get_argument_property(argument, nullptr, &length, &value_index);
+                if (value_index < 0) {  // the length of the list
+                    stream->face.clear();
+                    return 1;
+                }
+                stream->face.push_back(static_cast<int>(ply_get_argument_value(argument)));
+                if (value_index + 1 == length && !(*stream->on_face)(stream->face.data(), stream->face.size())) {
+                    stream->stopped = true;
+                    return 0;
+                }
+                return 1;
+            }
+
+            // parses the index of an OBJ face vertex ("i", "i/t", "i//n", or "i/t/n"), and moves s past it
+            inline bool parse_obj_index(const char *&s, long num_vertices, int &index) {
+                char *end = nullptr;
+                const long i = std::strtol(s, &end, 10);
+                if (end == s)
+                    return false;
+                s = end;
+                while (*s && *s != ' ' && *s != '\t' && *s != '\r')
+                    ++s;
+                const long resolved = (i < 0) ? num_vertices + i : i - 1;
+                if (resolved < 0 || resolved >= num_vertices) {
+                    index = -1;
+                    return true;
+                }
+                index = static_cast<int>(resolved);
+                return true;
+            }
+
+            inline const char *skip_spaces(const char *s) {
+                while (*s == ' ' || *s == '\t')
+                    ++s;
+                return s;
+            }
+
+        }
+
+
+        bool MeshStreamReader::read(const std::string &file_name, const VertexCallback &on_vertex,
+                                    const FaceCallback &on_face) {
+            if (!file_system::is_file(file_name)) {
+                LOG(ERROR) << "file does not exist: " << file_name;
+                return false;
+            }
+
+            const std::string &ext = file_system::extension(file_name, true);
+            if (ext == "ply")
+                return read_ply(file_name, on_vertex, on_face);
+            else if (ext == "obj")
+                return read_obj(file_name, on_vertex, on_face);
+
+            LOG(ERROR) << "streaming is not supported for the format of " << file_name << " (only ply and obj)";
+            return false;
+        }
+
+
+        void MeshStreamReader::num_elements(const std::string &file_name, std::size_t &num_vertices,
+                                            std::size_t &num_faces) {
+            num_vertices = 0;
+            num_faces = 0;
+            if (file_system::extension(file_name, true) == "ply") {
+                num_vertices = PlyReader::num_instances(file_name, "vertex");
+                num_faces = PlyReader::num_instances(file_name, "face");
+            }
+        }
+
+
+        bool MeshStreamReader::read_ply(const std::string &file_name, const VertexCallback &on_vertex,
+                                        const FaceCallback &on_face) {
+            internal::PlyStream stream;
+            stream.on_vertex = &on_vertex;
+            stream.on_face = &on_face;
+            stream.last_coordinate = -1;
+            stream.num_vertices = 0;
+            stream.stopped = false;
+
+            p_ply ply = ply_open(file_name.c_str(), internal::ply_stream_error, 0, &stream);
+            if (!ply) {
+                LOG(ERROR) << "failed to open ply file: " << file_name;
+                return false;
+            }
+            if (!ply_read_header(ply)) {
+                LOG(ERROR) << "failed to read ply header";
+                ply_close(ply);
+                return false;
+            }
+
+            // the vertex is complete after the last of its coordinates in the order of the header
+            const char *coordinates[3] = {"x", "y", "z"};
+            bool found[3] = {false, false, false};
+            const char *face_property = nullptr;
+            bool faces_first = false;   // the face element precedes the vertex element
+            p_ply_element element = nullptr;
+            while ((element = ply_get_next_element(ply, element))) {
+                const char *element_name = nullptr;
+                long num_instances = 0;
+                ply_get_element_info(element, &element_name, &num_instances);
+                const bool is_vertex = !strcmp(element_name, "vertex");
+                const bool is_face = !strcmp(element_name, "face");
+                if (is_vertex) {
+                    stream.num_vertices = num_instances;
+                    faces_first = (face_property != nullptr);
+                }
+
+                p_ply_property property = nullptr;
+                while ((property = ply_get_next_property(element, property))) {
+                    const char *property_name = nullptr;
+                    ply_get_property_info(property, &property_name, nullptr, nullptr, nullptr);
+                    if (is_vertex) {
+                        for (long k = 0; k < 3; ++k) {
+                            if (!strcmp(property_name, coordinates[k])) {
+                                found[k] = true;
+                                stream.last_coordinate = k;
+                            }
+                        }
+                    } else if (is_face && (!strcmp(property_name, "vertex_indices") ||
+                                           !strcmp(property_name, "vertex_index"))) {
+                        face_property = property_name;
+                    }
+                }
+            }
+            if (!found[0] || !found[1] || !found[2]) {
+                LOG(ERROR) << "the vertices of " << file_name << " have no x, y, and z coordinates";
+                ply_close(ply);
+                return false;
+            }
+
+            // the faces would be read before their vertices
+            if (on_face && faces_first) {
+                LOG(ERROR) << "the faces of " << file_name << " precede its vertices, which cannot be streamed";
+                ply_close(ply);
+                return false;
+            }
+
+            for (long k = 0; k < 3; ++k)
+                ply_set_read_cb(ply, "vertex", coordinates[k], internal::ply_stream_coordinate, &stream, k);
+            if (on_face && face_property)
+                ply_set_read_cb(ply, "face", face_property, internal::ply_stream_face, &stream, 0);
+
+            const bool success = ply_read(ply) || stream.stopped;
+            ply_close(ply);
+            if (!success)
+                LOG(ERROR) << "error occurred while parsing ply file";
+            return success;
+        }
+
+
+        bool MeshStreamReader::read_obj(const std::string &file_name, const VertexCallback &on_vertex,
+                                        const FaceCallback &on_face) {
+            std::ifstream input(file_name.c_str(), std::ios::binary);
+            if (input.fail()) {
+                LOG(ERROR) << "could not open file: " << file_name;
+                return false;
+            }
+
+            std::string line;
+            std::vector<int> face;
+            long num_vertices = 0;
+            while (std::getline(input, line)) {
+                const char *s = internal::skip_spaces(line.c_str());
+                if (s[0] == 'v' && (s[1] == ' ' || s[1] == '\t')) {
+                    dvec3 p;
+                    char *end = const_cast<char *>(s + 1);
+                    for (int k = 0; k < 3; ++k)
+                        p[k] = std::strtod(end, &end);
+                    ++num_vertices;
+                    if (!on_vertex(p))
+                        return true;
+                } else if (s[0] == 'f' && (s[1] == ' ' || s[1] == '\t') && on_face) {
+                    face.clear();
+                    bool valid = true;
+                    s = internal::skip_spaces(s + 1);
+                    while (*s && *s != '\r') {
+                        int index = -1;
+                        if (!internal::parse_obj_index(s, num_vertices, index))
+                            break;
+                        valid = valid && (index >= 0);
+                        face.push_back(index);
+                        s = internal::skip_spaces(s);
+                    }
+                    if (!valid) {
+                        LOG_N_TIMES(3, ERROR) << "face refers to a vertex that is not defined before it (face ignored). "
+                                              << COUNTER;
+                        continue;
+                    }
+                    if (face.size() >= 3 && !on_face(face.data(), face.size()))
+                        return true;
+                }
+            }
+            return true;
+        }
+
+    } // namespace io
+
+} // namespace MV
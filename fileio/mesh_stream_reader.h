@@ -0,0 +1,62 @@
+#ifndef EASY3D_FILEIO_MESH_STREAM_READER_H
+#define EASY3D_FILEIO_MESH_STREAM_READER_H
+
+
+#include <string>
+#include <functional>
+
+#include "../core/types.h"
+
+
+namespace MV {
+
+    namespace io {
+
+        /**
+         * \brief Reads the vertices and the faces of a mesh file one by one, without storing them.
+         * \details SurfaceMeshIO builds the whole mesh in memory, which is not possible for the largest scans.
+         *      MeshStreamReader hands each vertex and each face to a callback as soon as it is parsed, so the
+         *      memory used does not depend on the size of the file. Supported formats are PLY (ASCII and binary,
+         *      through rply) and OBJ. Only the positions and the vertex indices of the faces are read.
+         *
+         *      The vertices are numbered from 0 in the order of the file. The faces only refer to the vertices
+         *      read before them (which is the case in OBJ files using negative indices). A PLY file whose face
+         *      element precedes its vertex element can only be read without faces.
+         * \class MeshStreamReader MV/fileio/mesh_stream_reader.h
+         */
+        class MeshStreamReader {
+        public:
+            /// Called for each vertex. Returns false to stop reading (e.g., if only the vertices are needed).
+            typedef std::function<bool(const dvec3 &p)> VertexCallback;
+            /// Called for each face with the indices of its \p n vertices. Returns false to stop reading.
+            typedef std::function<bool(const int *indices, std::size_t n)> FaceCallback;
+
+            /**
+             * \brief Reads \p file_name, calling \p on_vertex and \p on_face in the order of the file.
+             * \details The file extension determines the format. \p on_face may be empty, in which case the
+             *      faces are skipped (for OBJ and ASCII PLY files, their lines are still read).
+             * \return \c true if the file was read to its end or a callback stopped the reading, \c false on errors
+             *      (including a PLY file whose faces precede its vertices if \p on_face is not empty).
+             */
+            static bool read(const std::string &file_name, const VertexCallback &on_vertex,
+                             const FaceCallback &on_face);
+
+            /**
+             * \brief The number of vertices and faces that a file declares, or 0 if unknown.
+             * \details Only PLY files declare them in their header. It is read without parsing the file.
+             */
+            static void num_elements(const std::string &file_name, std::size_t &num_vertices, std::size_t &num_faces);
+
+        private:
+            static bool read_ply(const std::string &file_name, const VertexCallback &on_vertex,
+                                 const FaceCallback &on_face);
+            static bool read_obj(const std::string &file_name, const VertexCallback &on_vertex,
+                                 const FaceCallback &on_face);
+        };
+
+    } // namespace io
+
+} // namespace MV
+
+
+#endif  // EASY3D_FILEIO_MESH_STREAM_READER_H
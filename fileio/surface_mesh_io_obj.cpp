@@ -306,57 +306,47 @@ namespace MV {
                 mesh->add_halfedge_property<vec2>("h:texcoord");
             auto prop_texcoords = mesh->get_halfedge_property<vec2>("h:texcoord");
 
-            auto find_face_halfedge = [](SurfaceMesh *mesh, SurfaceMesh::Face face,
-                                         SurfaceMesh::Vertex v) -> SurfaceMesh::Halfedge {
-                for (auto h : mesh->halfedges(face)) {
-                    if (mesh->target(h) == v)
-                        return h;
-                }
-                LOG_N_TIMES(3, ERROR) << "could not find a halfedge pointing to " << v << " in face " << face
-                                      << ". " << COUNTER;
-                return SurfaceMesh::Halfedge();
-            };
-
-            // invalid face will also be added, to ensure correct face indices
-            std::vector<SurfaceMesh::Face> faces;
-            // for each shape
+            // the faces of all shapes are added all at once
+            std::vector<unsigned int> face_offsets(1, 0), face_indices;
+            std::vector<int> texcoord_ids;
             for (size_t i = 0; i < shapes.size(); i++) {
-                std::size_t index_offset = 0;
                 LOG_IF(shapes[i].mesh.num_face_vertices.size() != shapes[i].mesh.material_ids.size(), ERROR) << "shapes[i].mesh.num_face_vertices.size() != shapes[i].mesh.material_ids.size()";
                 LOG_IF(shapes[i].mesh.num_face_vertices.size() != shapes[i].mesh.smoothing_group_ids.size(), ERROR) << "shapes[i].mesh.num_face_vertices.size() != shapes[i].mesh.smoothing_group_ids.size()";
 
-                // For each face
+                std::size_t index_offset = 0;
                 for (std::size_t face_idx = 0; face_idx < shapes[i].mesh.num_face_vertices.size(); ++face_idx) {
                     std::size_t face_size = shapes[i].mesh.num_face_vertices[face_idx];
-
-                    // For each vertex in the face
-                    std::vector<SurfaceMesh::Vertex> vertices;
-                    std::vector<int> texcoord_ids;
                     for (std::size_t v = 0; v < face_size; v++) {
                         const tinyobj::index_t &face = shapes[i].mesh.indices[index_offset + v];
-                        vertices.emplace_back(face.vertex_index);
+                        face_indices.push_back(static_cast<unsigned int>(face.vertex_index));
                         if (prop_texcoords)
-                            texcoord_ids.emplace_back(face.texcoord_index);
+                            texcoord_ids.push_back(face.texcoord_index);
                     }
-
-                    SurfaceMesh::Face face = builder.add_face(vertices);
-                    // invalid face will also be added, to ensure correct face indices
-                    faces.push_back(face);
-                    if (prop_texcoords && face.is_valid()) {
-                        auto begin = find_face_halfedge(mesh, face, builder.face_vertices()[0]);
-                        auto cur = begin;
-                        int idx = 0;
-                        do {
-                            prop_texcoords[cur] = texcoords[texcoord_ids[idx++]];
-                            cur = mesh->next(cur);
-                        } while (cur != begin);
-                    }
-
+                    face_offsets.push_back(static_cast<unsigned int>(face_indices.size()));
                     //int smoothing_group_id = shapes[i].mesh.smoothing_group_ids[f];
                     index_offset += face_size;
                 }
             }
 
+            // ignored faces are kept as invalid handles, to ensure correct face indices
+            std::vector<SurfaceMesh::Face> faces;
+            builder.add_faces(face_offsets, face_indices, &faces);
+
+            if (prop_texcoords) {
+                for (std::size_t f = 0; f < faces.size(); ++f) {
+                    if (!faces[f].is_valid())
+                        continue;
+                    // the halfedge of the face points to its first vertex
+                    auto begin = mesh->halfedge(faces[f]);
+                    auto cur = begin;
+                    unsigned int idx = face_offsets[f];
+                    do {
+                        prop_texcoords[cur] = texcoords[texcoord_ids[idx++]];
+                        cur = mesh->next(cur);
+                    } while (cur != begin);
+                }
+            }
+
             builder.end_surface();
 
             // now the material
@@ -162,41 +162,34 @@ namespace MV {
             if (face_halfedge_texcoords.size() == face_vertex_indices.size())
                 prop_texcoords = mesh->add_halfedge_property<vec2>("h:texcoord");
 
-            // find the face's halfedge that points to v.
-            auto find_face_halfedge = [](SurfaceMesh *mesh, SurfaceMesh::Face face,
-                                         SurfaceMesh::Vertex v) -> SurfaceMesh::Halfedge {
-                for (auto h : mesh->halfedges(face)) {
-                    if (mesh->target(h) == v)
-                        return h;
-                }
-                LOG_N_TIMES(3, ERROR) << "could not find a halfedge pointing to " << v << " in face " << face
-                                      << ". " << COUNTER;
-                return SurfaceMesh::Halfedge();
-            };
+            // the faces are added all at once
+            std::vector<unsigned int> face_offsets(1, 0), face_indices;
+            face_offsets.reserve(face_vertex_indices.size() + 1);
+            for (const auto& indices : face_vertex_indices) {
+                face_indices.insert(face_indices.end(), indices.begin(), indices.end());
+                face_offsets.push_back(static_cast<unsigned int>(face_indices.size()));
+            }
+            std::vector<SurfaceMesh::Face> faces;
+            builder.add_faces(face_offsets, face_indices, &faces);
 
-            for (std::size_t i=0; i<face_vertex_indices.size(); ++i)
-			{
-                const auto& indices = face_vertex_indices[i];
-				std::vector<SurfaceMesh::Vertex> vts;
-				for (auto id : indices)
-                    vts.emplace_back(SurfaceMesh::Vertex(id));
-                auto face = builder.add_face(vts);
-
-                // now let's add the texcoords (defined on halfedges)
-                if (face.is_valid() && prop_texcoords) {
+            // now let's add the texcoords (defined on halfedges)
+            if (prop_texcoords) {
+                for (std::size_t i = 0; i < faces.size(); ++i) {
+                    const auto face = faces[i];
                     const auto& face_texcoords = face_halfedge_texcoords[i];
-                    if (face_texcoords.size() == vts.size() * 2) { // 2 coordinates per vertex
-                        auto begin = find_face_halfedge(mesh, face, builder.face_vertices()[0]);
-                        auto cur = begin;
-                        unsigned int texcord_idx = 0;
-                        do {
-                            prop_texcoords[cur] = vec2(face_texcoords[texcord_idx], face_texcoords[texcord_idx + 1]);
-                            texcord_idx += 2;
-                            cur = mesh->next(cur);
-                        } while (cur != begin);
-                    }
+                    if (!face.is_valid() || face_texcoords.size() != face_vertex_indices[i].size() * 2) // 2 coordinates per vertex
+                        continue;
+                    // the halfedge of the face points to its first vertex
+                    auto begin = mesh->halfedge(face);
+                    auto cur = begin;
+                    unsigned int texcord_idx = 0;
+                    do {
+                        prop_texcoords[cur] = vec2(face_texcoords[texcord_idx], face_texcoords[texcord_idx + 1]);
+                        texcord_idx += 2;
+                        cur = mesh->next(cur);
+                    } while (cur != begin);
                 }
-			}
+            }
 
 			// now let's add the remained properties
 			for (const auto& e : elements) 
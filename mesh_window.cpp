@@ -13,6 +13,8 @@
 #include <QLabel>
 #include <QPushButton>
 #include <QProgressBar>
+#include <QStatusBar>
+#include <QThread>
 
 #include "core/surface_mesh.h"
 #include "core/graph.h"
@@ -39,6 +41,7 @@
 #include "util/stop_watch.h"
 #include "util/line_stream.h"
 #include "util/version.h"
+#include "util/job_runner.h"
 
 #include "paint_canvas.h"
 #include "walk_through.h"
@@ -57,6 +60,20 @@ MeshWindow::MeshWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MeshPr
 
     auto widgetGlobalSetting = new WidgetLightSetting(this);
     ui->verticalLayout_light_setting->addWidget(widgetGlobalSetting);
+
+    // progress of the running algorithm, which can be canceled from here
+    m_pProgressBar = new QProgressBar(this);
+    m_pProgressBar->setRange(0, 100);
+    m_pProgressBar->setFixedWidth(200);
+    m_pProgressBar->setVisible(false);
+    m_pCancelTaskButton = new QPushButton(tr("Cancel"), this);
+    m_pCancelTaskButton->setVisible(false);
+    connect(m_pCancelTaskButton, &QPushButton::clicked, this, [this]() {
+        cancel();
+        JobRunner::instance()->cancel_all();
+    });
+    statusBar()->addPermanentWidget(m_pProgressBar);
+    statusBar()->addPermanentWidget(m_pCancelTaskButton);
     
     // setBaseSize(1024, 800);
     this->showMaximized();
@@ -66,16 +83,31 @@ MeshWindow::MeshWindow(QWidget *parent) : QMainWindow(parent), ui(new Ui::MeshPr
 
 void MeshWindow::notify(std::size_t percent, bool update_viewer)
 {
-    //progress_bar_->setValue(int(percent));
-    //cancelTaskButton_->setVisible(percent > 0 && percent < 100);
-    //progress_bar_->setVisible(percent > 0 && percent < 100);
+    // progress of a background job: the widgets can only be touched by the GUI thread, whose event
+    // loop is running anyway
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, [this, percent, update_viewer]() {
+            UpdateProgress(percent, update_viewer);
+        }, Qt::QueuedConnection);
+        return;
+    }
+
+    UpdateProgress(percent, update_viewer);
+    QApplication::processEvents();
+}
+
+
+void MeshWindow::UpdateProgress(std::size_t percent, bool update_viewer)
+{
+    m_pProgressBar->setValue(int(percent));
+    m_pCancelTaskButton->setVisible(percent > 0 && percent < 100);
+    m_pProgressBar->setVisible(percent > 0 && percent < 100);
 
     if (update_viewer)
     {
         m_pViewer->update();
     }
-        
-    QApplication::processEvents();
 }
 
 
@@ -199,7 +231,11 @@ Model* MeshWindow::open(const std::string& file_name)
 
 
 MeshWindow::~MeshWindow()
-{}
+{
+    // the jobs report to this window and publish into the viewer
+    JobRunner::instance()->cancel_all();
+    JobRunner::instance()->wait_all();
+}
 
 void MeshWindow::CreateMenus()
 {
@@ -8,6 +8,8 @@
 #include "ui_MeshProcess.h"
 
 class PaintCanvas;
+class QProgressBar;
+class QPushButton;
 
 namespace Ui 
 {
@@ -33,6 +35,7 @@ public:
 
 private:
     void notify(std::size_t percent, bool update_viewer) override;
+    void UpdateProgress(std::size_t percent, bool update_viewer);
     void send(el::Level level, const std::string& msg) override;
     void CreateMenus();
     void CreateActions();
@@ -46,6 +49,8 @@ public:
 private:
     Ui::MeshProcessClass* ui;
     PaintCanvas* m_pViewer;
+    QProgressBar* m_pProgressBar;
+    QPushButton* m_pCancelTaskButton;
 
     // ļ
     QMenu* m_pMenuFile;
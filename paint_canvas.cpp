@@ -1246,7 +1246,7 @@ void PaintCanvas::drawCornerAxes() {
 
 
 void PaintCanvas::drawPickedFaceAndItsVerticesIDs(const QColor& face_color, const QColor& vertex_color) {
-    auto mesh = dynamic_cast<SurfaceMesh*>(currentModel());
+    auto mesh = dynamic_cast<const SurfaceMesh*>(currentModel());
     if (!mesh || picked_face_index_ < 0 || picked_face_index_ >= static_cast<int>(mesh->n_faces()))
         return;
 
@@ -1570,7 +1570,8 @@ void PaintCanvas::deleteSelectedPrimitives() {
                 ++count;
             }
         }
-        mesh->collect_garbage();
+        // keep the order of the remaining elements, so repeated deletions do not scatter them
+        mesh->collect_garbage(true);
         mesh->manipulator()->reset();
         mesh->renderer()->update();
         LOG(INFO) << count << " faces deleted";
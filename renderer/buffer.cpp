@@ -30,6 +30,9 @@
 
 #include "../core/poly_mesh.h"
 #include "../core/surface_mesh.h"
+#include "../core/compact_tri_mesh.h"
+#include "../core/property_keys.h"
+#include "../core/normals.h"
 #include "renderer.h"
 #include "drawable_points.h"
 #include "drawable_lines.h"
@@ -48,16 +51,19 @@ namespace MV {
             // min_value and max_value return the expected value range.
             template<typename FT>
             inline void
-            clamp_scalar_field(const std::vector<FT> &property, float &min_value, float &max_value,
+            clamp_scalar_field(const PropertyArray<FT> &property, float &min_value, float &max_value,
                                float dummy_lower_percent,
                                float dummy_upper_percent) {
-                if (property.empty()) {
+                const std::size_t size = property.vector().size();
+                if (size == 0) {
                     LOG(WARNING) << "empty property";
                     return;
                 }
 
-                // sort curvature values
-                std::vector<FT> values = property;
+                // sort curvature values (a bool property does not store a std::vector<bool>, see PropertyStorage)
+                std::vector<FT> values(size);
+                for (std::size_t i = 0; i < size; ++i)
+                    values[i] = property[i];
                 std::sort(values.begin(), values.end());
 
                 const std::size_t n = values.size() - 1;
@@ -103,9 +109,9 @@ namespace MV {
                 const float dummy_upper = (drawable->clamp_range() ? drawable->clamp_upper() : 0.0f);
                 float min_value = std::numeric_limits<float>::max();
                 float max_value = -std::numeric_limits<float>::max();
-                internal::clamp_scalar_field(prop.vector(), min_value, max_value, dummy_lower, dummy_upper);
+                internal::clamp_scalar_field(prop.array(), min_value, max_value, dummy_lower, dummy_upper);
 
-                auto points = model->template get_vertex_property<vec3>("v:point");
+                auto points = model->get_vertex_property(keys::v_point);
 
                 std::vector<vec2> d_texcoords;
                 d_texcoords.reserve(model->n_vertices());
@@ -116,7 +122,7 @@ namespace MV {
                 drawable->update_vertex_buffer(points.vector());
                 drawable->update_texcoord_buffer(d_texcoords);
 
-                auto normals = model->template get_vertex_property<vec3>("v:normal");
+                auto normals = model->get_vertex_property(keys::v_normal);
                 if (normals)
                     drawable->update_normal_buffer(normals.vector());
             }
@@ -138,9 +144,9 @@ namespace MV {
                 const float dummy_upper = (drawable->clamp_range() ? drawable->clamp_upper() : 0.0f);
                 float min_value = std::numeric_limits<float>::max();
                 float max_value = -std::numeric_limits<float>::max();
-                internal::clamp_scalar_field(prop.vector(), min_value, max_value, dummy_lower, dummy_upper);
+                internal::clamp_scalar_field(prop.array(), min_value, max_value, dummy_lower, dummy_upper);
 
-                auto points = model->template get_vertex_property<vec3>("v:point");
+                auto points = model->get_vertex_property(keys::v_point);
                 std::vector<vec3> d_points;
                 d_points.reserve(model->n_edges() * 2);
                 std::vector<vec2> d_texcoords;
@@ -176,9 +182,9 @@ namespace MV {
                 const float dummy_upper = (drawable->clamp_range() ? drawable->clamp_upper() : 0.0f);
                 float min_value = std::numeric_limits<float>::max();
                 float max_value = -std::numeric_limits<float>::max();
-                internal::clamp_scalar_field(prop.vector(), min_value, max_value, dummy_lower, dummy_upper);
+                internal::clamp_scalar_field(prop.array(), min_value, max_value, dummy_lower, dummy_upper);
 
-                auto points = model->template get_vertex_property<vec3>("v:point");
+                auto points = model->get_vertex_property(keys::v_point);
                 drawable->update_vertex_buffer(points.vector());
 
                 std::vector<vec2> d_texcoords;
@@ -214,15 +220,15 @@ namespace MV {
                 }
 
                 if (model->is_triangle_mesh()) {
-                    auto points = model->get_vertex_property<vec3>("v:point");
+                    auto points = model->get_vertex_property(keys::v_point);
                     model->update_vertex_normals();
-                    auto normals = model->get_vertex_property<vec3>("v:normal");
+                    auto normals = model->get_vertex_property(keys::v_normal);
 
                     const float dummy_lower = (drawable->clamp_range() ? drawable->clamp_lower() : 0.0f);
                     const float dummy_upper = (drawable->clamp_range() ? drawable->clamp_upper() : 0.0f);
                     float min_value = std::numeric_limits<float>::max();
                     float max_value = -std::numeric_limits<float>::max();
-                    internal::clamp_scalar_field(prop.vector(), min_value, max_value, dummy_lower, dummy_upper);
+                    internal::clamp_scalar_field(prop.array(), min_value, max_value, dummy_lower, dummy_upper);
 
                     std::vector<vec3> d_points, d_normals;
                     std::vector<vec2> d_texcoords;
@@ -287,7 +293,7 @@ namespace MV {
                 //    const float dummy_upper = (drawable->clamp_range() ? drawable->clamp_upper() : 0.0f);
                 //    float min_value = std::numeric_limits<float>::max();
                 //    float max_value = -std::numeric_limits<float>::max();
-                //    internal::clamp_scalar_field(prop.vector(), min_value, max_value, dummy_lower, dummy_upper);
+                //    internal::clamp_scalar_field(prop.array(), min_value, max_value, dummy_lower, dummy_upper);
 
                 //    std::vector<vec3> d_points, d_normals;
                 //    std::vector<vec2> d_texcoords;
@@ -356,15 +362,15 @@ namespace MV {
                 }
 
                 if (model->is_triangle_mesh()) {
-                    auto points = model->get_vertex_property<vec3>("v:point");
+                    auto points = model->get_vertex_property(keys::v_point);
                     model->update_vertex_normals();
-                    auto normals = model->get_vertex_property<vec3>("v:normal");
+                    auto normals = model->get_vertex_property(keys::v_normal);
 
                     const float dummy_lower = (drawable->clamp_range() ? drawable->clamp_lower() : 0.0f);
                     const float dummy_upper = (drawable->clamp_range() ? drawable->clamp_upper() : 0.0f);
                     float min_value = std::numeric_limits<float>::max();
                     float max_value = -std::numeric_limits<float>::max();
-                    internal::clamp_scalar_field(prop.vector(), min_value, max_value, dummy_lower, dummy_upper);
+                    internal::clamp_scalar_field(prop.array(), min_value, max_value, dummy_lower, dummy_upper);
 
                     std::vector<vec2> d_texcoords;
                     d_texcoords.reserve(model->n_vertices());
@@ -433,7 +439,7 @@ namespace MV {
                 //    const float dummy_upper = (drawable->clamp_range() ? drawable->clamp_upper() : 0.0f);
                 //    float min_value = std::numeric_limits<float>::max();
                 //    float max_value = -std::numeric_limits<float>::max();
-                //    internal::clamp_scalar_field(prop.vector(), min_value, max_value, dummy_lower, dummy_upper);
+                //    internal::clamp_scalar_field(prop.array(), min_value, max_value, dummy_lower, dummy_upper);
 
                 //    for (auto face : model->faces()) {
                 //        tessellator.begin_polygon(fnormals[face]);
@@ -494,7 +500,7 @@ namespace MV {
                 }
 
                 model->update_vertex_normals();
-                auto normals = model->get_vertex_property<vec3>("v:normal");
+                auto normals = model->get_vertex_property(keys::v_normal);
 
                 // since we have two parts, no need to transfer all vertices and normals
                 // I just use the tessellator
@@ -570,8 +576,8 @@ namespace MV {
                 }
 
                 model->update_vertex_normals();
-                auto normals = model->get_vertex_property<vec3>("v:normal");
-                auto points = model->get_vertex_property<vec3>("v:point");
+                auto normals = model->get_vertex_property(keys::v_normal);
+                auto points = model->get_vertex_property(keys::v_point);
 
                 /**
                  * We use the Tessellator to eliminate duplicate vertices. This allows us to take advantage of element
@@ -633,8 +639,8 @@ namespace MV {
                 }
 
                 model->update_vertex_normals();
-                auto normals = model->get_vertex_property<vec3>("v:normal");
-                auto points = model->get_vertex_property<vec3>("v:point");
+                auto normals = model->get_vertex_property(keys::v_normal);
+                auto points = model->get_vertex_property(keys::v_point);
 
                 /**
                  * We use the Tessellator to eliminate duplicate vertices. This allows us to take advantage of element
@@ -697,8 +703,8 @@ namespace MV {
                 }
 
                 model->update_vertex_normals();
-                auto normals = model->get_vertex_property<vec3>("v:normal");
-                auto points = model->get_vertex_property<vec3>("v:point");
+                auto normals = model->get_vertex_property(keys::v_normal);
+                auto points = model->get_vertex_property(keys::v_point);
 
                 /**
                  * We use the Tessellator to eliminate duplicate vertices. This allows us to take advantage of element
@@ -762,14 +768,14 @@ namespace MV {
                 }
 
                 model->update_vertex_normals();
-                auto normals = model->get_vertex_property<vec3>("v:normal");
-                auto points = model->get_vertex_property<vec3>("v:point");
+                auto normals = model->get_vertex_property(keys::v_normal);
+                auto points = model->get_vertex_property(keys::v_point);
 
                 const float dummy_lower = (drawable->clamp_range() ? drawable->clamp_lower() : 0.0f);
                 const float dummy_upper = (drawable->clamp_range() ? drawable->clamp_upper() : 0.0f);
                 float min_value = std::numeric_limits<float>::max();
                 float max_value = -std::numeric_limits<float>::max();
-                internal::clamp_scalar_field(prop.vector(), min_value, max_value, dummy_lower, dummy_upper);
+                internal::clamp_scalar_field(prop.array(), min_value, max_value, dummy_lower, dummy_upper);
 
                 /**
                  * We use the Tessellator to eliminate duplicate vertices. This allows us to take advantage of element
@@ -833,14 +839,14 @@ namespace MV {
                 }
 
                 model->update_vertex_normals();
-                auto normals = model->get_vertex_property<vec3>("v:normal");
-                auto points = model->get_vertex_property<vec3>("v:point");
+                auto normals = model->get_vertex_property(keys::v_normal);
+                auto points = model->get_vertex_property(keys::v_point);
 
                 const float dummy_lower = (drawable->clamp_range() ? drawable->clamp_lower() : 0.0f);
                 const float dummy_upper = (drawable->clamp_range() ? drawable->clamp_upper() : 0.0f);
                 float min_value = std::numeric_limits<float>::max();
                 float max_value = -std::numeric_limits<float>::max();
-                internal::clamp_scalar_field(prop.vector(), min_value, max_value, dummy_lower, dummy_upper);
+                internal::clamp_scalar_field(prop.array(), min_value, max_value, dummy_lower, dummy_upper);
 
                 /**
                  * We use the Tessellator to eliminate duplicate vertices. This allows us to take advantage of element
@@ -902,11 +908,11 @@ namespace MV {
                     return;
                 }
 
-                auto points = model->template get_vertex_property<vec3>("v:point");
+                auto points = model->get_vertex_property(keys::v_point);
                 drawable->update_vertex_buffer(points.vector());
                 drawable->update_color_buffer(prop.vector());
 
-                auto normals = model->template get_vertex_property<vec3>("v:normal");
+                auto normals = model->get_vertex_property(keys::v_normal);
                 if (normals)
                     drawable->update_normal_buffer(normals.vector());
             }
@@ -923,11 +929,11 @@ namespace MV {
                     return;
                 }
 
-                auto points = model->template get_vertex_property<vec3>("v:point");
+                auto points = model->get_vertex_property(keys::v_point);
                 drawable->update_vertex_buffer(points.vector());
                 drawable->update_texcoord_buffer(prop.vector());
 
-                auto normals = model->template get_vertex_property<vec3>("v:normal");
+                auto normals = model->get_vertex_property(keys::v_normal);
                 if (normals)
                     drawable->update_normal_buffer(normals.vector());
             }
@@ -944,7 +950,7 @@ namespace MV {
 
                 if (model->is_triangle_mesh()) {
                     model->update_vertex_normals();
-                    auto normals = model->get_vertex_property<vec3>("v:normal");
+                    auto normals = model->get_vertex_property(keys::v_normal);
 
                     std::vector<unsigned int> d_indices;
                     d_indices.reserve(model->n_faces() * 3);
@@ -952,7 +958,7 @@ namespace MV {
                         for (auto h : model->halfedges(face))
                             d_indices.push_back(model->target(h).idx());
                     }
-                    drawable->update_vertex_buffer(model->points());
+                    drawable->update_vertex_buffer(static_cast<const SurfaceMesh*>(model)->points());
                     drawable->update_element_buffer(d_indices);
                     drawable->update_normal_buffer(normals.vector());
 
@@ -1073,9 +1079,9 @@ namespace MV {
                 }
 
                 if (model->is_triangle_mesh()) {
-                    auto points = model->get_vertex_property<vec3>("v:point");
+                    auto points = model->get_vertex_property(keys::v_point);
                     model->update_vertex_normals();
-                    auto normals = model->get_vertex_property<vec3>("v:normal");
+                    auto normals = model->get_vertex_property(keys::v_normal);
 
                     std::vector<vec3> d_points, d_normals, d_colors;
                     d_points.reserve(model->n_faces() * 3);
@@ -1199,9 +1205,9 @@ namespace MV {
                 }
 
                 if (model->is_triangle_mesh()) {
-                    auto points = model->get_vertex_property<vec3>("v:point");
+                    auto points = model->get_vertex_property(keys::v_point);
                     model->update_vertex_normals();
-                    auto normals = model->get_vertex_property<vec3>("v:normal");
+                    auto normals = model->get_vertex_property(keys::v_normal);
 
                     std::vector<unsigned int> d_indices;
                     d_indices.reserve(model->n_faces() * 3);
@@ -1317,9 +1323,9 @@ namespace MV {
                 }
 
                 if (model->is_triangle_mesh()) {
-                    auto points = model->get_vertex_property<vec3>("v:point");
+                    auto points = model->get_vertex_property(keys::v_point);
                     model->update_vertex_normals();
-                    auto normals = model->get_vertex_property<vec3>("v:normal");
+                    auto normals = model->get_vertex_property(keys::v_normal);
 
                     std::vector<unsigned int> d_indices;
                     d_indices.reserve(model->n_faces() * 3);
@@ -1437,9 +1443,9 @@ namespace MV {
                 }
 
                 if (model->is_triangle_mesh()) {
-                    auto points = model->get_vertex_property<vec3>("v:point");
+                    auto points = model->get_vertex_property(keys::v_point);
                     model->update_vertex_normals();
-                    auto normals = model->get_vertex_property<vec3>("v:normal");
+                    auto normals = model->get_vertex_property(keys::v_normal);
 
                     std::vector<vec3> d_points, d_normals;
                     std::vector<vec2> d_texcoords;
@@ -1563,7 +1569,7 @@ namespace MV {
                     return;
                 }
 
-                auto points = model->template get_vertex_property<vec3>("v:point");
+                auto points = model->get_vertex_property(keys::v_point);
                 std::vector<vec3> d_points, d_colors;
                 d_points.reserve(model->n_edges() * 2);
                 d_colors.reserve(model->n_edges() * 2);
@@ -1593,7 +1599,7 @@ namespace MV {
                     return;
                 }
 
-                auto points = model->template get_vertex_property<vec3>("v:point");
+                auto points = model->get_vertex_property(keys::v_point);
                 std::vector<vec3> d_points, d_colors;
                 d_points.reserve(model->n_edges() * 2);
                 d_colors.reserve(model->n_edges() * 2);
@@ -1623,7 +1629,7 @@ namespace MV {
                     return;
                 }
 
-                auto points = model->template get_vertex_property<vec3>("v:point");
+                auto points = model->get_vertex_property(keys::v_point);
                 std::vector<vec3> d_points;
                 d_points.reserve(model->n_edges() * 2);
                 std::vector<vec2> d_texcoords;
@@ -1652,7 +1658,7 @@ namespace MV {
                     return;
                 }
 
-                auto points = model->template get_vertex_property<vec3>("v:point");
+                auto points = model->get_vertex_property(keys::v_point);
                 std::vector<vec3> d_points;
                 d_points.reserve(model->n_edges() * 2);
                 std::vector<vec2> d_texcoords;
@@ -1677,7 +1683,7 @@ namespace MV {
                     return;
                 }
 
-                auto prop = model->get_vertex_property<vec3>("v:point");
+                auto prop = model->get_vertex_property(keys::v_point);
                 std::vector<vec3> points;
                 points.reserve(model->n_edges() * 2);
                 for (auto e : model->edges()) {
@@ -1698,8 +1704,8 @@ namespace MV {
 
                 auto locked = model->get_vertex_property<bool>("v:locked");
                 if (locked) {
-                    auto points = model->get_vertex_property<vec3>("v:point");
-                    auto normals = model->get_vertex_property<vec3>("v:normal");
+                    auto points = model->get_vertex_property(keys::v_point);
+                    auto normals = model->get_vertex_property(keys::v_normal);
                     std::vector<vec3> d_points, d_normals;
                     for (auto v : model->vertices()) {
                         if (locked[v]) {
@@ -1716,9 +1722,9 @@ namespace MV {
 
             template<typename MODEL>
             void update_uniform_colors(MODEL *model, PointsDrawable *drawable) {
-                auto points = model->template get_vertex_property<vec3>("v:point");
+                auto points = model->get_vertex_property(keys::v_point);
                 drawable->update_vertex_buffer(points.vector());
-                auto normals = model->template get_vertex_property<vec3>("v:normal");
+                auto normals = model->get_vertex_property(keys::v_normal);
                 if (normals)
                     drawable->update_normal_buffer(normals.vector());
             }
@@ -1734,7 +1740,7 @@ namespace MV {
                     indices.push_back(s.idx());
                     indices.push_back(t.idx());
                 }
-                auto points = model->template get_vertex_property<vec3>("v:point");
+                auto points = model->get_vertex_property(keys::v_point);
                 drawable->update_vertex_buffer(points.vector());
                 drawable->update_element_buffer(indices);
             }
@@ -2087,7 +2093,7 @@ namespace MV {
                     return;
             }
 
-            auto points = model->get_vertex_property<vec3>("v:point");
+            auto points = model->get_vertex_property(keys::v_point);
 
             // use a limited number of edge to compute the length of the vectors.
             float avg_edge_length = 0.0f;
@@ -2497,6 +2503,24 @@ namespace MV {
         }
 
 
+        void update(const CompactTriMesh& mesh, TrianglesDrawable* drawable) {
+            assert(drawable);
+
+            if (mesh.empty()) {
+                LOG(WARNING) << "model has no valid geometry";
+                return;
+            }
+
+            std::vector<vec3> normals;
+            vertex_normals(mesh, normals);
+
+            drawable->set_coloring_method(State::UNIFORM_COLOR);
+            drawable->update_vertex_buffer(mesh.points());
+            drawable->update_normal_buffer(normals);
+            drawable->update_element_buffer(mesh.indices());
+        }
+
+
         void update(PolyMesh *model, LinesDrawable *drawable, const std::string &field, State::Location location, float scale) {
             if (model->empty()) {
                 LOG(WARNING) << "model has no valid geometry";
@@ -2527,7 +2551,7 @@ namespace MV {
                     return;
             }
 
-            auto points = model->get_vertex_property<vec3>("v:point");
+            auto points = model->get_vertex_property(keys::v_point);
 
             // use a limited number of border edges to compute the average length of the vectors.
             float avg_edge_length = 0.0f;
@@ -37,6 +37,7 @@ namespace MV {
     class PointCloud;
     class SurfaceMesh;
     class PolyMesh;
+    class CompactTriMesh;
     class Drawable;
     class PointsDrawable;
     class LinesDrawable;
@@ -187,6 +188,18 @@ namespace MV {
         void update(PolyMesh *model, LinesDrawable *drawable, const std::string& field, State::Location location, float scale);
         //@}
 
+        /// \name Render buffer update for CompactTriMesh
+        //@{
+        // CompactTriMesh ---------------------------------------------------------------------------------------------
+        /**
+         * @brief Update the vertex, normal, and element buffers of a drawable from a compact triangle mesh.
+         * The mesh has no properties, so it is rendered with a uniform color.
+         * @param mesh      The mesh.
+         * @param drawable  The drawable.
+         */
+        void update(const CompactTriMesh& mesh, TrianglesDrawable* drawable);
+        //@}
+
     }   // namespaces buffer
 
 }   // namespaces MV
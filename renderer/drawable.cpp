@@ -120,7 +120,7 @@ namespace MV {
             LOG_N_TIMES(3, ERROR)
                 << "do not know how to update rendering buffers: drawable not associated with a model and no update function specified. " << COUNTER;
             return;
-        } else if (model_ && model_->points().empty()) {
+        } else if (model_ && static_cast<const Model*>(model_)->points().empty()) {
             clear();
             LOG_N_TIMES(3, WARNING) << "model has no valid geometry. " << COUNTER;
             return;
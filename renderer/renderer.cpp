@@ -30,6 +30,7 @@
 #include "../core/point_cloud.h"
 #include "../core/surface_mesh.h"
 #include "../core/poly_mesh.h"
+#include "../core/property_keys.h"
 #include "drawable_points.h"
 #include "drawable_lines.h"
 #include "drawable_triangles.h"
@@ -177,14 +178,14 @@ namespace MV {
         //     5: uniform color.
 
         // 1. per-vertex color: in "v:color"
-        auto colors = model->get_vertex_property<vec3>("v:color");
+        auto colors = model->get_vertex_property(keys::v_color);
         if (colors) {
             drawable->set_property_coloring(State::VERTEX, "v:color");
             return;
         }
 
         // 2. per-vertex texture coordinates: in "v:texcoord"
-        auto texcoord = model->get_vertex_property<vec2>("v:texcoord");
+        auto texcoord = model->get_vertex_property(keys::v_texcoord);
         if (texcoord) {
             drawable->set_texture_coloring(State::VERTEX, "v:texcoord");
             return;
@@ -227,35 +228,35 @@ namespace MV {
         //      8. uniform color
 
         // 1: per-face color
-        auto face_colors = model->get_face_property<vec3>("f:color");
+        auto face_colors = model->get_face_property(keys::f_color);
         if (face_colors) {
             drawable->set_property_coloring(State::FACE, "f:color");
             return;
         }
 
         // 2: per-vertex color
-        auto vertex_colors = model->get_vertex_property<vec3>("v:color");
+        auto vertex_colors = model->get_vertex_property(keys::v_color);
         if (vertex_colors) {
             drawable->set_property_coloring(State::VERTEX, "v:color");
             return;
         }
 
         // 3. per-halfedge texture coordinates
-        auto halfedge_texcoords = model->get_halfedge_property<vec2>("h:texcoord");
+        auto halfedge_texcoords = model->get_halfedge_property(keys::h_texcoord);
         if (halfedge_texcoords) {
             drawable->set_texture_coloring(State::HALFEDGE, "h:texcoord");
             return;
         }
 
         // 4. per-vertex texture coordinates
-        auto vertex_texcoords = model->get_vertex_property<vec2>("v:texcoord");
+        auto vertex_texcoords = model->get_vertex_property(keys::v_texcoord);
         if (vertex_texcoords) {
             drawable->set_texture_coloring(State::VERTEX, "v:texcoord");
             return;
         }
 
         // 5. segmentation
-        auto segmentation = model->get_face_property<int>("f:chart");
+        auto segmentation = model->get_face_property(keys::f_chart);
         if (segmentation) {
             drawable->set_scalar_coloring(State::FACE, "f:chart");
             return;
@@ -297,14 +298,14 @@ namespace MV {
         //     4: uniform color.
 
         // 1. per-vertex color: in "v:color"
-        auto colors = model->get_vertex_property<vec3>("v:color");
+        auto colors = model->get_vertex_property(keys::v_color);
         if (colors) {
             drawable->set_property_coloring(State::VERTEX, "v:color");
             return;
         }
 
         // 2. per-vertex texture coordinates: in "v:texcoord"
-        auto texcoord = model->get_vertex_property<vec2>("v:texcoord");
+        auto texcoord = model->get_vertex_property(keys::v_texcoord);
         if (texcoord) {
             drawable->set_texture_coloring(State::VERTEX, "v:texcoord");
             return;
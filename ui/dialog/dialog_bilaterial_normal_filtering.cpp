@@ -2,8 +2,16 @@
 #include "../mesh_window.h"
 #include "../paint_canvas.h"
 #include "../core/surface_mesh.h"
+#include "../core/property_keys.h"
 #include "../algo/bilaterial_denoise.h"
 #include "../renderer/renderer.h"
+#include "../util/job_runner.h"
+#include "../util/logging.h"
+
+#include <QApplication>
+#include <QPointer>
+#include <memory>
+#include <algorithm>
 
 using namespace MV;
 DialogBilaterialNormalFiltering::DialogBilaterialNormalFiltering(MeshWindow* window)
@@ -13,6 +21,15 @@ DialogBilaterialNormalFiltering::DialogBilaterialNormalFiltering(MeshWindow* win
 	connect(okButton, SIGNAL(clicked()), this, SLOT(apply()));
 }
 
+DialogBilaterialNormalFiltering::~DialogBilaterialNormalFiltering()
+{
+	// the job only works on its snapshot, and its completion checks that the dialog still exists
+	if (m_pJob)
+	{
+		m_pJob->cancel();
+	}
+}
+
 void DialogBilaterialNormalFiltering::apply()
 {
 	auto mesh = dynamic_cast<SurfaceMesh*>(m_pViewer->currentModel());
@@ -20,8 +37,70 @@ void DialogBilaterialNormalFiltering::apply()
 	{
 		return;
 	}
-	BilaterialDenoise BilaterialDenoiseObj(DenoiseType::Bilaterial_Local);
-	BilaterialDenoiseObj.Denoise(*mesh);
-	mesh->renderer()->update();
-	m_pViewer->update();
-}
\ No newline at end of file
+
+	// The filter runs on a worker over a copy of the mesh, so the viewer stays interactive. The GUI thread
+	// copies the filtered positions back in one go (i.e., never half-way through a frame), and only the
+	// positions: edits of other properties made in the meantime are kept. The positions are copied back by
+	// vertex index, so the filter must not collect garbage on the snapshot.
+	if (mesh->has_garbage())
+	{
+		mesh->collect_garbage();
+	}
+	auto snapshot = std::make_shared<SurfaceMesh>(*mesh);
+	const std::uint64_t uTopology = mesh->topology_version();
+	const std::uint64_t uPoints = static_cast<const SurfaceMesh*>(mesh)->get_vertex_property(keys::v_point).version();
+	okButton->setEnabled(false);
+
+	// The completion runs on the worker. It must not touch the dialog, which may be gone by then; the result
+	// is posted to the application object, and the dialog is only used if the guard still points to it.
+	QPointer<DialogBilaterialNormalFiltering> guard(this);
+	m_pJob = JobRunner::instance()->submit("bilateral normal filtering",
+		[snapshot](Job&) {
+			BilaterialDenoise BilaterialDenoiseObj(DenoiseType::Bilaterial_Local);
+			BilaterialDenoiseObj.Denoise(*snapshot);
+			return !BilaterialDenoiseObj.IsCanceled();
+		},
+		[guard, snapshot, mesh, uTopology, uPoints](Job& job) {
+			const Job::State state = job.state();
+			const std::string error = job.error();
+			QMetaObject::invokeMethod(qApp, [guard, snapshot, mesh, uTopology, uPoints, state, error]() {
+				if (guard.isNull())
+				{
+					return;
+				}
+				guard->m_pJob.reset();
+				guard->okButton->setEnabled(true);
+				if (state == Job::FAILED)
+				{
+					LOG(ERROR) << "bilateral normal filtering failed: " << error;
+					return;
+				}
+				if (state != Job::FINISHED)
+				{
+					LOG(INFO) << "bilateral normal filtering canceled";
+					return;
+				}
+
+				// The model may have been deleted in the meantime (mesh is only dereferenced once it is found
+				// among the models; a new model at the same address has another topology stamp), or its
+				// connectivity or positions may have been edited.
+				const auto& models = guard->m_pViewer->models();
+				if (std::find(models.begin(), models.end(), mesh) == models.end())
+				{
+					LOG(WARNING) << "the model has been closed during bilateral normal filtering, result discarded";
+					return;
+				}
+				if (mesh->topology_version() != uTopology ||
+					static_cast<const SurfaceMesh*>(mesh)->get_vertex_property(keys::v_point).version() != uPoints)
+				{
+					LOG(WARNING) << "the model has been edited during bilateral normal filtering, result discarded";
+					return;
+				}
+				mesh->points().swap(snapshot->points());
+				mesh->mark_positions_changed();
+				mesh->invalidate_bounding_box();
+				mesh->renderer()->update();
+				guard->m_pViewer->update();
+			}, Qt::QueuedConnection);
+		});
+}
@@ -1,16 +1,22 @@
 #pragma once
 #include "ui_dialog_bilaterial_normal_filtering.h"
 #include <qdialog.h>
+#include <memory>
 
 class MeshWindow;
 class PaintCanvas;
 
+namespace MV
+{
+	class Job;
+}
+
 class DialogBilaterialNormalFiltering : public QDialog, public Ui::BilaterialNormalFiltering
 {
 	Q_OBJECT
 public:
 	explicit DialogBilaterialNormalFiltering(MeshWindow* window);
-	virtual ~DialogBilaterialNormalFiltering() {};
+	virtual ~DialogBilaterialNormalFiltering();
 
 private Q_SLOTS:
 	void apply();
@@ -18,5 +24,6 @@ private Q_SLOTS:
 protected:
 	PaintCanvas* m_pViewer;
 	MeshWindow* m_pWindow;
+	std::shared_ptr<MV::Job> m_pJob;	// the filtering running in the background, if any
 };
 
@@ -0,0 +1,147 @@
+#include "job_runner.h"
+#include "parallel.h"
+
+#include <exception>
+#include <algorithm>
+
+
+namespace MV {
+
+    namespace {
+        thread_local const Job* current_job = nullptr;
+    }
+
+
+    Job::Job(const std::string& name, Work work, Callback finished)
+            : name_(name)
+            , work_(std::move(work))
+            , finished_(std::move(finished))
+            , state_(QUEUED)
+            , canceled_(false)
+    {
+    }
+
+
+    const Job* Job::current() {
+        return current_job;
+    }
+
+
+    void Job::run() {
+        if (canceled_) {
+            state_ = CANCELED;
+        }
+        else {
+            state_ = RUNNING;
+            current_job = this;
+            try {
+                const bool completed = work_(*this);
+                state_ = (completed && !canceled_) ? FINISHED : CANCELED;
+            }
+            catch (const std::exception& e) {
+                error_ = e.what();
+                state_ = FAILED;
+            }
+            catch (...) {
+                error_ = "unknown exception";
+                state_ = FAILED;
+            }
+            current_job = nullptr;
+        }
+
+        if (finished_)
+            finished_(*this);
+        // the work may hold large snapshots, release them now rather than with the last reference to the job
+        work_ = nullptr;
+        finished_ = nullptr;
+    }
+
+    //_________________________________________________________
+
+
+    JobRunner* JobRunner::instance() {
+        static JobRunner runner(2);
+        return &runner;
+    }
+
+
+    JobRunner::JobRunner(unsigned int num_threads) : stopping_(false) {
+        if (num_threads == 0)
+            num_threads = default_thread_count();
+        for (unsigned int i = 0; i < num_threads; ++i)
+            workers_.emplace_back(&JobRunner::worker_loop, this);
+    }
+
+
+    JobRunner::~JobRunner() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+            for (auto& job : queue_)
+                job->cancel();
+            for (auto& job : running_)
+                job->cancel();
+        }
+        work_available_.notify_all();
+        for (auto& t : workers_)
+            t.join();
+    }
+
+
+    std::shared_ptr<Job> JobRunner::submit(const std::string& name, Job::Work work, Job::Callback finished) {
+        auto job = std::make_shared<Job>(name, std::move(work), std::move(finished));
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            queue_.push_back(job);
+        }
+        work_available_.notify_one();
+        return job;
+    }
+
+
+    void JobRunner::cancel_all() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& job : queue_)
+            job->cancel();
+        for (auto& job : running_)
+            job->cancel();
+    }
+
+
+    void JobRunner::wait_all() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        all_done_.wait(lock, [this]() { return queue_.empty() && running_.empty(); });
+    }
+
+
+    std::size_t JobRunner::num_pending() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return queue_.size() + running_.size();
+    }
+
+
+    void JobRunner::worker_loop() {
+        while (true) {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                work_available_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+                if (queue_.empty())
+                    return; // stopping, and nothing left (the remaining jobs are canceled and just report it)
+                job = queue_.front();
+                queue_.pop_front();
+                running_.push_back(job);
+            }
+
+            job->run();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                running_.erase(std::find(running_.begin(), running_.end(), job));
+                if (queue_.empty() && running_.empty())
+                    all_done_.notify_all();
+            }
+        }
+    }
+
+}
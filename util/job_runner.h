@@ -0,0 +1,113 @@
+#ifndef EASY3D_UTIL_JOB_RUNNER_H
+#define EASY3D_UTIL_JOB_RUNNER_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+
+namespace MV {
+
+    /**
+     * \brief A unit of work executed by the JobRunner.
+     * \class Job MV/util/job_runner.h
+     * \details A job is shared between the runner and whoever submitted it. Cancellation is cooperative: cancel()
+     *      only raises a flag, and the work function is expected to poll is_canceled() (directly, or through
+     *      ProgressLogger::is_canceled() which also reports the cancellation of the job running on the calling
+     *      thread) and return early.
+     */
+    class Job {
+    public:
+        enum State { QUEUED, RUNNING, FINISHED, CANCELED, FAILED };
+
+        /// The work. Returns \c false if it did not complete (e.g., it has been canceled).
+        typedef std::function<bool(Job& job)> Work;
+        /// Called on the worker thread once the work has returned (in any state but QUEUED and RUNNING).
+        typedef std::function<void(Job& job)> Callback;
+
+        Job(const std::string& name, Work work, Callback finished);
+
+        const std::string& name() const { return name_; }
+        State state() const { return state_; }
+        /// The message of the exception that made the job fail.
+        const std::string& error() const { return error_; }
+
+        /// Requests the job to stop. A queued job will not be started.
+        void cancel() { canceled_ = true; }
+        bool is_canceled() const { return canceled_; }
+
+        /// The job running on the calling thread, or \c nullptr if the calling thread is not a worker.
+        static const Job* current();
+
+    private:
+        void run();
+
+    private:
+        std::string name_;
+        Work work_;
+        Callback finished_;
+        std::atomic<State> state_;
+        std::atomic<bool> canceled_;
+        std::string error_;
+
+        friend class JobRunner;
+    };
+
+    //_________________________________________________________
+
+    /**
+     * \brief A pool of worker threads executing jobs in the order they are submitted.
+     * \class JobRunner MV/util/job_runner.h
+     * \details Typical use from a GUI: take a snapshot of the data, submit a job working on the snapshot, and
+     *      publish the result from the \p finished callback (which runs on the worker thread, so a GUI has to
+     *      forward it to its own thread, e.g., with a queued Qt call).
+     *      \code
+     *      auto snapshot = std::make_shared<SurfaceMesh>(*mesh);
+     *      JobRunner::instance()->submit("smoothing", [snapshot](Job&) { ...; return true; },
+     *                                    [](Job& job) { if (job.state() == Job::FINISHED) ... });
+     *      \endcode
+     */
+    class JobRunner {
+    public:
+        /// The runner shared by the application. It has two workers only, because the algorithms are
+        /// parallel themselves.
+        static JobRunner* instance();
+
+        /// \param num_threads The number of worker threads (0 means default_thread_count()).
+        explicit JobRunner(unsigned int num_threads = 0);
+        /// Cancels all jobs and waits for the running ones to return.
+        ~JobRunner();
+
+        std::shared_ptr<Job> submit(const std::string& name, Job::Work work, Job::Callback finished = nullptr);
+
+        /// Cancels the queued and the running jobs.
+        void cancel_all();
+        /// Blocks until no job is queued or running.
+        void wait_all();
+
+        /// The number of jobs queued or running.
+        std::size_t num_pending() const;
+
+    private:
+        void worker_loop();
+
+    private:
+        std::vector<std::thread> workers_;
+        std::deque<std::shared_ptr<Job> > queue_;
+        std::vector<std::shared_ptr<Job> > running_;
+        mutable std::mutex mutex_;
+        std::condition_variable work_available_;
+        std::condition_variable all_done_;
+        bool stopping_;
+    };
+
+}   // namespace MV
+
+
+#endif  // EASY3D_UTIL_JOB_RUNNER_H
@@ -0,0 +1,101 @@
+#include "parallel.h"
+
+
+namespace MV {
+
+    WorkerPool* WorkerPool::instance() {
+        static WorkerPool pool;
+        return &pool;
+    }
+
+
+    WorkerPool::~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        work_available_.notify_all();
+        for (auto& t : workers_)
+            t.join();
+    }
+
+
+    void WorkerPool::run(unsigned int num_tasks, const std::function<void(unsigned int)>& task) {
+        if (num_tasks == 0)
+            return;
+
+        Batch batch;
+        batch.task = &task;
+        batch.size = num_tasks;
+        batch.next = 0;
+        batch.done = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // the workers are started on demand: as many as the widest loop can use besides its caller
+            while (workers_.size() + 1 < num_tasks)
+                workers_.emplace_back(&WorkerPool::worker_loop, this);
+            queue_.push_back(&batch);
+        }
+        for (unsigned int i = 1; i < num_tasks; ++i)
+            work_available_.notify_one();
+
+        // the caller takes part, so the batch completes even if all the workers are busy (e.g., in an outer loop)
+        unsigned int index = 0;
+        while (claim(batch, index))
+            execute(batch, index);
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        batch_done_.wait(lock, [&batch]() { return batch.done == batch.size; });
+        if (batch.error)
+            std::rethrow_exception(batch.error);
+    }
+
+
+    bool WorkerPool::claim(Batch& batch, unsigned int& index) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (batch.next == batch.size)
+            return false;
+        index = batch.next++;
+        if (batch.next == batch.size)
+            queue_.erase(std::find(queue_.begin(), queue_.end(), &batch));  // its last task is claimed
+        return true;
+    }
+
+
+    void WorkerPool::execute(Batch& batch, unsigned int index) {
+        try {
+            (*batch.task)(index);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!batch.error)
+                batch.error = std::current_exception();
+        }
+
+        // the batch lives on the stack of its caller, which may return as soon as it sees the last task done
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (++batch.done == batch.size)
+            batch_done_.notify_all();
+    }
+
+
+    void WorkerPool::worker_loop() {
+        while (true) {
+            Batch* batch = nullptr;
+            unsigned int index = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                work_available_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+                if (queue_.empty())
+                    return; // stopping
+                // the batches in the queue have tasks left to claim
+                batch = queue_.front();
+                index = batch->next++;
+                if (batch->next == batch->size)
+                    queue_.pop_front();
+            }
+            execute(*batch, index);
+        }
+    }
+
+}
@@ -0,0 +1,134 @@
+#ifndef EASY3D_UTIL_PARALLEL_H
+#define EASY3D_UTIL_PARALLEL_H
+
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <functional>
+#include <exception>
+#include <condition_variable>
+#include <algorithm>
+#include <cstddef>
+
+
+namespace MV {
+
+    /// \brief Returns the number of worker threads used when a parallel loop is not given an explicit count.
+    /// \details This is the number of hardware threads reported by the system (at least 1).
+    inline unsigned int default_thread_count()
+    {
+        const unsigned int n = std::thread::hardware_concurrency();
+        return n > 0 ? n : 1;
+    }
+
+    /**
+     * \brief The worker threads of the parallel loops, kept alive across the loops.
+     * \class WorkerPool MV/util/parallel.h
+     * \details run() hands the tasks of a loop to the workers and the calling thread alike: each of them claims the
+     *      next task until none is left. As the calling thread keeps claiming tasks, a loop always completes, also
+     *      when it is started from a task of another loop (nested loops) and all the workers are busy.
+     */
+    class WorkerPool {
+    public:
+        /// The pool shared by all the parallel loops.
+        static WorkerPool* instance();
+
+        /// Stops the workers (after the loops running on them have returned).
+        ~WorkerPool();
+
+        /// Calls \p task(i) for each i in [0, \p num_tasks) on up to \p num_tasks threads, the calling thread
+        /// included, and returns once all the calls have returned. If calls throw, the first exception caught is
+        /// thrown again.
+        void run(unsigned int num_tasks, const std::function<void(unsigned int)>& task);
+
+    private:
+        WorkerPool() : stopping_(false) {}
+
+        // the tasks of one call of run(), on the stack of its caller
+        struct Batch {
+            const std::function<void(unsigned int)>* task;
+            unsigned int size;
+            // guarded by mutex_
+            unsigned int next;                  // the next task to claim
+            unsigned int done;                  // the number of tasks returned
+            std::exception_ptr error;           // the first exception thrown by a task
+        };
+
+        // claims the next task of \p batch; returns false if all its tasks are claimed
+        bool claim(Batch& batch, unsigned int& index);
+        void execute(Batch& batch, unsigned int index);
+        void worker_loop();
+
+    private:
+        std::vector<std::thread> workers_;
+        std::deque<Batch*> queue_;
+        std::mutex mutex_;
+        std::condition_variable work_available_;
+        std::condition_variable batch_done_;
+        bool stopping_;
+    };
+
+
+    /**
+     * \brief Splits the index range [\p begin, \p end) into contiguous chunks and processes them in parallel.
+     * \details The range is divided into at most \p num_threads chunks of (almost) equal size, and
+     *      \p func(chunk_begin, chunk_end, chunk_id) is invoked once per chunk. The chunk boundaries only depend
+     *      on the range and the number of chunks, and each index is visited by exactly one chunk, so algorithms
+     *      whose per-index result does not depend on the other indices give identical results for any number of
+     *      threads. The chunks run on the threads of the WorkerPool, which are started once and reused by all
+     *      the loops, and on the calling thread. Loops may be nested.
+     * \param num_threads The number of chunks (0 means default_thread_count()).
+     * \param min_chunk_size Ranges are not split into chunks smaller than this, which avoids handing tiny
+     *      workloads to other threads.
+     * \return The number of chunks that have been processed.
+     */
+    template <typename Func>
+    inline unsigned int parallel_for_chunks(std::size_t begin, std::size_t end, Func func,
+                                            unsigned int num_threads = 0, std::size_t min_chunk_size = 1024)
+    {
+        if (end <= begin)
+            return 0;
+
+        if (num_threads == 0)
+            num_threads = default_thread_count();
+
+        const std::size_t n = end - begin;
+        const std::size_t max_chunks = std::max<std::size_t>(1, n / std::max<std::size_t>(1, min_chunk_size));
+        const unsigned int num_chunks = static_cast<unsigned int>(std::min<std::size_t>(num_threads, max_chunks));
+        if (num_chunks <= 1) {
+            func(begin, end, 0u);
+            return 1;
+        }
+
+        const std::size_t chunk_size = n / num_chunks;
+        const std::size_t remainder = n % num_chunks;
+        auto chunk_begin = [&](unsigned int c) -> std::size_t {
+            return begin + c * chunk_size + std::min<std::size_t>(c, remainder);
+        };
+
+        WorkerPool::instance()->run(num_chunks, [&](unsigned int c) {
+            func(chunk_begin(c), c + 1 < num_chunks ? chunk_begin(c + 1) : end, c);
+        });
+        return num_chunks;
+    }
+
+    /**
+     * \brief Calls \p func(i) for each index i in [\p begin, \p end), distributing contiguous chunks of the range
+     *      over \p num_threads threads.
+     * \sa parallel_for_chunks()
+     */
+    template <typename Func>
+    inline void parallel_for(std::size_t begin, std::size_t end, Func func,
+                             unsigned int num_threads = 0, std::size_t min_chunk_size = 1024)
+    {
+        parallel_for_chunks(begin, end, [&func](std::size_t b, std::size_t e, unsigned int) {
+            for (std::size_t i = b; i < e; ++i)
+                func(i);
+        }, num_threads, min_chunk_size);
+    }
+
+} // namespace MV
+
+
+#endif  // EASY3D_UTIL_PARALLEL_H
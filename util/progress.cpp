@@ -9,7 +9,13 @@
  ********************************************************************/
 
 #include "progress.h"
+#include "job_runner.h"
 #include <cassert>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <chrono>
+#include <thread>
 #include <algorithm>	// for std::min and std::max
 
 
@@ -22,25 +28,32 @@ namespace MV {
         public:
             static Progress* instance();
 
-            virtual void notify(std::size_t percent, bool update_viewer);
+            /// Notifies the client on behalf of a logger at nesting depth \p level (see push()).
+            virtual void notify(std::size_t percent, bool update_viewer, int level);
 
             void set_client(ProgressClient *c) { client_ = c; }
 
-            void push();
-            void pop();
+            /// Registers a logger created on behalf of \p job (nullptr: outside of any job) and returns its
+            /// nesting depth among the live loggers of that job (1: outermost).
+            int push(const Job* job);
+            void pop(const Job* job);
 
             void cancel() { canceled_ = true; }
             void clear_canceled() { canceled_ = false; }
-            bool is_canceled() const { return canceled_; }
+            bool is_canceled() const { return canceled_.load(std::memory_order_relaxed); }
 
         protected:
-            Progress() : client_(nullptr), level_(0), canceled_(false) {}
+            Progress() : client_(nullptr), num_loggers_(0), canceled_(false) {}
 
             virtual ~Progress() = default;
 
             ProgressClient *client_;
-            int level_;
-            bool canceled_;
+            // The nesting is counted per job, so the loggers of a job running in the background neither hide nor
+            // are hidden by the ones of another job (or of the GUI thread).
+            std::mutex mutex_;
+            std::vector<std::pair<const Job*, int> > levels_;
+            int num_loggers_;
+            std::atomic<bool> canceled_;    // set by the GUI thread, polled by workers
         };
 
         Progress* Progress::instance() {
@@ -48,20 +61,37 @@ namespace MV {
             return &instance;
         }
 
-        void Progress::push() {
-            level_++;
-            if (level_ == 1) {
+        int Progress::push(const Job* job) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // a cancellation only ends when nothing is in progress anymore
+            if (++num_loggers_ == 1)
                 clear_canceled();
+            for (auto& level : levels_) {
+                if (level.first == job)
+                    return ++level.second;
             }
+            levels_.emplace_back(job, 1);
+            return 1;
         }
 
-        void Progress::pop() {
-            assert(level_ > 0);
-            level_--;
+        void Progress::pop(const Job* job) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            assert(num_loggers_ > 0);
+            --num_loggers_;
+            for (std::size_t i = 0; i < levels_.size(); ++i) {
+                if (levels_[i].first == job) {
+                    if (--levels_[i].second == 0) {
+                        levels_[i] = levels_.back();
+                        levels_.pop_back();
+                    }
+                    return;
+                }
+            }
+            assert(false);
         }
 
-        void Progress::notify(std::size_t percent, bool update_viewer) {
-            if (client_ != nullptr && level_ < 2)
+        void Progress::notify(std::size_t percent, bool update_viewer, int level) {
+            if (client_ != nullptr && level < 2)
                 client_->notify(percent, update_viewer);
         }
     }
@@ -81,41 +111,72 @@ namespace MV {
     //_________________________________________________________
 
 
+    namespace internal {
+        std::int64_t now_ns() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    }
+
+
     ProgressLogger::ProgressLogger(std::size_t max_val, bool update_viewer, bool quiet)
             : max_val_(max_val)
             , cur_val_(0)
+            , next_val_(0)
             , cur_percent_(0)
+            , last_time_(0)
+            , notifying_(false)
+            , min_interval_(0)
+            , max_rate_(0)
             , quiet_(quiet)
             , update_viewer_(update_viewer)
+            , job_(Job::current())
+            , level_(0)
     {
-        internal::Progress::instance()->push();
+        set_max_rate(20);
+        next_val_ = threshold_of(0);
+        level_ = internal::Progress::instance()->push(job_);
         if (!quiet_) {
-            internal::Progress::instance()->notify(0, update_viewer_);
+            internal::Progress::instance()->notify(0, update_viewer_, level_);
+            last_time_ = internal::now_ns();
         }
     }
 
 
     ProgressLogger::~ProgressLogger() {
         // one more notification to make sure the progress reaches its end
-        internal::Progress::instance()->notify(100, update_viewer_);
-        internal::Progress::instance()->pop();
+        internal::Progress::instance()->notify(100, update_viewer_, level_);
+        internal::Progress::instance()->pop(job_);
+    }
+
+
+    void ProgressLogger::set_max_rate(double notifications_per_second) {
+        max_rate_ = std::max(0.0, notifications_per_second);
+        min_interval_ = max_rate_ > 0 ? static_cast<std::int64_t>(1e9 / max_rate_) : 0;
     }
 
 
     void ProgressLogger::notify(std::size_t new_value) {
-        cur_val_ = new_value;
-        update();
+        cur_val_.store(new_value, std::memory_order_relaxed);
+        // going back (e.g., reset()) and reaching the end are always reported
+        const std::size_t percent = percent_of(new_value);
+        const std::size_t current = cur_percent_.load(std::memory_order_relaxed);
+        next_val_.store(threshold_of(percent), std::memory_order_relaxed);
+        update(new_value, percent < current || percent >= 100);
     }
 
 
     void ProgressLogger::next() {
-        cur_val_++;
-        update();
+        // the fast path: a relaxed increment and a comparison
+        const std::size_t value = cur_val_.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (value >= next_val_.load(std::memory_order_relaxed))
+            update(value, false);
     }
 
 
     bool ProgressLogger::is_canceled() const {
-        return internal::Progress::instance()->is_canceled();
+        // a job running in the background can also be canceled on its own
+        return internal::Progress::instance()->is_canceled() || (job_ && job_->is_canceled());
     }
 
 
@@ -125,14 +186,45 @@ namespace MV {
     }
 
 
+    std::size_t ProgressLogger::percent_of(std::size_t value) const {
+        return value * 100 / (max_val_ > 1 ? max_val_ - 1 : 1);
+    }
+
+
+    std::size_t ProgressLogger::threshold_of(std::size_t percent) const {
+        const std::size_t range = (max_val_ > 1 ? max_val_ - 1 : 1);
+        return ((percent + 1) * range + 99) / 100;
+    }
+
+
     void ProgressLogger::update() {
-        std::size_t percent = cur_val_ * 100 / std::max<std::size_t>(1, max_val_ - 1);
-        if (percent != cur_percent_) {
-            cur_percent_ = percent;
-            if (!quiet_) {
-                internal::Progress::instance()->notify(std::min<std::size_t>(cur_percent_, 100), update_viewer_);
-            }
+        update(cur_val_.load(std::memory_order_relaxed), false);
+    }
+
+
+    void ProgressLogger::update(std::size_t value, bool force) {
+        const std::size_t percent = percent_of(value);
+        if (percent == cur_percent_.load(std::memory_order_relaxed))
+            return;
+
+        // another thread is notifying: skip, the next crossing of a threshold will try again
+        while (notifying_.exchange(true, std::memory_order_acquire)) {
+            if (!force)
+                return;
+            std::this_thread::yield();
         }
+
+        const std::int64_t now = internal::now_ns();
+        if (force || now - last_time_.load(std::memory_order_relaxed) >= min_interval_) {
+            cur_percent_.store(percent, std::memory_order_relaxed);
+            last_time_.store(now, std::memory_order_relaxed);
+            if (!quiet_)
+                internal::Progress::instance()->notify(std::min<std::size_t>(percent, 100), update_viewer_, level_);
+        }
+        // throttled or not, next() only comes back here at the next percent
+        next_val_.store(threshold_of(percent), std::memory_order_relaxed);
+
+        notifying_.store(false, std::memory_order_release);
     }
 
 
@@ -3,10 +3,14 @@
 
 
 #include <string>
+#include <atomic>
+#include <cstdint>
 
 
 namespace MV {
 
+    class Job;
+
     /**
      * \brief The based class of GUI element reporting the progress.
      * \class ProgressClient MV/util/progress.h
@@ -24,6 +28,13 @@ namespace MV {
     /**
      * \brief An implementation of progress logging mechanism.
      * \class ProgressLogger MV/util/progress.h
+     * \details next() and notify() may be called from hot loops and from several threads at once. The counter is
+     *      atomic, and the percentage is only recomputed when the counter crosses the next percent boundary. The
+     *      client is notified when the percentage changes, but at most max_rate() times per second (the start and
+     *      the end of the range are always reported). is_canceled() only reads two flags, so loops can poll it
+     *      at every iteration.
+     *      A logger created while another one is alive for the same Job (or, outside of the jobs, for the
+     *      application) is nested and does not notify the client; loggers of different jobs all notify.
      */
     class ProgressLogger {
     public:
@@ -37,8 +48,14 @@ namespace MV {
         virtual void next();
         virtual void done() { notify(max_val_); }
 
+        /// Returns \c true if the user canceled the operation, or if the Job that was running on the thread that
+        /// created this logger has been canceled. Long computations should poll it and return early.
         bool is_canceled() const;
 
+        /// The max number of notifications sent to the client per second (default: 20). 0 means no limit.
+        void set_max_rate(double notifications_per_second);
+        double max_rate() const { return max_rate_; }
+
         /// Resets the progress logger without changing the progress range.
         void reset() { notify(0); }
         /// Resets the progress logger, and meanwhile changes the progress range.
@@ -47,12 +64,26 @@ namespace MV {
     protected:
         virtual void update();
 
+    private:
+        std::size_t percent_of(std::size_t value) const;
+        /// The smallest value whose percentage is larger than \p percent.
+        std::size_t threshold_of(std::size_t percent) const;
+        /// Notifies the client if \p value reaches a new percentage and the rate allows it (or \p force is set).
+        void update(std::size_t value, bool force);
+
     private:
         std::size_t max_val_;
-        std::size_t cur_val_;
-        std::size_t cur_percent_;
+        std::atomic<std::size_t> cur_val_;
+        std::atomic<std::size_t> next_val_;     // next() only does work once cur_val_ reaches it
+        std::atomic<std::size_t> cur_percent_;
+        std::atomic<std::int64_t> last_time_;   // time of the last notification (steady clock, in nanoseconds)
+        std::atomic<bool> notifying_;           // one thread notifies at a time, the others skip
+        std::int64_t min_interval_;             // in nanoseconds
+        double max_rate_;
         bool quiet_;
         bool update_viewer_;
+        const Job* job_;
+        int level_;     // nesting depth among the live loggers of job_ (only the outermost one notifies)
     };
 
     /// A simple progress indicator for console applications. Given percentage = 0.75, the output looks like